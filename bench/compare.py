@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+"""Сравнение двух прогонов web-client-bench (--benchmark_out_format=json).
+
+    bench/compare.py bench/baseline.json new.json [--threshold 10] [--metric cpu_time]
+
+Для каждого бенчмарка — время в базовом и новом прогоне и изменение в %.
+При повторах (--benchmark_repetitions) берётся медиана. Код выхода 1 —
+хотя бы один бенчмарк медленнее базового больше чем на threshold %.
+"""
+
+import argparse
+import json
+import sys
+
+UNITS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def load(path, metric):
+    with open(path, encoding="utf-8") as f:
+        data = json.load(f)
+
+    iterations = {}
+    medians = {}
+    for b in data.get("benchmarks", []):
+        if b.get("error_occurred"):
+            continue
+        ns = b[metric] * UNITS[b.get("time_unit", "ns")]
+        name = b.get("run_name", b["name"])
+        if b.get("run_type") == "aggregate":
+            if b.get("aggregate_name") == "median":
+                medians[name] = ns
+        else:
+            iterations.setdefault(name, []).append(ns)
+
+    result = {name: sorted(v)[len(v) // 2] for name, v in iterations.items()}
+    result.update(medians)
+    return result
+
+
+def fmt(ns):
+    for unit, scale in (("s", 1e9), ("ms", 1e6), ("us", 1e3)):
+        if ns >= scale:
+            return f"{ns / scale:.2f} {unit}"
+    return f"{ns:.1f} ns"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=10.0, help="допустимое замедление, %% (10)")
+    parser.add_argument("--metric", choices=("real_time", "cpu_time"), default="cpu_time")
+    args = parser.parse_args()
+
+    base = load(args.baseline, args.metric)
+    cur = load(args.current, args.metric)
+
+    width = max((len(n) for n in base.keys() | cur.keys()), default=10)
+    print(f"{'benchmark':<{width}} {'baseline':>12} {'current':>12} {'change':>9}")
+
+    regressions = []
+    for name in sorted(base.keys() | cur.keys()):
+        if name not in cur:
+            print(f"{name:<{width}} {fmt(base[name]):>12} {'-':>12} {'removed':>9}")
+            continue
+        if name not in base:
+            print(f"{name:<{width}} {'-':>12} {fmt(cur[name]):>12} {'new':>9}")
+            continue
+        change = (cur[name] - base[name]) / base[name] * 100
+        mark = ""
+        if change > args.threshold:
+            mark = "  <-- slower"
+            regressions.append(name)
+        print(f"{name:<{width}} {fmt(base[name]):>12} {fmt(cur[name]):>12} {change:>+8.1f}%{mark}")
+
+    if regressions:
+        print(f"\n{len(regressions)} benchmark(s) slower than baseline by more than {args.threshold:g}%")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
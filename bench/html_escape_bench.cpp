@@ -0,0 +1,88 @@
+// Пропускная способность html_escape на больших телах (как <pre> с ответом
+// Main). Сравнивается с прежним побайтовым экранированием.
+//
+//   cmake -S . -B build -DWEB_CLIENT_BENCH=ON && cmake --build build --target html-escape-bench
+//   ./build/html-escape-bench [мегабайт]
+
+#include "html.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+namespace {
+
+// Прежняя реализация из handlers/common.cpp — точка отсчёта.
+std::string html_escape_bytewise(const std::string& s) {
+    std::string out;
+    out.reserve(s.size());
+    for (char c : s) {
+        switch (c) {
+            case '&': out += "&amp;"; break;
+            case '<': out += "&lt;";  break;
+            case '>': out += "&gt;";  break;
+            case '"': out += "&quot;"; break;
+            case '\'': out += "&#39;"; break;
+            default: out += c; break;
+        }
+    }
+    return out;
+}
+
+// Тело размером size, где примерно каждый special_every-й символ надо
+// экранировать (0 — ни одного).
+std::string make_body(size_t size, size_t special_every) {
+    static const char kSpecial[] = "&<>\"'";
+    std::mt19937 rng(42);
+    std::string body(size, 'a');
+    for (size_t i = 0; i < size; ++i) {
+        body[i] = static_cast<char>('a' + rng() % 26);
+        if (special_every && rng() % special_every == 0) body[i] = kSpecial[rng() % 5];
+    }
+    return body;
+}
+
+template <class Fn>
+double mb_per_second(const std::string& body, Fn&& escape) {
+    using Clock = std::chrono::steady_clock;
+    size_t sink = 0;
+    int rounds = 0;
+    const auto start = Clock::now();
+    auto elapsed = Clock::duration::zero();
+    while (elapsed < std::chrono::milliseconds(500) || rounds < 3) {
+        sink += escape(body).size();
+        ++rounds;
+        elapsed = Clock::now() - start;
+    }
+    if (sink == 0) std::puts("");
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    return static_cast<double>(body.size()) * rounds / seconds / (1024 * 1024);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4;
+    const size_t size = megabytes * 1024 * 1024;
+
+    std::printf("html_escape: %s, body %zu MiB\n", html_escape_isa(), megabytes);
+    std::printf("%-22s %12s %12s\n", "body", "bytewise", "html_escape");
+
+    const struct {
+        const char* name;
+        size_t special_every;
+    } cases[] = {
+        {"clean", 0},
+        {"1 special / 1000 B", 1000},
+        {"1 special / 64 B", 64},
+        {"1 special / 8 B", 8},
+    };
+    for (const auto& c : cases) {
+        const auto body = make_body(size, c.special_every);
+        const double old_rate = mb_per_second(body, [](const std::string& s) { return html_escape_bytewise(s); });
+        const double new_rate = mb_per_second(body, [](const std::string& s) { return html_escape(s); });
+        std::printf("%-22s %9.0f MB/s %9.0f MB/s\n", c.name, old_rate, new_rate);
+    }
+}
@@ -0,0 +1,304 @@
+// Микробенчмарки горячих путей запроса: сессия, cookie, страницы, RESP.
+// Размеры данных — как у живого сервиса: JWT по ~1 КБ, списки Main на
+// десятки-сотни элементов, ответы Redis с сессией и MGET.
+//
+//   cmake -S . -B build -DWEB_CLIENT_BENCH=ON -DCMAKE_BUILD_TYPE=Release
+//   cmake --build build --target web-client-bench
+//   ./build/web-client-bench --benchmark_out=new.json --benchmark_out_format=json
+//   bench/compare.py bench/baseline.json new.json
+
+#include "html.hpp"
+#include "pages.hpp"
+#include "resp.hpp"
+#include "session.hpp"
+#include "utils.hpp"
+#include "api/auth_client.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string random_string(size_t size, std::string_view alphabet, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::string out(size, ' ');
+    for (auto& c : out) c = alphabet[rng() % alphabet.size()];
+    return out;
+}
+
+constexpr std::string_view kBase64Url = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+// header.payload.signature — длины как у RS256-токенов Auth.
+std::string fake_jwt(size_t payload_size, unsigned seed) {
+    return "eyJhbGciOiJSUzI1NiIsInR5cCI6IkpXVCJ9." + random_string(payload_size, kBase64Url, seed)
+        + "." + random_string(342, kBase64Url, seed + 1);
+}
+
+SessionData authorized_session() {
+    SessionData s;
+    s.status = "authorized";
+    s.login_token = "3f2b8c1e-9a4d-4e7f-b6c5-2d1a0e9f8b7c";
+    s.access_token = fake_jwt(420, 1);
+    s.refresh_token = fake_jwt(180, 3);
+    s.access_exp = 1791234567;
+    return s;
+}
+
+// Как прежде лежали сессии в Redis — JSON, читается до первой перезаписи.
+std::string legacy_json_session(const SessionData& s) {
+    return "{\"status\":\"" + s.status + "\",\"login_token\":\"" + s.login_token
+        + "\",\"access_token\":\"" + s.access_token + "\",\"refresh_token\":\"" + s.refresh_token + "\"}";
+}
+
+// Ответ /courses_list: объекты с id, названием и описанием.
+std::string courses_json(size_t count) {
+    std::string json = "{\"items\":[";
+    for (size_t i = 0; i < count; ++i) {
+        if (i) json += ',';
+        json += "{\"course_id\":" + std::to_string(1000 + i)
+            + ",\"name\":\"Курс " + std::to_string(i) + ": алгоритмы & структуры данных\""
+            + ",\"description\":\"" + random_string(120, "abcdefghij klmnopqrstuvwxyz", static_cast<unsigned>(i)) + "\""
+            + ",\"teacher_id\":" + std::to_string(50 + i % 7)
+            + ",\"tags\":[\"cs\",\"<intro>\"],\"archived\":false}";
+    }
+    json += "]}";
+    return json;
+}
+
+// Тело <pre>/страницы — JSON-подобный текст с редкими спецсимволами.
+std::string page_body(size_t size) {
+    return random_string(size, "abcdefghijklmnopqrstuvwxyz0123456789 :,{}[]\"<>&", 7);
+}
+
+std::string resp_bulk(std::string_view s) {
+    return "$" + std::to_string(s.size()) + "\r\n" + std::string(s) + "\r\n";
+}
+
+// Пара связанных сокетов: [0] — «Redis», [1] — клиент.
+struct SocketPair {
+    int fd[2] = {-1, -1};
+
+    SocketPair() {
+        if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fd) != 0) throw std::runtime_error("socketpair failed");
+    }
+    ~SocketPair() {
+        ::close(fd[0]);
+        ::close(fd[1]);
+    }
+
+    static void write_all(int fd, std::string_view data) {
+        while (!data.empty()) {
+            const ssize_t n = ::write(fd, data.data(), data.size());
+            if (n <= 0) throw std::runtime_error("write failed");
+            data.remove_prefix(static_cast<size_t>(n));
+        }
+    }
+
+    // Прочитать ровно n байт (команду клиента) и выбросить.
+    static void drain(int fd, size_t n) {
+        char buf[16 * 1024];
+        while (n > 0) {
+            const ssize_t r = ::read(fd, buf, std::min(n, sizeof(buf)));
+            if (r <= 0) throw std::runtime_error("read failed");
+            n -= static_cast<size_t>(r);
+        }
+    }
+};
+
+// --- session ---
+
+void BM_SerializeSession(benchmark::State& state) {
+    const auto session = authorized_session();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(serialize_session(session));
+    }
+}
+BENCHMARK(BM_SerializeSession);
+
+void BM_ParseSession(benchmark::State& state) {
+    const auto value = serialize_session(authorized_session());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parse_session(value));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * value.size()));
+}
+BENCHMARK(BM_ParseSession);
+
+void BM_ParseSessionLegacyJson(benchmark::State& state) {
+    const auto value = legacy_json_session(authorized_session());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parse_session(value));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * value.size()));
+}
+BENCHMARK(BM_ParseSessionLegacyJson);
+
+// --- cookie ---
+
+void BM_ExtractSession(benchmark::State& state) {
+    // Браузер присылает и чужие cookie: аналитика, предпочтения.
+    const std::string cookie =
+        "_ga=GA1.1.1234567890.1700000000; _ym_uid=1700000000123456789; theme=dark; "
+        "lang=ru; SESSION=3f2b8c1e-9a4d-4e7f-b6c5-2d1a0e9f8b7c; _ga_XYZ=GS1.1.1700000000.3.1.1700000100.0.0.0";
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(extract_session(cookie));
+    }
+}
+BENCHMARK(BM_ExtractSession);
+
+// --- pages ---
+
+void BM_HtmlEscape(benchmark::State& state) {
+    const auto body = page_body(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(html_escape(body));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * body.size()));
+    state.SetLabel(html_escape_isa());
+}
+BENCHMARK(BM_HtmlEscape)->Arg(256)->Arg(16 << 10)->Arg(1 << 20);
+
+void BM_LinkListFromJson(benchmark::State& state) {
+    const auto json = courses_json(static_cast<size_t>(state.range(0)));
+    const std::vector<std::string> id_keys = {"course_id", "id"};
+    const std::vector<std::string> label_keys = {"name", "title", "description"};
+    for (auto _ : state) {
+        std::string html;
+        html.reserve(2 * json.size());
+        append_link_list(html, "Courses", json, "/course", "course_id", id_keys, label_keys);
+        benchmark::DoNotOptimize(html);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * json.size()));
+}
+BENCHMARK(BM_LinkListFromJson)->Arg(10)->Arg(100)->Arg(1000);
+
+// Не JSON (Main ответил страницей ошибки) — откат на nlohmann и <pre>.
+void BM_LinkListUnparsed(benchmark::State& state) {
+    const auto body = "<html><body>502 Bad Gateway " + page_body(2048) + "</body></html>";
+    const std::vector<std::string> id_keys = {"course_id", "id"};
+    const std::vector<std::string> label_keys = {"name"};
+    for (auto _ : state) {
+        std::string html;
+        append_link_list(html, "Courses", body, "/course", "course_id", id_keys, label_keys);
+        benchmark::DoNotOptimize(html);
+    }
+}
+BENCHMARK(BM_LinkListUnparsed);
+
+void BM_WrapHtml(benchmark::State& state) {
+    const auto body = "<h1>Course</h1><pre>" + html_escape(page_body(static_cast<size_t>(state.range(0)))) + "</pre>";
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(wrap_html("Course", body));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * body.size()));
+}
+BENCHMARK(BM_WrapHtml)->Arg(1 << 10)->Arg(64 << 10);
+
+// --- Auth ---
+
+void BM_UrlEncode(benchmark::State& state) {
+    // token_login (uuid) и redirect с кириллицей и query.
+    const std::vector<std::string> values = {
+        "3f2b8c1e-9a4d-4e7f-b6c5-2d1a0e9f8b7c",
+        "https://example.org/курсы?id=42&tab=оценки#раздел",
+    };
+    const auto& value = values[static_cast<size_t>(state.range(0))];
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(AuthClient::UrlEncode(value));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * value.size()));
+}
+BENCHMARK(BM_UrlEncode)->Arg(0)->Arg(1);
+
+// --- RESP ---
+
+void BM_RespCommandSet(benchmark::State& state) {
+    const std::vector<std::string> parts = {
+        "SET", "session:3f2b8c1e-9a4d-4e7f-b6c5-2d1a0e9f8b7c", serialize_session(authorized_session()), "EX", "86400"};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(resp_command(parts));
+    }
+}
+BENCHMARK(BM_RespCommandSet);
+
+// Разбор ответов из памяти — без системных вызовов.
+void BM_RespParseMget(benchmark::State& state) {
+    const size_t keys = static_cast<size_t>(state.range(0));
+    const auto value = serialize_session(authorized_session());
+    std::string reply = "*" + std::to_string(keys) + "\r\n";
+    for (size_t i = 0; i < keys; ++i) reply += i % 4 == 3 ? std::string("$-1\r\n") : resp_bulk(value);
+
+    RespReader reader;
+    RespValue out;
+    for (auto _ : state) {
+        reader.feed(reply.data(), reply.size());
+        if (!reader.next(out)) state.SkipWithError("incomplete reply");
+        benchmark::DoNotOptimize(out.elements.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * reply.size()));
+}
+BENCHMARK(BM_RespParseMget)->Arg(1)->Arg(16)->Arg(128);
+
+// Запрос-ответ через socketpair: кодирование команды, write, «сервер»
+// вычитывает команду и отвечает заготовкой, клиент разбирает через fill().
+void BM_RespRoundTripGet(benchmark::State& state) {
+    SocketPair sp;
+    const std::vector<std::string> parts = {"GET", "session:3f2b8c1e-9a4d-4e7f-b6c5-2d1a0e9f8b7c"};
+    const auto reply = resp_bulk(serialize_session(authorized_session()));
+
+    RespReader reader;
+    for (auto _ : state) {
+        const auto cmd = resp_command(parts);
+        SocketPair::write_all(sp.fd[1], cmd);
+        SocketPair::drain(sp.fd[0], cmd.size());
+        SocketPair::write_all(sp.fd[0], reply);
+        auto out = reader.read(sp.fd[1]);
+        benchmark::DoNotOptimize(out.str.data());
+    }
+}
+BENCHMARK(BM_RespRoundTripGet);
+
+// Пачка команд одним write и ответы одним буфером — как PIPELINE.
+void BM_RespRoundTripPipeline(benchmark::State& state) {
+    SocketPair sp;
+    const size_t count = static_cast<size_t>(state.range(0));
+    const auto value = serialize_session(authorized_session());
+
+    std::string reply;
+    for (size_t i = 0; i < count; ++i) reply += i % 2 ? std::string(":1\r\n") : resp_bulk(value);
+
+    RespReader reader;
+    RespValue out;
+    std::string cmds;
+    for (auto _ : state) {
+        cmds.clear();
+        for (size_t i = 0; i < count; ++i) {
+            if (i % 2) {
+                resp_append_command(cmds, {"EXPIRE", "session:" + std::to_string(i), "86400"});
+            } else {
+                resp_append_command(cmds, {"GET", "session:" + std::to_string(i)});
+            }
+        }
+        SocketPair::write_all(sp.fd[1], cmds);
+        SocketPair::drain(sp.fd[0], cmds.size());
+        SocketPair::write_all(sp.fd[0], reply);
+        for (size_t i = 0; i < count; ++i) {
+            while (!reader.next(out)) {
+                if (reader.fill(sp.fd[1]) <= 0) state.SkipWithError("recv failed");
+            }
+        }
+        benchmark::DoNotOptimize(out.integer);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+BENCHMARK(BM_RespRoundTripPipeline)->Arg(8)->Arg(64);
+
+} // namespace
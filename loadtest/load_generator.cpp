@@ -0,0 +1,305 @@
+#include "load_generator.hpp"
+
+#include "http.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Stats {
+    uint64_t started = 0;
+    uint64_t ok = 0;
+    uint64_t session_lost = 0;
+    uint64_t failed = 0;
+    uint64_t dropped = 0;
+    std::vector<double> latencies_ms; // завершённых, в т.ч. неудачных
+};
+
+enum class Outcome { Ok, SessionLost, Failed };
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    const size_t rank = static_cast<size_t>(p / 100 * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+} // namespace
+
+// Общее с колбэками запросов: неотвеченные после drain_timeout
+// запросы могут завершиться и позже, уже после отчёта.
+struct LoadState {
+    std::string base_url;
+
+    std::mutex mu;
+    std::array<Stats, kFlowCount> stats;
+    std::vector<std::string> lost;
+    size_t in_flight = 0;
+    bool closed = false; // отчёт снят — поздние ответы не считаются
+    uint64_t unfinished = 0;
+    double measured_seconds = 0;
+};
+
+namespace {
+
+struct Run {
+    std::shared_ptr<LoadState> state;
+    Flow flow;
+    Clock::time_point scheduled;
+    bool measured;
+    std::string session; // значение SESSION; у Login — выданное при входе
+    uint64_t item;       // id для карточек и прокси, выбор списка
+    int step = 0;
+};
+
+void finish(const Run& run, Outcome outcome) {
+    const double ms = std::chrono::duration<double, std::milli>(Clock::now() - run.scheduled).count();
+    auto& state = *run.state;
+    std::lock_guard<std::mutex> lock(state.mu);
+    --state.in_flight;
+    if (outcome == Outcome::SessionLost && run.flow != Flow::Login) state.lost.push_back(run.session);
+    if (state.closed || !run.measured) return;
+
+    auto& stats = state.stats[static_cast<size_t>(run.flow)];
+    switch (outcome) {
+        case Outcome::Ok: ++stats.ok; break;
+        case Outcome::SessionLost: ++stats.session_lost; break;
+        case Outcome::Failed: ++stats.failed; break;
+    }
+    stats.latencies_ms.push_back(ms);
+}
+
+HttpRequest request_for(const Run& run) {
+    HttpRequest req;
+    req.method = "GET";
+    req.span = "loadtest";
+    const auto& base = run.state->base_url;
+    const std::string id = std::to_string(run.item % 1000);
+
+    switch (run.flow) {
+        case Flow::Login:
+            if (run.step == 0) {
+                req.url = base + "/login?type=code";
+                return req;
+            }
+            req.url = base + "/";
+            break;
+        case Flow::Dashboard:
+            req.url = base + "/";
+            break;
+        case Flow::List:
+            req.url = base + (run.item % 2 ? "/users" : "/courses");
+            break;
+        case Flow::Detail:
+            req.url = base + (run.item % 2 ? "/user?id=" + id : "/course?course_id=" + id);
+            break;
+        case Flow::Proxy:
+            if (run.item % 4 == 0) {
+                req.method = "POST";
+                req.url = base + "/submissions";
+                req.body = R"({"course_id":)" + id + R"(,"answer":"42"})";
+                req.headers.push_back("Content-Type: application/json");
+            } else {
+                req.url = base + "/files/report?id=" + id;
+            }
+            break;
+    }
+    req.headers.push_back("Cookie: SESSION=" + run.session);
+    return req;
+}
+
+// Следующий шаг сценария или nullopt — сценарий завершён с этим итогом.
+std::optional<Outcome> evaluate(Run& run, const HttpResponse& r) {
+    switch (run.flow) {
+        case Flow::Login: {
+            if (run.step == 1) return r.status == 200 ? Outcome::Ok : Outcome::Failed;
+            auto it = r.headers.find("set-cookie");
+            if (r.status != 200 || it == r.headers.end()) return Outcome::Failed;
+            run.session = extract_session(it->second);
+            if (run.session.empty()) return Outcome::Failed;
+            run.step = 1;
+            return std::nullopt;
+        }
+        case Flow::Dashboard:
+            // Потерянная сессия на "/" — та же 200, но со страницей входа.
+            if (r.status == 200) {
+                return r.body.find("<h1>Dashboard</h1>") != std::string::npos ? Outcome::Ok : Outcome::SessionLost;
+            }
+            return r.status == 302 ? Outcome::SessionLost : Outcome::Failed;
+        default:
+            if (r.status == 200) return Outcome::Ok;
+            return r.status == 302 ? Outcome::SessionLost : Outcome::Failed;
+    }
+}
+
+void step(std::shared_ptr<Run> run) {
+    http_request_async(request_for(*run), [run](HttpResponse r) {
+        if (auto outcome = evaluate(*run, r)) {
+            finish(*run, *outcome);
+            return;
+        }
+        step(run);
+    });
+}
+
+} // namespace
+
+const char* flow_name(Flow flow) {
+    switch (flow) {
+        case Flow::Login: return "login";
+        case Flow::Dashboard: return "dashboard";
+        case Flow::List: return "list";
+        case Flow::Detail: return "detail";
+        case Flow::Proxy: return "proxy";
+    }
+    return "";
+}
+
+std::array<double, kFlowCount> parse_flow_weights(const std::string& spec) {
+    std::array<double, kFlowCount> weights {};
+    size_t pos = 0;
+    while (pos < spec.size()) {
+        auto end = spec.find(',', pos);
+        if (end == std::string::npos) end = spec.size();
+        const auto item = spec.substr(pos, end - pos);
+        pos = end + 1;
+
+        const auto eq = item.find('=');
+        if (eq == std::string::npos) throw std::invalid_argument("flow weight without '=': " + item);
+        const auto name = item.substr(0, eq);
+        bool known = false;
+        for (size_t i = 0; i < kFlowCount; ++i) {
+            if (name == flow_name(static_cast<Flow>(i))) {
+                weights[i] = std::stod(item.substr(eq + 1));
+                known = true;
+            }
+        }
+        if (!known) throw std::invalid_argument("unknown flow: " + name);
+    }
+    return weights;
+}
+
+LoadGenerator::LoadGenerator(LoadOptions options,
+                             std::vector<std::string> sessions,
+                             std::function<void(const std::string& session)> reseed)
+    : options_(std::move(options)),
+      sessions_(std::move(sessions)),
+      reseed_(std::move(reseed)),
+      state_(std::make_shared<LoadState>()) {
+    state_->base_url = options_.base_url;
+}
+
+void LoadGenerator::run() {
+    std::mt19937_64 rng(42);
+    std::discrete_distribution<size_t> pick_flow(options_.weights.begin(), options_.weights.end());
+
+    const auto start = Clock::now();
+    const auto measure_from = start + options_.warmup;
+    const auto end = measure_from + options_.duration;
+    const std::chrono::duration<double> period(1.0 / options_.rps);
+
+    for (uint64_t i = 0;; ++i) {
+        const auto scheduled = start + std::chrono::duration_cast<Clock::duration>(period * static_cast<double>(i));
+        if (scheduled >= end) break;
+        std::this_thread::sleep_until(scheduled);
+
+        std::vector<std::string> lost;
+        const auto flow = static_cast<Flow>(pick_flow(rng));
+        const bool measured = scheduled >= measure_from;
+        bool dropped = false;
+        {
+            std::lock_guard<std::mutex> lock(state_->mu);
+            lost.swap(state_->lost);
+            auto& stats = state_->stats[static_cast<size_t>(flow)];
+            if (state_->in_flight >= options_.max_in_flight) {
+                if (measured) ++stats.dropped;
+                dropped = true;
+            } else {
+                if (measured) ++stats.started;
+                ++state_->in_flight;
+            }
+        }
+        // Сессию, которую web-client удалил, возвращаем в Redis — иначе
+        // за долгий прогон авторизованных не останется.
+        std::sort(lost.begin(), lost.end());
+        lost.erase(std::unique(lost.begin(), lost.end()), lost.end());
+        for (const auto& session : lost) reseed_(session);
+        if (dropped) continue;
+
+        auto run = std::make_shared<Run>();
+        run->state = state_;
+        run->flow = flow;
+        run->scheduled = scheduled;
+        run->measured = measured;
+        run->item = rng();
+        if (flow != Flow::Login && !sessions_.empty()) run->session = sessions_[run->item % sessions_.size()];
+        step(std::move(run));
+    }
+
+    const auto deadline = Clock::now() + options_.drain_timeout;
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(state_->mu);
+            if (state_->in_flight == 0 || Clock::now() >= deadline) {
+                state_->unfinished = state_->in_flight;
+                state_->closed = true;
+                state_->measured_seconds = std::chrono::duration<double>(options_.duration).count();
+                break;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+void LoadGenerator::print_report(std::FILE* out) const {
+    std::lock_guard<std::mutex> lock(state_->mu);
+    const double seconds = state_->measured_seconds > 0 ? state_->measured_seconds : 1;
+
+    std::fprintf(out, "target %.1f flows/s for %.0f s (after %lld s warmup)\n\n", options_.rps, seconds,
+                 static_cast<long long>(options_.warmup.count()));
+    std::fprintf(out, "%-10s %8s %8s %6s %6s %6s %9s %9s %9s %9s %9s %9s\n", "flow", "started", "ok", "lost",
+                 "failed", "drop", "ok/s", "p50 ms", "p90 ms", "p99 ms", "p99.9 ms", "max ms");
+
+    Stats total;
+    for (size_t i = 0; i < kFlowCount; ++i) {
+        auto stats = state_->stats[i];
+        if (stats.started == 0 && stats.dropped == 0) continue;
+        std::sort(stats.latencies_ms.begin(), stats.latencies_ms.end());
+
+        std::fprintf(out, "%-10s %8llu %8llu %6llu %6llu %6llu %9.1f %9.2f %9.2f %9.2f %9.2f %9.2f\n",
+                     flow_name(static_cast<Flow>(i)), static_cast<unsigned long long>(stats.started),
+                     static_cast<unsigned long long>(stats.ok), static_cast<unsigned long long>(stats.session_lost),
+                     static_cast<unsigned long long>(stats.failed), static_cast<unsigned long long>(stats.dropped),
+                     static_cast<double>(stats.ok) / seconds, percentile(stats.latencies_ms, 50),
+                     percentile(stats.latencies_ms, 90), percentile(stats.latencies_ms, 99),
+                     percentile(stats.latencies_ms, 99.9),
+                     stats.latencies_ms.empty() ? 0.0 : stats.latencies_ms.back());
+
+        total.started += stats.started;
+        total.ok += stats.ok;
+        total.session_lost += stats.session_lost;
+        total.failed += stats.failed;
+        total.dropped += stats.dropped;
+        total.latencies_ms.insert(total.latencies_ms.end(), stats.latencies_ms.begin(), stats.latencies_ms.end());
+    }
+
+    std::sort(total.latencies_ms.begin(), total.latencies_ms.end());
+    std::fprintf(out, "%-10s %8llu %8llu %6llu %6llu %6llu %9.1f %9.2f %9.2f %9.2f %9.2f %9.2f\n", "total",
+                 static_cast<unsigned long long>(total.started), static_cast<unsigned long long>(total.ok),
+                 static_cast<unsigned long long>(total.session_lost), static_cast<unsigned long long>(total.failed),
+                 static_cast<unsigned long long>(total.dropped), static_cast<double>(total.ok) / seconds,
+                 percentile(total.latencies_ms, 50), percentile(total.latencies_ms, 90),
+                 percentile(total.latencies_ms, 99), percentile(total.latencies_ms, 99.9),
+                 total.latencies_ms.empty() ? 0.0 : total.latencies_ms.back());
+    if (state_->unfinished > 0) {
+        std::fprintf(out, "\n%llu flow(s) still waiting for a response after the drain timeout\n",
+                     static_cast<unsigned long long>(state_->unfinished));
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Сценарии пользователя. Каждый — один или несколько запросов подряд;
+// время сценария — от момента, когда он должен был начаться по графику,
+// до последнего ответа (отставание генератора тоже входит во время).
+enum class Flow { Login, Dashboard, List, Detail, Proxy };
+constexpr size_t kFlowCount = 5;
+
+const char* flow_name(Flow flow);
+
+struct LoadOptions {
+    std::string base_url;                  // http://127.0.0.1:18080
+    double rps = 50;                       // сценариев в секунду, открытая модель
+    std::chrono::seconds warmup {3};       // не входит в отчёт
+    std::chrono::seconds duration {30};
+    std::array<double, kFlowCount> weights {1, 3, 3, 2, 2};
+    size_t max_in_flight = 2000;           // больше — сценарий не запускается (dropped)
+    std::chrono::seconds drain_timeout {10};
+};
+
+// "login=1,dashboard=3,..." -> веса; не названные сценарии — 0.
+std::array<double, kFlowCount> parse_flow_weights(const std::string& spec);
+
+// Генератор нагрузки с фиксированной частотой: сценарии запускаются по
+// графику независимо от того, успели ли ответить предыдущие. Запросы идут
+// через общий HTTP-цикл (http_request_async).
+//
+// sessions — значения cookie SESSION авторизованных сессий; сценарий, для
+// которого сессия оказалась потеряна (401 после refresh), передаёт её в
+// reseed — её записывают в Redis заново.
+class LoadGenerator {
+public:
+    LoadGenerator(LoadOptions options,
+                  std::vector<std::string> sessions,
+                  std::function<void(const std::string& session)> reseed);
+
+    void run();
+    void print_report(std::FILE* out) const;
+
+private:
+    LoadOptions options_;
+    std::vector<std::string> sessions_;
+    std::function<void(const std::string&)> reseed_;
+    std::shared_ptr<struct LoadState> state_;
+};
@@ -0,0 +1,189 @@
+// Нагрузочный тест web-client без внешних сервисов: заглушки Auth и Main,
+// RESP-заменитель Redis в процессе (или настоящий Redis, если задан
+// REDIS_HOST), web-client дочерним процессом и генератор нагрузки.
+// Настройки — переменными окружения, см. README («Нагрузочный тест»).
+
+#include "load_generator.hpp"
+#include "mock_redis.hpp"
+#include "mock_upstream.hpp"
+
+#include "http.hpp"
+#include "redis.hpp"
+#include "session.hpp"
+#include "utils.hpp"
+
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern char** environ;
+
+namespace {
+
+// web-client с адресами заглушек; вывод — в файл, чтобы не мешал отчёту.
+pid_t spawn_web_client(const std::string& path, const std::vector<std::string>& overrides, const std::string& log) {
+    // Свои значения — вместо унаследованных с тем же именем.
+    std::vector<std::string> env = overrides;
+    for (char** e = environ; *e; ++e) {
+        const std::string entry = *e;
+        const auto name = entry.substr(0, entry.find('=') + 1);
+        bool overridden = false;
+        for (const auto& o : overrides) overridden = overridden || o.compare(0, name.size(), name) == 0;
+        if (!overridden) env.push_back(entry);
+    }
+    std::vector<char*> envp;
+    for (auto& e : env) envp.push_back(e.data());
+    envp.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, 1, log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    posix_spawn_file_actions_adddup2(&actions, 1, 2);
+
+    std::string program = path;
+    char* argv[] = {program.data(), nullptr};
+    pid_t pid = 0;
+    const int rc = posix_spawn(&pid, path.c_str(), &actions, nullptr, argv, envp.data());
+    posix_spawn_file_actions_destroy(&actions);
+    if (rc != 0) throw std::runtime_error("cannot start " + path + ": " + std::strerror(rc));
+    return pid;
+}
+
+bool wait_ready(const std::string& base_url, std::chrono::seconds timeout, pid_t child) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (child > 0 && waitpid(child, nullptr, WNOHANG) == child) return false;
+        if (http_get(base_url + "/metrics").status == 200) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    return false;
+}
+
+SessionData authorized_session(std::chrono::seconds token_ttl) {
+    const auto tokens = issue_tokens(token_ttl);
+    SessionData data;
+    data.status = "authorized";
+    data.login_token = gen_uuid();
+    data.access_token = tokens.access_token;
+    data.refresh_token = tokens.refresh_token;
+    data.access_exp = std::chrono::duration_cast<std::chrono::seconds>(
+                          std::chrono::system_clock::now().time_since_epoch() + token_ttl).count();
+    return data;
+}
+
+} // namespace
+
+int main() {
+    const auto env_int = [](const char* key, const char* fallback) { return std::stoll(get_env(key, fallback)); };
+
+    const auto auth_port = static_cast<unsigned short>(env_int("MOCK_AUTH_PORT", "18081"));
+    const auto main_port = static_cast<unsigned short>(env_int("MOCK_MAIN_PORT", "18082"));
+    const std::chrono::seconds token_ttl(env_int("MOCK_AUTH_TOKEN_TTL_S", "900"));
+
+    UpstreamProfile auth_defaults;
+    auth_defaults.latency_median = std::chrono::milliseconds(10);
+    auth_defaults.latency_p99 = std::chrono::milliseconds(80);
+    UpstreamProfile main_defaults;
+    main_defaults.latency_median = std::chrono::milliseconds(20);
+    main_defaults.latency_p99 = std::chrono::milliseconds(150);
+    main_defaults.error_rate = 0.005;
+    main_defaults.unauthorized_rate = 0.01;
+
+    // Redis: настоящий по REDIS_HOST или заменитель в этом процессе.
+    std::string redis_host = get_env("REDIS_HOST", "");
+    int redis_port = static_cast<int>(env_int("REDIS_PORT", "6379"));
+    asio::io_context redis_io;
+    std::unique_ptr<MockRedis> mock_redis;
+    std::thread redis_thread;
+    if (redis_host.empty()) {
+        mock_redis = std::make_unique<MockRedis>(redis_io, static_cast<unsigned short>(env_int("MOCK_REDIS_PORT", "0")));
+        redis_host = "127.0.0.1";
+        redis_port = mock_redis->port();
+        redis_thread = std::thread([&redis_io] { redis_io.run(); });
+    }
+
+    int exit_code = 0;
+    {
+        MockAuth auth(auth_port, upstream_profile_from_env("AUTH", auth_defaults),
+                      static_cast<int>(env_int("MOCK_AUTH_PENDING_POLLS", "1")), token_ttl);
+        MockMain main_mock(main_port, upstream_profile_from_env("MAIN", main_defaults),
+                           static_cast<size_t>(env_int("MOCK_MAIN_LIST_SIZE", "50")),
+                           static_cast<size_t>(env_int("MOCK_MAIN_PROXY_BYTES", "16384")));
+
+        // web-client: уже запущенный (LOADTEST_TARGET_URL, должен смотреть на
+        // те же заглушки и Redis) или свой дочерний процесс.
+        std::string base_url = get_env("LOADTEST_TARGET_URL", "");
+        pid_t child = -1;
+        if (base_url.empty()) {
+            const auto port = get_env("WEB_CLIENT_PORT", "18080");
+            child = spawn_web_client(
+                get_env("LOADTEST_WEB_CLIENT", "./web-client"),
+                {
+                    "AUTH_URL=http://127.0.0.1:" + std::to_string(auth_port),
+                    "MAIN_URL=http://127.0.0.1:" + std::to_string(main_port),
+                    "REDIS_HOST=" + redis_host,
+                    "REDIS_PORT=" + std::to_string(redis_port),
+                    "PORT=" + port,
+                },
+                get_env("LOADTEST_WEB_CLIENT_LOG", "web-client-loadtest.log"));
+            base_url = "http://127.0.0.1:" + port;
+        }
+
+        if (!wait_ready(base_url, std::chrono::seconds(15), child)) {
+            std::fprintf(stderr, "web-client at %s did not become ready\n", base_url.c_str());
+            exit_code = 1;
+        } else {
+            // Авторизованные сессии — сразу в Redis, как после входа.
+            RedisClient redis(redis_host, redis_port);
+            const auto session_ttl = std::chrono::seconds(env_int("SESSION_TTL_AUTHORIZED", "86400"));
+            const auto seed = [&](const std::string& session) {
+                redis.set("session:" + session, serialize_session(authorized_session(token_ttl)), session_ttl);
+            };
+            std::vector<std::string> sessions(static_cast<size_t>(env_int("LOADTEST_SESSIONS", "200")));
+            for (auto& session : sessions) {
+                session = gen_uuid();
+                seed(session);
+            }
+
+            LoadOptions options;
+            options.base_url = base_url;
+            options.rps = std::stod(get_env("LOADTEST_RPS", "50"));
+            options.warmup = std::chrono::seconds(env_int("LOADTEST_WARMUP_S", "3"));
+            options.duration = std::chrono::seconds(env_int("LOADTEST_DURATION_S", "30"));
+            options.max_in_flight = static_cast<size_t>(env_int("LOADTEST_MAX_IN_FLIGHT", "2000"));
+            const auto flows = get_env("LOADTEST_FLOWS", "");
+            if (!flows.empty()) options.weights = parse_flow_weights(flows);
+
+            LoadGenerator generator(options, sessions, [&](const std::string& session) {
+                try {
+                    seed(session);
+                } catch (const std::exception& e) {
+                    std::fprintf(stderr, "reseed %s: %s\n", session.c_str(), e.what());
+                }
+            });
+            generator.run();
+            generator.print_report(stdout);
+        }
+
+        if (child > 0) {
+            kill(child, SIGTERM);
+            waitpid(child, nullptr, 0);
+        }
+    }
+
+    if (mock_redis) {
+        redis_io.stop();
+        redis_thread.join();
+    }
+    return exit_code;
+}
@@ -0,0 +1,346 @@
+#include "mock_redis.hpp"
+
+#include "resp.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+
+namespace {
+
+constexpr size_t kReadChunk = 16 * 1024;
+
+std::string simple(std::string_view s) {
+    return "+" + std::string(s) + "\r\n";
+}
+
+std::string error(std::string_view s) {
+    return "-" + std::string(s) + "\r\n";
+}
+
+std::string integer(long long n) {
+    return ":" + std::to_string(n) + "\r\n";
+}
+
+std::string bulk(std::string_view s) {
+    return "$" + std::to_string(s.size()) + "\r\n" + std::string(s) + "\r\n";
+}
+
+std::string null(bool resp3) {
+    return resp3 ? "_\r\n" : "$-1\r\n";
+}
+
+std::string array_head(char type, size_t n) {
+    return type + std::to_string(n) + "\r\n";
+}
+
+std::string upper(std::string s) {
+    for (auto& c : s) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    return s;
+}
+
+std::optional<long long> to_integer(const std::string& s) {
+    try {
+        size_t used = 0;
+        const long long n = std::stoll(s, &used);
+        if (used != s.size()) return std::nullopt;
+        return n;
+    } catch (...) {
+        return std::nullopt;
+    }
+}
+
+} // namespace
+
+// --- Connection ---
+
+class MockRedis::Connection : public std::enable_shared_from_this<Connection> {
+public:
+    Connection(MockRedis& server, asio::ip::tcp::socket socket)
+        : server_(server), socket_(std::move(socket)) {}
+
+    void start() { read(); }
+
+    void send(std::string data) {
+        outbox_ += data;
+        if (!writing_) write();
+    }
+
+    bool resp3 = false;
+    std::vector<std::string> tracking_prefixes; // пусто — инвалидации не нужны
+    std::optional<std::vector<Args>> multi;     // открыт MULTI — очередь команд
+
+private:
+    void read() {
+        char* buf = reader_.prepare(kReadChunk);
+        socket_.async_read_some(asio::buffer(buf, kReadChunk),
+            [self = shared_from_this()](const asio::error_code& ec, size_t n) {
+                if (ec) return;
+                self->reader_.commit(n);
+
+                std::string replies;
+                try {
+                    RespValue v;
+                    while (self->reader_.next(v)) {
+                        if (v.type != RespValue::Type::Array || v.elements.empty()) {
+                            replies += error("ERR only RESP arrays are supported");
+                            continue;
+                        }
+                        Args args;
+                        args.reserve(v.elements.size());
+                        for (const auto& e : v.elements) args.emplace_back(e.str);
+                        replies += self->server_.execute(*self, args);
+                    }
+                } catch (const std::exception&) {
+                    asio::error_code ignored;
+                    self->socket_.close(ignored);
+                    return;
+                }
+                if (!replies.empty()) self->send(std::move(replies));
+                self->read();
+            });
+    }
+
+    void write() {
+        writing_ = true;
+        sending_.swap(outbox_);
+        outbox_.clear();
+        asio::async_write(socket_, asio::buffer(sending_),
+            [self = shared_from_this()](const asio::error_code& ec, size_t) {
+                self->writing_ = false;
+                if (ec) return;
+                if (!self->outbox_.empty()) self->write();
+            });
+    }
+
+    MockRedis& server_;
+    asio::ip::tcp::socket socket_;
+    RespReader reader_;
+    std::string outbox_;
+    std::string sending_;
+    bool writing_ = false;
+};
+
+// --- MockRedis ---
+
+MockRedis::MockRedis(asio::io_context& io, unsigned short port)
+    : acceptor_(io, asio::ip::tcp::endpoint(asio::ip::make_address("127.0.0.1"), port)),
+      port_(acceptor_.local_endpoint().port()) {
+    accept();
+}
+
+void MockRedis::accept() {
+    acceptor_.async_accept([this](const asio::error_code& ec, asio::ip::tcp::socket socket) {
+        if (ec) return;
+        asio::error_code ignored;
+        socket.set_option(asio::ip::tcp::no_delay(true), ignored);
+        std::make_shared<Connection>(*this, std::move(socket))->start();
+        accept();
+    });
+}
+
+MockRedis::Entry* MockRedis::find(const std::string& key) {
+    auto it = data_.find(key);
+    if (it == data_.end()) return nullptr;
+    if (it->second.expires != Clock::time_point {} && it->second.expires <= Clock::now()) {
+        data_.erase(it);
+        touched(key);
+        return nullptr;
+    }
+    return &it->second;
+}
+
+void MockRedis::set(const std::string& key, std::string value, Clock::time_point expires) {
+    data_[key] = Entry{std::move(value), expires};
+    touched(key);
+}
+
+bool MockRedis::erase(const std::string& key) {
+    if (!find(key)) return false;
+    data_.erase(key);
+    touched(key);
+    return true;
+}
+
+void MockRedis::touched(const std::string& key) {
+    std::string push;
+    for (size_t i = 0; i < tracking_.size();) {
+        auto conn = tracking_[i].lock();
+        if (!conn) {
+            tracking_[i] = std::move(tracking_.back());
+            tracking_.pop_back();
+            continue;
+        }
+        ++i;
+        for (const auto& prefix : conn->tracking_prefixes) {
+            if (key.compare(0, prefix.size(), prefix) != 0) continue;
+            if (push.empty()) push = array_head('>', 2) + bulk("invalidate") + array_head('*', 1) + bulk(key);
+            conn->send(push);
+            break;
+        }
+    }
+}
+
+std::string MockRedis::execute(Connection& conn, const Args& args) {
+    const auto name = upper(args[0]);
+
+    if (conn.multi) {
+        if (name == "EXEC") {
+            auto queued = std::move(*conn.multi);
+            conn.multi.reset();
+            std::string out = array_head('*', queued.size());
+            for (const auto& cmd : queued) out += execute_one(conn, cmd);
+            return out;
+        }
+        if (name == "DISCARD") {
+            conn.multi.reset();
+            return simple("OK");
+        }
+        if (name == "MULTI") return error("ERR MULTI calls can not be nested");
+        conn.multi->push_back(args);
+        return simple("QUEUED");
+    }
+
+    if (name == "MULTI") {
+        conn.multi.emplace();
+        return simple("OK");
+    }
+    if (name == "EXEC" || name == "DISCARD") return error("ERR " + name + " without MULTI");
+    return execute_one(conn, args);
+}
+
+std::string MockRedis::execute_one(Connection& conn, const Args& args) {
+    const auto name = upper(args[0]);
+    const size_t argc = args.size();
+    const auto wrong_args = [&] { return error("ERR wrong number of arguments for '" + args[0] + "' command"); };
+
+    if (name == "PING") return simple("PONG");
+
+    if (name == "HELLO") {
+        if (argc >= 2) {
+            if (args[1] != "2" && args[1] != "3") return error("NOPROTO unsupported protocol version");
+            conn.resp3 = args[1] == "3";
+        }
+        const size_t fields = 3;
+        std::string out = conn.resp3 ? array_head('%', fields) : array_head('*', fields * 2);
+        out += bulk("server") + bulk("redis");
+        out += bulk("version") + bulk("7.2.0");
+        out += bulk("proto") + integer(conn.resp3 ? 3 : 2);
+        return out;
+    }
+
+    if (name == "CLIENT") {
+        if (argc >= 3 && upper(args[1]) == "TRACKING") {
+            if (upper(args[2]) != "ON") {
+                conn.tracking_prefixes.clear();
+                return simple("OK");
+            }
+            std::vector<std::string> prefixes;
+            for (size_t i = 3; i + 1 < argc; ++i) {
+                if (upper(args[i]) == "PREFIX") prefixes.push_back(args[++i]);
+            }
+            if (prefixes.empty()) prefixes.emplace_back(); // BCAST без PREFIX — все ключи
+            if (conn.tracking_prefixes.empty()) tracking_.push_back(conn.weak_from_this());
+            conn.tracking_prefixes = std::move(prefixes);
+            return simple("OK");
+        }
+        return simple("OK");
+    }
+
+    if (name == "GET") {
+        if (argc != 2) return wrong_args();
+        const auto* e = find(args[1]);
+        return e ? bulk(e->value) : null(conn.resp3);
+    }
+
+    if (name == "SET") {
+        if (argc < 3) return wrong_args();
+        Clock::time_point expires {};
+        bool nx = false;
+        bool xx = false;
+        for (size_t i = 3; i < argc; ++i) {
+            const auto opt = upper(args[i]);
+            if ((opt == "EX" || opt == "PX") && i + 1 < argc) {
+                const auto n = to_integer(args[++i]);
+                if (!n || *n <= 0) return error("ERR invalid expire time in 'set' command");
+                expires = Clock::now() + (opt == "EX" ? std::chrono::milliseconds(*n * 1000)
+                                                      : std::chrono::milliseconds(*n));
+            } else if (opt == "NX") {
+                nx = true;
+            } else if (opt == "XX") {
+                xx = true;
+            } else {
+                return error("ERR syntax error");
+            }
+        }
+        const bool exists = find(args[1]) != nullptr;
+        if ((nx && exists) || (xx && !exists)) return null(conn.resp3);
+        set(args[1], args[2], expires);
+        return simple("OK");
+    }
+
+    if (name == "DEL") {
+        if (argc < 2) return wrong_args();
+        long long removed = 0;
+        for (size_t i = 1; i < argc; ++i) removed += erase(args[i]) ? 1 : 0;
+        return integer(removed);
+    }
+
+    if (name == "EXPIRE") {
+        if (argc != 3) return wrong_args();
+        const auto seconds = to_integer(args[2]);
+        if (!seconds) return error("ERR value is not an integer or out of range");
+        auto* e = find(args[1]);
+        if (!e) return integer(0);
+        if (*seconds <= 0) {
+            erase(args[1]);
+        } else {
+            e->expires = Clock::now() + std::chrono::seconds(*seconds);
+            touched(args[1]);
+        }
+        return integer(1);
+    }
+
+    if (name == "PERSIST") {
+        if (argc != 2) return wrong_args();
+        auto* e = find(args[1]);
+        if (!e || e->expires == Clock::time_point {}) return integer(0);
+        e->expires = {};
+        touched(args[1]);
+        return integer(1);
+    }
+
+    if (name == "PTTL") {
+        if (argc != 2) return wrong_args();
+        const auto* e = find(args[1]);
+        if (!e) return integer(-2);
+        if (e->expires == Clock::time_point {}) return integer(-1);
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(e->expires - Clock::now());
+        return integer(std::max<long long>(left.count(), 0));
+    }
+
+    if (name == "EVAL") {
+        // EVAL script 1 key ARGV...
+        if (argc < 5 || args[2] != "1") return wrong_args();
+        const auto& script = args[1];
+        const auto& key = args[3];
+        const auto* e = find(key);
+
+        // session_refresh: снять блокировку, если она ещё наша.
+        if (script.find("redis.call('del'") != std::string::npos) {
+            if (!e || e->value != args[4]) return integer(0);
+            erase(key);
+            return integer(1);
+        }
+        // session_store: записать, если значение не изменилось с чтения.
+        if (script.find("redis.call('set'") != std::string::npos && argc == 7) {
+            if (!e || e->value != args[4]) return integer(0);
+            const auto ttl = to_integer(args[6]).value_or(0);
+            set(key, args[5], ttl > 0 ? Clock::now() + std::chrono::seconds(ttl) : Clock::time_point {});
+            return integer(1);
+        }
+        return error("ERR script is not supported by the mock");
+    }
+
+    return error("ERR unknown command '" + args[0] + "'");
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <asio.hpp>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Заменитель Redis для нагрузочного теста: RESP-сервер в процессе, один
+// поток (io_context), данные в памяти. Поддержано ровно то, что шлёт
+// web-client: GET/SET (EX/PX/NX/XX), DEL, EXPIRE, PERSIST, PTTL, MULTI/EXEC,
+// PING, HELLO 2|3, CLIENT TRACKING ... BCAST PREFIX (инвалидации RESP3 Push) и
+// два его Lua-скрипта в EVAL (сравнить-и-удалить, сравнить-и-записать) —
+// скрипты не исполняются, а узнаются по тексту.
+class MockRedis {
+public:
+    MockRedis(asio::io_context& io, unsigned short port);
+
+    unsigned short port() const { return port_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    using Args = std::vector<std::string>;
+
+    struct Entry {
+        std::string value;
+        Clock::time_point expires {}; // {} — без срока
+    };
+
+    class Connection;
+
+    void accept();
+
+    std::string execute(Connection& conn, const Args& args);
+    std::string execute_one(Connection& conn, const Args& args);
+
+    Entry* find(const std::string& key);
+    void set(const std::string& key, std::string value, Clock::time_point expires);
+    bool erase(const std::string& key);
+    // Ключ изменён или удалён — инвалидация подписанным соединениям.
+    void touched(const std::string& key);
+
+    asio::ip::tcp::acceptor acceptor_;
+    unsigned short port_;
+    std::unordered_map<std::string, Entry> data_;
+    std::vector<std::weak_ptr<Connection>> tracking_;
+};
@@ -0,0 +1,311 @@
+#include "mock_upstream.hpp"
+
+#include "utils.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <random>
+
+namespace {
+
+std::mt19937_64& rng() {
+    thread_local std::mt19937_64 instance(std::random_device{}());
+    return instance;
+}
+
+bool roll(double probability) {
+    if (probability <= 0) return false;
+    return std::uniform_real_distribution<double>(0, 1)(rng()) < probability;
+}
+
+std::chrono::microseconds sample_latency(const UpstreamProfile& profile) {
+    const double median = static_cast<double>(profile.latency_median.count()) * 1000;
+    const double p99 = static_cast<double>(profile.latency_p99.count()) * 1000;
+    if (median <= 0) return std::chrono::microseconds(0);
+    if (p99 <= median) return std::chrono::microseconds(static_cast<long long>(median));
+
+    // ln X ~ N(ln median, sigma), p99 — при z = 2.326.
+    const double sigma = std::log(p99 / median) / 2.326;
+    const double z = std::normal_distribution<double>(0, 1)(rng());
+    return std::chrono::microseconds(static_cast<long long>(median * std::exp(sigma * z)));
+}
+
+std::string path_only(const std::string& url) {
+    return url.substr(0, url.find('?'));
+}
+
+std::string base64url(std::string_view in) {
+    static const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    std::string out;
+    out.reserve((in.size() + 2) / 3 * 4);
+    uint32_t acc = 0;
+    int bits = 0;
+    for (unsigned char c : in) {
+        acc = (acc << 8) | c;
+        bits += 8;
+        while (bits >= 6) {
+            bits -= 6;
+            out += kAlphabet[(acc >> bits) & 0x3f];
+        }
+    }
+    if (bits > 0) out += kAlphabet[(acc << (6 - bits)) & 0x3f];
+    return out;
+}
+
+// Ответ уходит через delay; res живёт, пока не вызван end().
+void respond_later(Delayer& delayer, const UpstreamProfile& profile, crow::response& res,
+                   int code, std::string body) {
+    delayer.after(sample_latency(profile), [&res, code, body = std::move(body)]() mutable {
+        res.code = code;
+        res.set_header("Content-Type", "application/json");
+        res.body = std::move(body);
+        res.end();
+    });
+}
+
+int server_error() {
+    static const int kCodes[] = {500, 502, 503};
+    return kCodes[rng()() % 3];
+}
+
+} // namespace
+
+UpstreamProfile upstream_profile_from_env(const std::string& service, UpstreamProfile fallback) {
+    const auto prefix = "MOCK_" + service + "_";
+    UpstreamProfile profile = fallback;
+
+    const auto latency = get_env((prefix + "LATENCY_MS").c_str(), "");
+    if (!latency.empty()) {
+        const auto comma = latency.find(',');
+        profile.latency_median = std::chrono::milliseconds(std::stoll(latency.substr(0, comma)));
+        profile.latency_p99 = comma == std::string::npos
+            ? profile.latency_median
+            : std::chrono::milliseconds(std::stoll(latency.substr(comma + 1)));
+    }
+    profile.error_rate = std::stod(get_env((prefix + "ERROR_RATE").c_str(), std::to_string(profile.error_rate)));
+    profile.unauthorized_rate =
+        std::stod(get_env((prefix + "401_RATE").c_str(), std::to_string(profile.unauthorized_rate)));
+    return profile;
+}
+
+// --- Delayer ---
+
+Delayer::Delayer() : thread_([this] { run(); }) {}
+
+Delayer::~Delayer() {
+    stop();
+}
+
+void Delayer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (stopping_) return;
+        stopping_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+}
+
+void Delayer::after(Clock::duration delay, std::function<void()> fn) {
+    if (delay <= Clock::duration::zero()) {
+        fn();
+        return;
+    }
+    bool earliest = false;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        const auto due = Clock::now() + delay;
+        earliest = queue_.empty() || due < queue_.top().due;
+        queue_.push(Item{due, std::move(fn)});
+    }
+    if (earliest) cv_.notify_one();
+}
+
+void Delayer::run() {
+    std::unique_lock<std::mutex> lock(mu_);
+    while (!stopping_) {
+        if (queue_.empty()) {
+            cv_.wait(lock);
+            continue;
+        }
+        const auto due = queue_.top().due;
+        if (Clock::now() < due) {
+            cv_.wait_until(lock, due);
+            continue;
+        }
+        auto fn = std::move(const_cast<Item&>(queue_.top()).fn);
+        queue_.pop();
+        lock.unlock();
+        fn();
+        lock.lock();
+    }
+}
+
+// --- tokens ---
+
+MockTokens issue_tokens(std::chrono::seconds ttl) {
+    static std::atomic<uint64_t> next_id {1};
+    const uint64_t id = next_id++;
+    const auto exp = std::chrono::duration_cast<std::chrono::seconds>(
+                         std::chrono::system_clock::now().time_since_epoch() + ttl).count();
+
+    static const std::string header = base64url(R"({"alg":"none","typ":"JWT"})");
+    const auto payload = base64url("{\"sub\":\"user-" + std::to_string(id % 1000) + "\",\"exp\":"
+                                   + std::to_string(exp) + ",\"jti\":" + std::to_string(id) + "}");
+    return MockTokens{header + "." + payload + ".mock", "mock-refresh-" + std::to_string(id)};
+}
+
+// --- MockAuth ---
+
+MockAuth::MockAuth(unsigned short port, UpstreamProfile profile, int pending_polls, std::chrono::seconds token_ttl)
+    : profile_(profile), pending_polls_(pending_polls), token_ttl_(token_ttl) {
+    CROW_CATCHALL_ROUTE(app_)([this](const crow::request& req, crow::response& res) {
+        handle(req, res);
+    });
+    app_.bindaddr("127.0.0.1").port(port).concurrency(2);
+    thread_ = std::thread([this] { app_.run(); });
+    app_.wait_for_server_start();
+}
+
+MockAuth::~MockAuth() {
+    // Сначала отложенные ответы: после остановки сервера их соединений нет.
+    delayer_.stop();
+    app_.stop();
+    thread_.join();
+}
+
+void MockAuth::handle(const crow::request& req, crow::response& res) {
+    if (roll(profile_.error_rate)) {
+        respond_later(delayer_, profile_, res, server_error(), R"({"error":"unavailable"})");
+        return;
+    }
+
+    const auto path = path_only(req.url);
+    if (path == "/auth/oauth/start") {
+        const char* token_login = req.url_params.get("token_login");
+        respond_later(delayer_, profile_, res, 200,
+                      std::string(R"({"url":"https://oauth.invalid/authorize?state=)") + (token_login ? token_login : "")
+                          + "\"}");
+        return;
+    }
+    if (path == "/auth/code/start") {
+        respond_later(delayer_, profile_, res, 200, R"({"code":")" + std::to_string(100000 + rng()() % 900000) + "\"}");
+        return;
+    }
+    if (path == "/auth/status") {
+        const char* token_login = req.url_params.get("token_login");
+        if (!token_login) {
+            respond_later(delayer_, profile_, res, 400, R"({"error":"token_login required"})");
+            return;
+        }
+        bool pending = false;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            auto& polls = polls_[token_login];
+            pending = polls++ < pending_polls_;
+            if (!pending) polls_.erase(token_login);
+        }
+        if (pending) {
+            respond_later(delayer_, profile_, res, 200, R"({"status":"pending"})");
+            return;
+        }
+        const auto tokens = issue_tokens(token_ttl_);
+        respond_later(delayer_, profile_, res, 200,
+                      R"({"status":"approved","access_token":")" + tokens.access_token
+                          + R"(","refresh_token":")" + tokens.refresh_token + "\"}");
+        return;
+    }
+    if (path == "/auth/refresh") {
+        if (roll(profile_.unauthorized_rate)) {
+            respond_later(delayer_, profile_, res, 401, R"({"error":"invalid_grant"})");
+            return;
+        }
+        const auto tokens = issue_tokens(token_ttl_);
+        respond_later(delayer_, profile_, res, 200,
+                      R"({"access_token":")" + tokens.access_token + R"(","refresh_token":")"
+                          + tokens.refresh_token + "\"}");
+        return;
+    }
+    respond_later(delayer_, profile_, res, 404, R"({"error":"not found"})");
+}
+
+// --- MockMain ---
+
+MockMain::MockMain(unsigned short port, UpstreamProfile profile, size_t list_size, size_t proxy_bytes)
+    : profile_(profile) {
+    courses_ = "{\"items\":[";
+    users_ = "[";
+    for (size_t i = 0; i < list_size; ++i) {
+        if (i) {
+            courses_ += ',';
+            users_ += ',';
+        }
+        courses_ += "{\"course_id\":" + std::to_string(1000 + i) + ",\"name\":\"Курс " + std::to_string(i)
+            + "\",\"description\":\"Лекции, практика и домашние задания, семестр " + std::to_string(1 + i % 8)
+            + "\",\"teacher_id\":" + std::to_string(i % 40) + "}";
+        users_ += "{\"id\":" + std::to_string(i) + ",\"fullName\":\"Пользователь " + std::to_string(i)
+            + "\",\"email\":\"user" + std::to_string(i) + "@example.invalid\",\"role\":\"student\"}";
+    }
+    courses_ += "]}";
+    users_ += "]";
+    notifications_ = R"({"items":[{"id":1,"text":"Новое задание по курсу 1000"},{"id":2,"text":"Оценка выставлена"}]})";
+    proxy_body_.assign(proxy_bytes, 'x');
+
+    CROW_CATCHALL_ROUTE(app_)([this](const crow::request& req, crow::response& res) {
+        handle(req, res);
+    });
+    app_.bindaddr("127.0.0.1").port(port).concurrency(2);
+    thread_ = std::thread([this] { app_.run(); });
+    app_.wait_for_server_start();
+}
+
+MockMain::~MockMain() {
+    delayer_.stop();
+    app_.stop();
+    thread_.join();
+}
+
+void MockMain::handle(const crow::request& req, crow::response& res) {
+    if (roll(profile_.error_rate)) {
+        respond_later(delayer_, profile_, res, server_error(), R"({"error":"unavailable"})");
+        return;
+    }
+
+    const auto& auth = req.get_header_value("Authorization");
+    const std::string bearer = "Bearer ";
+    bool unauthorized = auth.compare(0, bearer.size(), bearer) != 0;
+    if (!unauthorized) {
+        const auto token = auth.substr(bearer.size());
+        std::lock_guard<std::mutex> lock(mu_);
+        if (revoked_.count(token)) {
+            unauthorized = true;
+        } else if (roll(profile_.unauthorized_rate)) {
+            revoked_.insert(token);
+            unauthorized = true;
+        }
+    }
+    if (unauthorized) {
+        respond_later(delayer_, profile_, res, 401, R"({"error":"unauthorized"})");
+        return;
+    }
+
+    const auto path = path_only(req.url);
+    if (path == "/courses_list") {
+        respond_later(delayer_, profile_, res, 200, courses_);
+    } else if (path == "/users_list") {
+        respond_later(delayer_, profile_, res, 200, users_);
+    } else if (path == "/notification") {
+        respond_later(delayer_, profile_, res, 200, notifications_);
+    } else if (path == "/course_get") {
+        const char* id = req.url_params.get("course_id");
+        respond_later(delayer_, profile_, res, 200,
+                      std::string("{\"course_id\":") + (id ? id : "0")
+                          + ",\"name\":\"Курс\",\"description\":\"Программа курса, материалы и сроки сдачи\"}");
+    } else if (path == "/user_get") {
+        const char* id = req.url_params.get("id");
+        respond_later(delayer_, profile_, res, 200,
+                      std::string("{\"id\":") + (id ? id : "0") + ",\"fullName\":\"Пользователь\",\"role\":\"student\"}");
+    } else {
+        respond_later(delayer_, profile_, res, 200, proxy_body_);
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <crow.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Поведение заглушки upstream: задержка ответа — логнормальная по медиане
+// и p99 (длинный хвост, как у настоящих сервисов), доля 5xx и доля 401.
+struct UpstreamProfile {
+    std::chrono::milliseconds latency_median {5};
+    std::chrono::milliseconds latency_p99 {50};
+    double error_rate = 0.0;        // 500/502/503
+    double unauthorized_rate = 0.0; // 401: у Main — отзыв токена, у Auth — отказ в refresh
+};
+
+// MOCK_<SERVICE>_LATENCY_MS="медиана,p99", MOCK_<SERVICE>_ERROR_RATE,
+// MOCK_<SERVICE>_401_RATE; service — "AUTH" или "MAIN".
+UpstreamProfile upstream_profile_from_env(const std::string& service, UpstreamProfile fallback);
+
+// Откладывает завершение ответов: задержка не занимает worker-потоки Crow,
+// так что тысячи медленных ответов в полёте не упираются в их число.
+class Delayer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    Delayer();
+    ~Delayer();
+
+    Delayer(const Delayer&) = delete;
+    Delayer& operator=(const Delayer&) = delete;
+
+    void after(Clock::duration delay, std::function<void()> fn);
+    // Останавливает поток; ещё не наступившие вызовы выбрасываются.
+    void stop();
+
+private:
+    struct Item {
+        Clock::time_point due;
+        std::function<void()> fn;
+        bool operator>(const Item& other) const { return due > other.due; }
+    };
+
+    void run();
+
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+// Токены в формате JWT (exp и sub в payload, подпись фиктивная) — web-client
+// читает из них exp, чтобы обновлять заранее.
+struct MockTokens {
+    std::string access_token;
+    std::string refresh_token;
+};
+MockTokens issue_tokens(std::chrono::seconds ttl);
+
+// Заглушка Auth: oauth/code start, status (pending_polls раз «pending»,
+// затем «approved» с токенами), refresh.
+class MockAuth {
+public:
+    MockAuth(unsigned short port, UpstreamProfile profile, int pending_polls, std::chrono::seconds token_ttl);
+    ~MockAuth();
+
+private:
+    void handle(const crow::request& req, crow::response& res);
+
+    UpstreamProfile profile_;
+    int pending_polls_;
+    std::chrono::seconds token_ttl_;
+    Delayer delayer_;
+    std::mutex mu_;
+    std::unordered_map<std::string, int> polls_; // token_login -> ответов «pending»
+    crow::SimpleApp app_;
+    std::thread thread_;
+};
+
+// Заглушка Main: списки курсов и пользователей по list_size элементов,
+// уведомления, карточки, остальные пути — тело proxy_bytes байт (прокси).
+// 401 отзывает токен: повтор с ним снова 401, пока web-client не обновит.
+class MockMain {
+public:
+    MockMain(unsigned short port, UpstreamProfile profile, size_t list_size, size_t proxy_bytes);
+    ~MockMain();
+
+private:
+    void handle(const crow::request& req, crow::response& res);
+
+    UpstreamProfile profile_;
+    std::string courses_;
+    std::string users_;
+    std::string notifications_;
+    std::string proxy_body_;
+    Delayer delayer_;
+    std::mutex mu_;
+    std::unordered_set<std::string> revoked_;
+    crow::SimpleApp app_;
+    std::thread thread_;
+};
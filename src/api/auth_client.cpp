@@ -1,12 +1,149 @@
 #include "auth_client.hpp"
 #include "../http.hpp"
+#include "../json_scan.hpp"
 #include <nlohmann/json.hpp>
+#include <chrono>
 #include <sstream>
 #include <iomanip>
 #include <cctype>
 
-AuthClient::AuthClient(std::string base_url)
-    : base(TrimRightSlash(std::move(base_url))) {}
+namespace {
+using FieldType = JsonField::Type;
+
+// Ответы с не-строковыми полями (и непринятые быстрым разбором) идут
+// прежним путём через nlohmann.
+bool StringsOrMissing(const JsonFields& fields) {
+    for (const auto& field : fields) {
+        if (field.type != FieldType::Missing && field.type != FieldType::String) return false;
+    }
+    return true;
+}
+
+// Строковое поле или "", если его нет; другой тип — false (j.value(key, "")
+// на нём бросил бы type_error).
+bool OptionalString(const nlohmann::json& j, const char* key, std::string& out) {
+    auto it = j.find(key);
+    if (it == j.end() || it->is_null()) return true;
+    if (!it->is_string()) return false;
+    out = it->get<std::string>();
+    return true;
+}
+
+std::optional<AuthStatus> ParseStatusDom(const HttpResponse& resp) {
+    auto j = nlohmann::json::parse(resp.body, nullptr, false);
+    if (j.is_discarded() || !j.is_object()) return std::nullopt;
+
+    AuthStatus out;
+    if (!OptionalString(j, "status", out.status) || !OptionalString(j, "access_token", out.access_token)
+        || !OptionalString(j, "refresh_token", out.refresh_token) || !OptionalString(j, "reason", out.reason)) {
+        return std::nullopt;
+    }
+    return out;
+}
+
+std::optional<AuthStatus> ParseStatus(const HttpResponse& resp) {
+    if (resp.status != 200) return std::nullopt;
+
+    static const std::vector<std::string> keys = {"status", "access_token", "refresh_token", "reason"};
+    auto fields = json_scan_object(resp.body, keys);
+    if (!fields || !StringsOrMissing(*fields)) return ParseStatusDom(resp);
+
+    AuthStatus out;
+    out.status = std::move((*fields)[0].text);
+    out.access_token = std::move((*fields)[1].text);
+    out.refresh_token = std::move((*fields)[2].text);
+    out.reason = std::move((*fields)[3].text);
+    return out;
+}
+
+std::optional<AuthRefresh> ParseRefreshDom(const HttpResponse& resp) {
+    auto j = nlohmann::json::parse(resp.body, nullptr, false);
+    if (j.is_discarded() || !j.is_object()) return std::nullopt;
+
+    AuthRefresh out;
+    if (!OptionalString(j, "access_token", out.access_token)
+        || !OptionalString(j, "refresh_token", out.refresh_token)) {
+        return std::nullopt;
+    }
+    if (out.access_token.empty() || out.refresh_token.empty()) return std::nullopt;
+    return out;
+}
+
+std::optional<AuthRefresh> ParseRefresh(const HttpResponse& resp) {
+    if (resp.status != 200) return std::nullopt;
+
+    static const std::vector<std::string> keys = {"access_token", "refresh_token"};
+    auto fields = json_scan_object(resp.body, keys);
+    if (!fields || !StringsOrMissing(*fields)) return ParseRefreshDom(resp);
+
+    AuthRefresh out;
+    out.access_token = std::move((*fields)[0].text);
+    out.refresh_token = std::move((*fields)[1].text);
+    if (out.access_token.empty() || out.refresh_token.empty()) return std::nullopt;
+    return out;
+}
+
+// Строковое поле key корневого объекта; не строка или нет — nullopt.
+std::optional<std::string> StringField(const std::string& body, const std::string& key) {
+    if (auto fields = json_scan_object(body, {key})) {
+        auto& field = (*fields)[0];
+        if (field.type != FieldType::String) return std::nullopt;
+        return std::move(field.text);
+    }
+
+    auto j = nlohmann::json::parse(body, nullptr, false);
+    if (j.is_discarded() || !j.is_object()) return std::nullopt;
+
+    auto it = j.find(key);
+    if (it == j.end() || !it->is_string()) return std::nullopt;
+
+    return it->get<std::string>();
+}
+
+// Разбор для колбэков: что бы ни бросил разбор, вызывающий получает ровно
+// один результат (nullopt), иначе исключение ушло бы в цикл HTTP и колбэк
+// потерялся.
+template <typename T>
+std::optional<T> ParseSafely(std::optional<T> (*parse)(const HttpResponse&), const HttpResponse& resp,
+                             const char* call) {
+    try {
+        return parse(resp);
+    } catch (const std::exception& e) {
+        CROW_LOG_WARNING << "auth " << call << ": bad response: " << e.what();
+        return std::nullopt;
+    }
+}
+
+// Синхронный и асинхронный варианты пишут в один ряд.
+const UpstreamCall& StatusMetrics() {
+    static const UpstreamCall upstream("auth", "Status");
+    return upstream;
+}
+
+const UpstreamCall& RefreshMetrics() {
+    static const UpstreamCall upstream("auth", "Refresh");
+    return upstream;
+}
+
+// Запрос в Auth: участок trace называется "auth".
+HttpRequest AuthRequest(const char* method, std::string url, const HttpTimeouts& timeouts) {
+    HttpRequest req;
+    req.method = method;
+    req.url = std::move(url);
+    req.span = "auth";
+    req.timeouts = timeouts;
+    return req;
+}
+
+std::string RefreshBody(const std::string& refresh_token) {
+    nlohmann::json body;
+    body["refresh_token"] = refresh_token;
+    return body.dump();
+}
+} // namespace
+
+AuthClient::AuthClient(std::string base_url, HttpTimeouts timeouts)
+    : base(TrimRightSlash(std::move(base_url))), timeouts(timeouts) {}
 
 std::string AuthClient::TrimRightSlash(std::string s) {
     while (!s.empty() && s.back() == '/') s.pop_back();
@@ -27,70 +164,79 @@ std::string AuthClient::UrlEncode(const std::string& s) {
 }
 
 std::optional<std::string> AuthClient::StartOAuth(const std::string& provider,
-                                                  const std::string& token_login) {
+                                                  const std::string& token_login) const {
+    static const UpstreamCall upstream("auth", "StartOAuth");
+    const auto started = std::chrono::steady_clock::now();
+
     std::string url = base + "/auth/oauth/start?provider=" + UrlEncode(provider)
                     + "&token_login=" + UrlEncode(token_login);
 
-    auto resp = http_request("POST", url, "", {});
-    if (resp.status != 200) return std::nullopt;
-
-    auto j = nlohmann::json::parse(resp.body, nullptr, false);
-    if (j.is_discarded() || !j.is_object()) return std::nullopt;
-
-    auto it = j.find("url");
-    if (it == j.end() || !it->is_string()) return std::nullopt;
-
-    return it->get<std::string>();
+    auto resp = http_request(AuthRequest("POST", std::move(url), timeouts));
+    auto result = resp.status == 200 ? StringField(resp.body, "url") : std::nullopt;
+    upstream.done(started, result.has_value());
+    return result;
 }
 
-std::optional<std::string> AuthClient::StartCode(const std::string& token_login) {
-    std::string url = base + "/auth/code/start?token_login=" + UrlEncode(token_login);
-
-    auto resp = http_request("POST", url, "", {});
-    if (resp.status != 200) return std::nullopt;
-
-    auto j = nlohmann::json::parse(resp.body, nullptr, false);
-    if (j.is_discarded() || !j.is_object()) return std::nullopt;
+std::optional<std::string> AuthClient::StartCode(const std::string& token_login) const {
+    static const UpstreamCall upstream("auth", "StartCode");
+    const auto started = std::chrono::steady_clock::now();
 
-    auto it = j.find("code");
-    if (it == j.end() || !it->is_string()) return std::nullopt;
+    std::string url = base + "/auth/code/start?token_login=" + UrlEncode(token_login);
 
-    return it->get<std::string>();
+    auto resp = http_request(AuthRequest("POST", std::move(url), timeouts));
+    auto result = resp.status == 200 ? StringField(resp.body, "code") : std::nullopt;
+    upstream.done(started, result.has_value());
+    return result;
 }
 
-std::optional<AuthStatus> AuthClient::Status(const std::string& token_login) {
+std::optional<AuthStatus> AuthClient::Status(const std::string& token_login) const {
+    const auto started = std::chrono::steady_clock::now();
     std::string url = base + "/auth/status?token_login=" + UrlEncode(token_login);
 
-    auto resp = http_request("GET", url, "", {});
-    if (resp.status != 200) return std::nullopt;
+    auto result = ParseSafely(ParseStatus, http_request(AuthRequest("GET", std::move(url), timeouts)), "Status");
+    StatusMetrics().done(started, result.has_value());
+    return result;
+}
 
-    auto j = nlohmann::json::parse(resp.body, nullptr, false);
-    if (j.is_discarded() || !j.is_object()) return std::nullopt;
+std::optional<AuthRefresh> AuthClient::Refresh(const std::string& refresh_token) const {
+    if (refresh_token.empty()) return std::nullopt;
 
-    AuthStatus out;
-    out.status = j.value("status", "");
-    out.access_token = j.value("access_token", "");
-    out.refresh_token = j.value("refresh_token", "");
-    out.reason = j.value("reason", "");
-    return out;
+    const auto started = std::chrono::steady_clock::now();
+    auto req = AuthRequest("POST", base + "/auth/refresh", timeouts);
+    req.body = RefreshBody(refresh_token);
+    req.headers.push_back("Content-Type: application/json");
+    auto result = ParseSafely(ParseRefresh, http_request(req), "Refresh");
+    RefreshMetrics().done(started, result.has_value());
+    return result;
 }
 
-std::optional<AuthRefresh> AuthClient::Refresh(const std::string& refresh_token) {
-    if (refresh_token.empty()) return std::nullopt;
+void AuthClient::StatusAsync(const std::string& token_login,
+                             std::function<void(std::optional<AuthStatus>)> on_done) const {
+    auto req = AuthRequest("GET", base + "/auth/status?token_login=" + UrlEncode(token_login), timeouts);
 
-    nlohmann::json body;
-    body["refresh_token"] = refresh_token;
+    http_request_async(std::move(req), [on_done = std::move(on_done),
+                                        started = std::chrono::steady_clock::now()](HttpResponse resp) {
+        auto result = ParseSafely(ParseStatus, resp, "Status");
+        StatusMetrics().done(started, result.has_value());
+        on_done(std::move(result));
+    });
+}
 
-    std::string url = base + "/auth/refresh";
-    auto resp = http_post_json(url, body.dump(), {});
-    if (resp.status != 200) return std::nullopt;
+void AuthClient::RefreshAsync(const std::string& refresh_token,
+                              std::function<void(std::optional<AuthRefresh>)> on_done) const {
+    if (refresh_token.empty()) {
+        on_done(std::nullopt);
+        return;
+    }
 
-    auto j = nlohmann::json::parse(resp.body, nullptr, false);
-    if (j.is_discarded() || !j.is_object()) return std::nullopt;
+    auto req = AuthRequest("POST", base + "/auth/refresh", timeouts);
+    req.body = RefreshBody(refresh_token);
+    req.headers.push_back("Content-Type: application/json");
 
-    AuthRefresh out;
-    out.access_token = j.value("access_token", "");
-    out.refresh_token = j.value("refresh_token", "");
-    if (out.access_token.empty() || out.refresh_token.empty()) return std::nullopt;
-    return out;
+    http_request_async(std::move(req), [on_done = std::move(on_done),
+                                        started = std::chrono::steady_clock::now()](HttpResponse resp) {
+        auto result = ParseSafely(ParseRefresh, resp, "Refresh");
+        RefreshMetrics().done(started, result.has_value());
+        on_done(std::move(result));
+    });
 }
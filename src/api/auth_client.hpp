@@ -1,7 +1,10 @@
 #pragma once
+#include <functional>
 #include <string>
 #include <optional>
 
+#include "../http.hpp"
+
 struct AuthStatus {
     std::string status;        // "pending"/"approved"/"denied"/etc
     std::string access_token;
@@ -16,26 +19,35 @@ struct AuthRefresh {
 
 class AuthClient {
 public:
-    explicit AuthClient(std::string base_url);
+    explicit AuthClient(std::string base_url, HttpTimeouts timeouts = {});
 
     // POST /auth/oauth/start?provider=github|yandex&token_login=...
     // -> {"url":"https://github.com/login/oauth/authorize?..."}
     std::optional<std::string> StartOAuth(const std::string& provider,
-                                          const std::string& token_login);
+                                          const std::string& token_login) const;
 
     // POST /auth/code/start?token_login=...
     // -> {"code":"1234"}
-    std::optional<std::string> StartCode(const std::string& token_login);
+    std::optional<std::string> StartCode(const std::string& token_login) const;
 
     // GET /auth/status?token_login=...
-    std::optional<AuthStatus> Status(const std::string& token_login);
+    std::optional<AuthStatus> Status(const std::string& token_login) const;
 
     // POST /auth/refresh  body {"refresh_token":"..."}
-    std::optional<AuthRefresh> Refresh(const std::string& refresh_token);
+    std::optional<AuthRefresh> Refresh(const std::string& refresh_token) const;
+
+    // Неблокирующие варианты: колбэк вызывается в потоке HTTP-цикла.
+    void StatusAsync(const std::string& token_login,
+                     std::function<void(std::optional<AuthStatus>)> on_done) const;
+    void RefreshAsync(const std::string& refresh_token,
+                      std::function<void(std::optional<AuthRefresh>)> on_done) const;
+
+    // Процентное кодирование для query: всё, кроме unreserved (RFC 3986).
+    static std::string UrlEncode(const std::string& s);
 
 private:
     std::string base;
+    HttpTimeouts timeouts;
 
     static std::string TrimRightSlash(std::string s);
-    static std::string UrlEncode(const std::string& s);
 };
@@ -0,0 +1,224 @@
+#include "main_cache.hpp"
+#include "../jwt.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <string_view>
+
+namespace {
+
+struct CacheControl {
+    bool storable = true;
+    std::optional<std::chrono::seconds> max_age;
+};
+
+std::string_view Trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+bool IEquals(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+        return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+    });
+}
+
+// Директивы через запятую; значение max-age — число секунд, возможно в кавычках.
+// Нечитаемый max-age — как max-age=0 (RFC 9111, 4.2.1).
+CacheControl ParseCacheControl(std::string_view header) {
+    CacheControl cc;
+    while (!header.empty()) {
+        const auto comma = header.find(',');
+        auto directive = Trim(header.substr(0, comma));
+        header = comma == std::string_view::npos ? std::string_view() : header.substr(comma + 1);
+
+        const auto eq = directive.find('=');
+        const auto name = Trim(directive.substr(0, eq));
+        if (IEquals(name, "no-store") || IEquals(name, "no-cache") || IEquals(name, "private")) {
+            cc.storable = false;
+        } else if (IEquals(name, "max-age")) {
+            auto value = eq == std::string_view::npos ? std::string_view() : Trim(directive.substr(eq + 1));
+            if (value.size() >= 2 && value.front() == '"' && value.back() == '"') value = value.substr(1, value.size() - 2);
+            long long seconds = 0;
+            bool valid = !value.empty() && value.size() <= 10;
+            for (char c : value) {
+                if (c < '0' || c > '9') valid = false;
+                else seconds = seconds * 10 + (c - '0');
+            }
+            const std::chrono::seconds age(valid ? seconds : 0);
+            cc.max_age = cc.max_age ? std::min(*cc.max_age, age) : age;
+        }
+    }
+    return cc;
+}
+
+} // namespace
+
+MainResponseCache::MainResponseCache(size_t capacity,
+                                     std::vector<std::pair<std::string, Policy>> policies,
+                                     size_t shards)
+    : policies(std::move(policies)) {
+    if (shards == 0) shards = 1;
+    shard_capacity = capacity / shards ? capacity / shards : 1;
+    this->shards.reserve(shards);
+    for (size_t i = 0; i < shards; ++i) {
+        this->shards.push_back(std::make_unique<Shard>());
+    }
+}
+
+const MainResponseCache::Policy* MainResponseCache::PolicyFor(const std::string& path) const {
+    const auto end = path.find('?');
+    for (const auto& [endpoint, policy] : policies) {
+        if (path.compare(0, end, endpoint) == 0) return &policy;
+    }
+    return nullptr;
+}
+
+std::string MainResponseCache::UserPrefix(const std::string& access_token) {
+    // По sub записи переживают refresh токена; без него — только до refresh.
+    // Префикс кончается первым '\n' (см. UserOf), в токене его не бывает.
+    auto sub = jwt_sub(access_token);
+    if (sub && sub->find('\n') == std::string::npos) return "sub:" + *sub + "\n";
+    return "tok:" + access_token + "\n";
+}
+
+std::string MainResponseCache::UserOf(const std::string& key) {
+    return key.substr(0, key.find('\n') + 1);
+}
+
+std::string MainResponseCache::Key(const std::string& base_url,
+                                   const std::string& access_token,
+                                   const std::string& path) {
+    return UserPrefix(access_token) + base_url + path;
+}
+
+MainResponseCache::Shard& MainResponseCache::ShardFor(const std::string& user) {
+    return *shards[std::hash<std::string>{}(user) % shards.size()];
+}
+
+void MainResponseCache::Erase(Shard& shard, Lru::iterator it) {
+    auto user = shard.users.find(UserOf(it->first));
+    if (user != shard.users.end()) {
+        user->second.erase(it->first);
+        if (user->second.empty()) shard.users.erase(user);
+    }
+    shard.index.erase(it->first);
+    shard.lru.erase(it);
+}
+
+std::vector<std::string> MainResponseCache::ConditionalHeaders(const MainResult& cached) {
+    std::vector<std::string> headers;
+    auto etag = cached.headers.find("etag");
+    if (etag != cached.headers.end()) {
+        headers.push_back("If-None-Match: " + etag->second);
+    }
+    auto modified = cached.headers.find("last-modified");
+    if (modified != cached.headers.end()) {
+        headers.push_back("If-Modified-Since: " + modified->second);
+    }
+    return headers;
+}
+
+MainResponseCache::Lookup MainResponseCache::Get(const std::string& key, const Policy& policy) {
+    Lookup out;
+    auto& shard = ShardFor(UserOf(key));
+    std::lock_guard<std::mutex> lock(shard.mu);
+
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) return out;
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+
+    auto& entry = it->second->second;
+    const auto age = Clock::now() - entry.stored_at;
+    const auto fresh = std::min<Clock::duration>(policy.fresh, entry.max_age);
+    out.result = entry.result;
+
+    if (age < fresh) {
+        out.state = Lookup::State::Fresh;
+    } else if (age < fresh + policy.stale_while_revalidate) {
+        out.state = Lookup::State::Stale;
+        if (!entry.revalidating) {
+            entry.revalidating = true;
+            out.revalidate = true;
+        }
+    } else {
+        out.state = Lookup::State::Expired;
+        out.usable_on_error = age < fresh + policy.stale_if_error;
+    }
+    return out;
+}
+
+void MainResponseCache::Put(const std::string& key, const MainResult& result) {
+    CacheControl cc;
+    auto cache_control = result.headers.find("cache-control");
+    if (cache_control != result.headers.end()) cc = ParseCacheControl(cache_control->second);
+    if (!cc.storable) {
+        Remove(key);
+        return;
+    }
+
+    Entry entry{std::make_shared<const MainResult>(result),
+                Clock::now(),
+                cc.max_age ? Clock::duration(*cc.max_age) : Clock::duration::max(),
+                false};
+    auto& shard = ShardFor(UserOf(key));
+    std::lock_guard<std::mutex> lock(shard.mu);
+
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        it->second->second = std::move(entry);
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        return;
+    }
+
+    shard.lru.emplace_front(key, std::move(entry));
+    shard.index.emplace(key, shard.lru.begin());
+    shard.users[UserOf(key)].insert(key);
+
+    while (shard.lru.size() > shard_capacity) {
+        Erase(shard, std::prev(shard.lru.end()));
+    }
+}
+
+void MainResponseCache::Touch(const std::string& key) {
+    auto& shard = ShardFor(UserOf(key));
+    std::lock_guard<std::mutex> lock(shard.mu);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) return;
+    it->second->second.stored_at = Clock::now();
+    it->second->second.revalidating = false;
+}
+
+void MainResponseCache::RevalidateFailed(const std::string& key) {
+    auto& shard = ShardFor(UserOf(key));
+    std::lock_guard<std::mutex> lock(shard.mu);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) it->second->second.revalidating = false;
+}
+
+void MainResponseCache::Remove(const std::string& key) {
+    auto& shard = ShardFor(UserOf(key));
+    std::lock_guard<std::mutex> lock(shard.mu);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) Erase(shard, it->second);
+}
+
+void MainResponseCache::InvalidateUser(const std::string& access_token) {
+    const std::string user = UserPrefix(access_token);
+    auto& shard = ShardFor(user);
+    std::lock_guard<std::mutex> lock(shard.mu);
+
+    auto keys = shard.users.find(user);
+    if (keys == shard.users.end()) return;
+    for (const auto& key : keys->second) {
+        auto it = shard.index.find(key);
+        if (it == shard.index.end()) continue;
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+    }
+    shard.users.erase(keys);
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "main_client.hpp"
+
+// Кэш ответов Main на GET, отдельный для каждого пользователя (sub из JWT,
+// иначе сам токен), адреса Main и пути. Что и сколько кэшировать, задаёт
+// Policy по пути. После смены MAIN_URL старые записи не находятся и
+// вытесняются LRU.
+//
+// Свежий ответ отдаётся без запроса в Main; устаревший в пределах
+// stale_while_revalidate — тоже сразу, а перепроверяется в фоне
+// (If-None-Match / If-Modified-Since); если Main недоступен, ответ
+// отдаётся ещё stale_if_error. Ограничен по числу записей (LRU).
+// Ответы с Cache-Control no-store, no-cache или private не кэшируются,
+// max-age ответа сокращает fresh политики.
+//
+// Записи разложены по шардам по пользователю: запросы разных пользователей
+// не делят мьютекс, а InvalidateUser трогает один шард и только ключи
+// этого пользователя.
+class MainResponseCache {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Policy {
+        std::chrono::seconds fresh;
+        std::chrono::seconds stale_while_revalidate;
+        std::chrono::seconds stale_if_error;
+    };
+
+    struct Lookup {
+        enum class State { Miss, Fresh, Stale, Expired };
+
+        State state = State::Miss;
+        // Для всех, кроме Miss. Общий с кэшем: тело копируется, только
+        // если закэшированный ответ и правда отдаётся.
+        std::shared_ptr<const MainResult> result;
+        bool revalidate = false;     // Stale: фоновая перепроверка — на вызывающем
+        bool usable_on_error = false;
+    };
+
+    MainResponseCache(size_t capacity,
+                      std::vector<std::pair<std::string, Policy>> policies,
+                      size_t shards = 16);
+
+    // nullptr — путь не кэшируется.
+    const Policy* PolicyFor(const std::string& path) const;
+
+    static std::string Key(const std::string& base_url, const std::string& access_token, const std::string& path);
+    static std::vector<std::string> ConditionalHeaders(const MainResult& cached);
+
+    Lookup Get(const std::string& key, const Policy& policy);
+    void Put(const std::string& key, const MainResult& result);
+    // 304: закэшированный ответ по-прежнему актуален.
+    void Touch(const std::string& key);
+    // Перепроверка не удалась (Main недоступен или 5xx): запись остаётся.
+    void RevalidateFailed(const std::string& key);
+    // Ответа больше нет или он уже не наш (4xx при перепроверке).
+    void Remove(const std::string& key);
+    // Изменяющий запрос пользователя: его ответы могли устареть.
+    void InvalidateUser(const std::string& access_token);
+
+private:
+    struct Entry {
+        std::shared_ptr<const MainResult> result; // отдаётся в Lookup без копии
+        Clock::time_point stored_at;
+        Clock::duration max_age;   // предел fresh из Cache-Control
+        bool revalidating = false;
+    };
+
+    using Lru = std::list<std::pair<std::string, Entry>>;
+
+    struct Shard {
+        std::mutex mu;
+        Lru lru; // front — самый свежий
+        std::unordered_map<std::string, Lru::iterator> index;
+        std::unordered_map<std::string, std::unordered_set<std::string>> users; // префикс -> ключи
+    };
+
+    static std::string UserPrefix(const std::string& access_token);
+    static std::string UserOf(const std::string& key);
+
+    Shard& ShardFor(const std::string& user);
+    static void Erase(Shard& shard, Lru::iterator it);
+
+    std::vector<std::pair<std::string, Policy>> policies;
+    std::vector<std::unique_ptr<Shard>> shards;
+    size_t shard_capacity;
+};
@@ -1,8 +1,94 @@
 #include "main_client.hpp"
+#include "main_cache.hpp"
 #include "../http.hpp"
 
-MainClient::MainClient(std::string base_url)
-    : base(TrimRightSlash(std::move(base_url))) {}
+#include <chrono>
+
+namespace {
+using Lookup = MainResponseCache::Lookup;
+
+std::vector<std::string> AuthHeaders(const std::string& access_token) {
+    std::vector<std::string> headers;
+    if (!access_token.empty()) {
+        headers.push_back("Authorization: Bearer " + access_token);
+    }
+    return headers;
+}
+
+// Запрос в Main: участок trace называется "main".
+HttpRequest MainRequest(std::string method,
+                        std::string url,
+                        std::string body,
+                        std::vector<std::string> headers,
+                        const HttpTimeouts& timeouts) {
+    HttpRequest req;
+    req.method = std::move(method);
+    req.url = std::move(url);
+    req.body = std::move(body);
+    req.headers = std::move(headers);
+    req.span = "main";
+    req.timeouts = timeouts;
+    return req;
+}
+
+MainResult ToResult(HttpResponse resp) {
+    return MainResult{static_cast<int>(resp.status), std::move(resp.body), std::move(resp.headers)};
+}
+
+// Для метрик: ответа нет или Main упал (кэш мог отдать устаревшее — это не ошибка).
+bool Usable(const MainResult& result) {
+    return result.status != 0 && result.status < 500;
+}
+
+bool IsWrite(const std::string& method) {
+    return method != "GET" && method != "HEAD" && method != "OPTIONS";
+}
+
+// Итог запроса мимо кэша (или перепроверки): обновляем кэш и решаем, что
+// отдать — свежий ответ, закэшированный (304) или устаревший (Main лежит).
+MainResult Settle(MainResponseCache& cache, const std::string& key, Lookup& hit, MainResult fetched) {
+    if (fetched.status == 304 && hit.state != Lookup::State::Miss) {
+        cache.Touch(key);
+        return *hit.result;
+    }
+    if (fetched.status == 200) {
+        cache.Put(key, fetched);
+        return fetched;
+    }
+    if (fetched.status == 0 || fetched.status >= 500) {
+        if (hit.usable_on_error) return *hit.result;
+        return fetched;
+    }
+    // 4xx и прочее: закэшированный ответ больше не действителен.
+    if (hit.state != Lookup::State::Miss) cache.Remove(key);
+    return fetched;
+}
+
+// Фоновая перепроверка устаревшей записи; кэш держим shared_ptr'ом, чтобы
+// он пережил запрос.
+void Revalidate(std::shared_ptr<MainResponseCache> cache,
+                const std::string& key,
+                HttpRequest req,
+                const MainResult& cached) {
+    for (auto& header : MainResponseCache::ConditionalHeaders(cached)) {
+        req.headers.push_back(std::move(header));
+    }
+    http_request_async(std::move(req), [cache = std::move(cache), key](HttpResponse resp) {
+        if (resp.status == 304) {
+            cache->Touch(key);
+        } else if (resp.status == 200) {
+            cache->Put(key, ToResult(std::move(resp)));
+        } else if (resp.status == 0 || resp.status >= 500) {
+            cache->RevalidateFailed(key);
+        } else {
+            cache->Remove(key);
+        }
+    });
+}
+} // namespace
+
+MainClient::MainClient(std::string base_url, std::shared_ptr<MainResponseCache> cache, HttpTimeouts timeouts)
+    : base(TrimRightSlash(std::move(base_url))), cache(std::move(cache)), timeouts(timeouts) {}
 
 std::string MainClient::TrimRightSlash(std::string s) {
     while (!s.empty() && s.back() == '/') s.pop_back();
@@ -12,11 +98,146 @@ std::string MainClient::TrimRightSlash(std::string s) {
 MainResult MainClient::Do(const std::string& method,
                           const std::string& path,
                           const std::string& body,
-                          const std::string& access_token) {
-    std::vector<std::string> headers;
-    if (!access_token.empty()) {
-        headers.push_back("Authorization: Bearer " + access_token);
+                          const std::string& access_token) const {
+    static const UpstreamCall upstream("main", "Do");
+    const auto started = std::chrono::steady_clock::now();
+    auto finish = [&started](MainResult result) {
+        upstream.done(started, Usable(result));
+        return result;
+    };
+
+    const MainResponseCache::Policy* policy = nullptr;
+    if (cache && method == "GET") policy = cache->PolicyFor(path);
+
+    if (!policy) {
+        auto result = ToResult(http_request(MainRequest(method, base + path, body, AuthHeaders(access_token), timeouts)));
+        if (cache && IsWrite(method)) cache->InvalidateUser(access_token);
+        return finish(std::move(result));
+    }
+
+    const auto key = MainResponseCache::Key(base, access_token, path);
+    auto hit = cache->Get(key, *policy);
+    if (hit.state == Lookup::State::Fresh) return finish(*hit.result);
+    if (hit.state == Lookup::State::Stale) {
+        if (hit.revalidate) {
+            Revalidate(cache, key, MainRequest("GET", base + path, "", AuthHeaders(access_token), timeouts), *hit.result);
+        }
+        return finish(*hit.result);
+    }
+
+    auto headers = AuthHeaders(access_token);
+    if (hit.state == Lookup::State::Expired) {
+        for (auto& header : MainResponseCache::ConditionalHeaders(*hit.result)) {
+            headers.push_back(std::move(header));
+        }
+    }
+    auto fetched = ToResult(http_request(MainRequest("GET", base + path, "", std::move(headers), timeouts)));
+    return finish(Settle(*cache, key, hit, std::move(fetched)));
+}
+
+void MainClient::DoAsync(const std::string& method,
+                         const std::string& path,
+                         std::string body,
+                         const std::string& access_token,
+                         std::function<void(MainResult)> on_done,
+                         MainForward forward) const {
+    static const UpstreamCall upstream("main", "DoAsync");
+    on_done = [on_done = std::move(on_done), started = std::chrono::steady_clock::now()](MainResult result) {
+        upstream.done(started, Usable(result));
+        on_done(std::move(result));
+    };
+
+    const MainResponseCache::Policy* policy = nullptr;
+    if (cache && method == "GET") policy = cache->PolicyFor(path);
+
+    auto req = MainRequest(method, base + path, std::move(body), AuthHeaders(access_token), timeouts);
+    for (auto& header : forward.headers) {
+        req.headers.push_back(std::move(header));
+    }
+    req.max_body = forward.max_body;
+
+    if (!policy) {
+        std::shared_ptr<MainResponseCache> invalidate;
+        if (cache && IsWrite(method)) invalidate = cache;
+        http_request_async(std::move(req), [on_done = std::move(on_done), invalidate, access_token](HttpResponse resp) {
+            if (invalidate) invalidate->InvalidateUser(access_token);
+            on_done(ToResult(std::move(resp)));
+        });
+        return;
+    }
+
+    auto key = MainResponseCache::Key(base, access_token, path);
+    auto hit = cache->Get(key, *policy);
+    if (hit.state == Lookup::State::Fresh) {
+        on_done(*hit.result);
+        return;
     }
-    auto resp = http_request(method, base + path, body, headers);
-    return MainResult{resp.status, resp.body};
+    if (hit.state == Lookup::State::Stale) {
+        if (hit.revalidate) Revalidate(cache, key, std::move(req), *hit.result);
+        on_done(*hit.result);
+        return;
+    }
+
+    if (hit.state == Lookup::State::Expired) {
+        for (auto& header : MainResponseCache::ConditionalHeaders(*hit.result)) {
+            req.headers.push_back(std::move(header));
+        }
+    }
+    http_request_async(std::move(req), [cache = cache, key = std::move(key), hit = std::move(hit),
+                                        on_done = std::move(on_done)](HttpResponse resp) mutable {
+        on_done(Settle(*cache, key, hit, ToResult(std::move(resp))));
+    });
+}
+
+std::vector<MainResult> MainClient::GetAll(const std::vector<std::string>& paths,
+                                           const std::string& access_token) const {
+    static const UpstreamCall upstream("main", "GetAll");
+    const auto started = std::chrono::steady_clock::now();
+
+    std::vector<MainResult> results(paths.size());
+    std::vector<std::string> keys(paths.size());
+    std::vector<Lookup> hits(paths.size());
+
+    // Из кэша отдаём сразу, в Main одной пачкой идут только промахи.
+    std::vector<HttpRequest> requests;
+    std::vector<size_t> fetched_index;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        auto req = MainRequest("GET", base + paths[i], "", AuthHeaders(access_token), timeouts);
+
+        const MainResponseCache::Policy* policy = cache ? cache->PolicyFor(paths[i]) : nullptr;
+        if (policy) {
+            keys[i] = MainResponseCache::Key(base, access_token, paths[i]);
+            hits[i] = cache->Get(keys[i], *policy);
+
+            if (hits[i].state == Lookup::State::Fresh) {
+                results[i] = *hits[i].result;
+                continue;
+            }
+            if (hits[i].state == Lookup::State::Stale) {
+                if (hits[i].revalidate) Revalidate(cache, keys[i], std::move(req), *hits[i].result);
+                results[i] = *hits[i].result;
+                continue;
+            }
+            if (hits[i].state == Lookup::State::Expired) {
+                for (auto& header : MainResponseCache::ConditionalHeaders(*hits[i].result)) {
+                    req.headers.push_back(std::move(header));
+                }
+            }
+        }
+
+        requests.push_back(std::move(req));
+        fetched_index.push_back(i);
+    }
+
+    auto responses = http_request_all(requests);
+    for (size_t k = 0; k < fetched_index.size(); ++k) {
+        const size_t i = fetched_index[k];
+        auto fetched = ToResult(std::move(responses[k]));
+        results[i] = keys[i].empty() ? std::move(fetched) : Settle(*cache, keys[i], hits[i], std::move(fetched));
+    }
+
+    bool ok = true;
+    for (const auto& result : results) ok = ok && Usable(result);
+    upstream.done(started, ok);
+    return results;
 }
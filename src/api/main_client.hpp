@@ -1,23 +1,58 @@
 #pragma once
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "../http.hpp"
+
+class MainResponseCache;
+
 struct MainResult {
     int status = 0;
     std::string body;
-    // если надо — позже добавим content-type
+    std::map<std::string, std::string> headers; // имена в нижнем регистре
+};
+
+// Дополнительное для проксируемых запросов: заголовки клиента, которые
+// уходят в Main как есть, и предел размера ответа (0 — без предела; больше —
+// status 0, как при обрыве).
+struct MainForward {
+    std::vector<std::string> headers;
+    size_t max_body = 0;
 };
 
 class MainClient {
 public:
-    explicit MainClient(std::string base_url);
+    // cache — общий для всех клиентов кэш GET-ответов; nullptr — без кэша.
+    explicit MainClient(std::string base_url,
+                        std::shared_ptr<MainResponseCache> cache = nullptr,
+                        HttpTimeouts timeouts = {});
 
     MainResult Do(const std::string& method,
                   const std::string& path,
                   const std::string& body,
-                  const std::string& access_token);
+                  const std::string& access_token) const;
+
+    // Неблокирующий Do: колбэк вызывается в потоке HTTP-цикла (или сразу,
+    // если ответ есть в кэше). body забирается без копии.
+    void DoAsync(const std::string& method,
+                 const std::string& path,
+                 std::string body,
+                 const std::string& access_token,
+                 std::function<void(MainResult)> on_done,
+                 MainForward forward = {}) const;
+
+    // Несколько GET одновременно; результаты в порядке paths.
+    std::vector<MainResult> GetAll(const std::vector<std::string>& paths,
+                                   const std::string& access_token) const;
 
 private:
     std::string base;
+    std::shared_ptr<MainResponseCache> cache;
+    HttpTimeouts timeouts;
+
     static std::string TrimRightSlash(std::string s);
 };
@@ -0,0 +1,56 @@
+#include "upstreams.hpp"
+#include "main_cache.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Кэш GET-ответов Main, общий для всех запросов. Сроки — по тому, как
+// быстро меняются данные: уведомления почти сразу, справочники реже.
+// Ёмкость — из снимка при старте.
+std::shared_ptr<MainResponseCache> main_cache(size_t capacity) {
+    using std::chrono::seconds;
+    static const std::shared_ptr<MainResponseCache> cache = [capacity] {
+        if (capacity == 0) return std::shared_ptr<MainResponseCache>();
+        return std::make_shared<MainResponseCache>(capacity, std::vector<std::pair<std::string, MainResponseCache::Policy>>{
+            {"/courses_list", {seconds(30), seconds(300), seconds(3600)}},
+            {"/users_list",   {seconds(60), seconds(300), seconds(3600)}},
+            {"/notification", {seconds(5),  seconds(30),  seconds(600)}},
+            {"/course_get",   {seconds(60), seconds(300), seconds(3600)}},
+            {"/user_get",     {seconds(60), seconds(300), seconds(3600)}},
+        });
+    }();
+    return cache;
+}
+
+HttpTimeouts timeouts(const Config& config) {
+    return HttpTimeouts{config.upstream_connect_timeout, config.upstream_timeout};
+}
+
+std::shared_ptr<const Upstreams>& current() {
+    static std::shared_ptr<const Upstreams> clients;
+    return clients;
+}
+
+} // namespace
+
+Upstreams::Upstreams(std::shared_ptr<const Config> config)
+    : config(std::move(config)),
+      auth(this->config->auth_url, timeouts(*this->config)),
+      main(this->config->main_url, main_cache(this->config->main_cache_capacity), timeouts(*this->config)) {}
+
+std::shared_ptr<const Upstreams> upstreams() {
+    auto clients = std::atomic_load(&current());
+    auto snapshot = config();
+    if (clients && clients->config == snapshot) return clients;
+
+    // Снимок сменился: пересобираем. Если одновременно пересобирает другой
+    // поток — остаётся любой из двух, оба по одному снимку.
+    std::shared_ptr<const Upstreams> next = std::make_shared<const Upstreams>(std::move(snapshot));
+    if (std::atomic_compare_exchange_strong(&current(), &clients, next)) return next;
+    return clients;
+}
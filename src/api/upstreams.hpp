@@ -0,0 +1,23 @@
+#pragma once
+#include <memory>
+
+#include "auth_client.hpp"
+#include "main_client.hpp"
+#include "../config.hpp"
+
+// Клиенты Auth и Main, собранные по одному снимку конфигурации. Живут
+// дольше запросов: создаются при старте и заново — только когда сменился
+// снимок (SIGHUP). Соединения с upstream держит общий кэш libcurl
+// (http.cpp), кэш ответов Main — один на процесс: пересборка клиентов
+// ни то, ни другое не сбрасывает.
+struct Upstreams {
+    explicit Upstreams(std::shared_ptr<const Config> config);
+
+    std::shared_ptr<const Config> config;
+    AuthClient auth;
+    MainClient main;
+};
+
+// Клиенты для текущего config(). Запрос берёт их один раз и дорабатывает с
+// ними, даже если за это время снимок подменили.
+std::shared_ptr<const Upstreams> upstreams();
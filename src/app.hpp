@@ -0,0 +1,11 @@
+#pragma once
+#include <crow.h>
+
+#include "compression.hpp"
+#include "metrics.hpp"
+#include "trace.hpp"
+
+// Приложение Crow со всеми middleware сервиса. after_handle идут в обратном
+// порядке: Server-Timing попадает в ответ до сжатия, а RequestMetrics
+// учитывает и время сжатия.
+using App = crow::App<RequestMetrics, Tracing, Compression>;
@@ -0,0 +1,502 @@
+#include "async_redis.hpp"
+#include "resp.hpp"
+#include "trace.hpp"
+
+#include <chrono>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace {
+
+constexpr size_t kReadChunk = 16 * 1024;
+// Пауза перед переподключением постоянного (listen) соединения.
+constexpr auto kReconnectDelay = std::chrono::seconds(1);
+// Как kIoTimeoutMs у RedisClient: зависший Redis не должен держать колбэки
+// вечно. Ответы идут по порядку, поэтому просроченная команда обрывает всё
+// соединение — её ответ уже не отделить от следующих.
+constexpr auto kConnectTimeout = std::chrono::seconds(2);
+constexpr auto kCommandTimeout = std::chrono::seconds(2);
+
+using Clock = std::chrono::steady_clock;
+
+std::exception_ptr reply_error(const RedisReply& rep) {
+    return std::make_exception_ptr(std::runtime_error("Redis error: " + rep.str));
+}
+
+} // namespace
+
+// Одно соединение. Всё состояние трогается только внутри strand_, асинхронные
+// операции держат shared_ptr на себя. generation_ меняется при каждом обрыве,
+// чтобы запоздавшие колбэки старого сокета ничего не портили.
+class AsyncRedisClient::Connection : public std::enable_shared_from_this<Connection> {
+public:
+    Connection(asio::io_context& io, std::string host, int port)
+        : strand_(asio::make_strand(io)),
+          socket_(strand_),
+          resolver_(strand_),
+          retry_timer_(strand_),
+          connect_timer_(strand_),
+          deadline_timer_(strand_),
+          host_(std::move(host)),
+          port_(port) {}
+
+    // request из replies команд уходит в сокет подряд, handler вызывается на
+    // каждый ответ (или один раз с ошибкой, если соединение уже закрыто).
+    void submit(std::string request, ReplyHandler handler, size_t replies = 1) {
+        asio::post(strand_, [self = shared_from_this(),
+                             request = std::move(request),
+                             handler = std::move(handler),
+                             replies]() mutable {
+            if (self->closed_) {
+                handler(std::make_exception_ptr(std::runtime_error("Redis client closed")), {});
+                return;
+            }
+            self->outbox_ += request;
+            const auto deadline = Clock::now() + kCommandTimeout;
+            for (size_t i = 0; i < replies; ++i) {
+                self->awaiting_.push_back(Pending{handler, deadline});
+            }
+            self->arm_deadline();
+            self->kick();
+        });
+    }
+
+    // Сделать соединение постоянным: после каждого подключения первыми уходят
+    // setup-команды, кадры RESP3 Push передаются в on_push, а после обрыва
+    // соединение переподключается само, не дожидаясь следующей команды.
+    void listen(std::vector<std::vector<std::string>> setup, PushHandler on_push, StateHandler on_state) {
+        asio::post(strand_, [self = shared_from_this(),
+                             setup = std::move(setup),
+                             on_push = std::move(on_push),
+                             on_state = std::move(on_state)]() mutable {
+            self->setup_ = std::move(setup);
+            self->on_push_ = std::move(on_push);
+            self->on_state_ = std::move(on_state);
+            self->persistent_ = true;
+            self->kick();
+        });
+    }
+
+    void close() {
+        asio::post(strand_, [self = shared_from_this()] {
+            self->closed_ = true;
+            self->retry_timer_.cancel();
+            self->fail("Redis client closed");
+        });
+    }
+
+private:
+    enum class State { Disconnected, Connecting, Connected };
+
+    void kick() {
+        if (state_ == State::Disconnected) {
+            connect();
+            return;
+        }
+        if (state_ == State::Connected && !writing_ && !outbox_.empty()) {
+            write();
+        }
+    }
+
+    void connect() {
+        state_ = State::Connecting;
+        const unsigned gen = generation_;
+
+        connect_timer_.expires_after(kConnectTimeout);
+        connect_timer_.async_wait([self = shared_from_this(), gen](const asio::error_code& ec) {
+            if (ec || gen != self->generation_ || self->state_ != State::Connecting) return;
+            self->fail("connect " + self->host_ + ": timed out");
+        });
+
+        if (!endpoints_.empty()) {
+            connect_to(endpoints_, gen);
+            return;
+        }
+
+        resolver_.async_resolve(host_, std::to_string(port_),
+            [self = shared_from_this(), gen](const asio::error_code& ec,
+                                             asio::ip::tcp::resolver::results_type results) {
+                if (gen != self->generation_) return;
+                if (ec) {
+                    self->fail("resolve " + self->host_ + ": " + ec.message());
+                    return;
+                }
+                self->endpoints_ = results;
+                self->connect_to(self->endpoints_, gen);
+            });
+    }
+
+    void connect_to(const asio::ip::tcp::resolver::results_type& endpoints, unsigned gen) {
+        asio::async_connect(socket_, endpoints,
+            [self = shared_from_this(), gen](const asio::error_code& ec, const asio::ip::tcp::endpoint&) {
+                if (gen != self->generation_) return;
+                if (ec) {
+                    // Адрес мог смениться — в следующий раз резолвим заново.
+                    self->endpoints_ = {};
+                    self->fail("connect " + self->host_ + ": " + ec.message());
+                    return;
+                }
+
+                asio::error_code ignored;
+                self->socket_.set_option(asio::ip::tcp::no_delay(true), ignored);
+                self->socket_.set_option(asio::socket_base::keep_alive(true), ignored);
+
+                self->state_ = State::Connected;
+                self->connect_timer_.cancel();
+                self->start_setup();
+                self->read();
+                self->kick();
+            });
+    }
+
+    // Setup-команды встают в начало очереди, перед уже накопленными.
+    void start_setup() {
+        if (setup_.empty()) return;
+
+        std::string request;
+        std::deque<Pending> handlers;
+        const auto deadline = Clock::now() + kCommandTimeout;
+        for (size_t i = 0; i < setup_.size(); ++i) {
+            resp_append_command(request, setup_[i]);
+            const bool last = i + 1 == setup_.size();
+            handlers.push_back(Pending{[self = shared_from_this(), last](std::exception_ptr err, RedisReply rep) {
+                if (err) return; // соединение уже оборвано
+                if (rep.is_error()) {
+                    self->fail("setup: " + rep.str);
+                    return;
+                }
+                if (last && self->on_state_) self->on_state_(true);
+            }, deadline});
+        }
+
+        outbox_.insert(0, request);
+        awaiting_.insert(awaiting_.begin(),
+                         std::make_move_iterator(handlers.begin()),
+                         std::make_move_iterator(handlers.end()));
+        arm_deadline();
+    }
+
+    // Таймер смотрит на самую старую команду; взведён — один на соединение,
+    // после срабатывания перевзводится по следующей.
+    void arm_deadline() {
+        if (deadline_armed_ || awaiting_.empty()) return;
+        deadline_armed_ = true;
+        deadline_timer_.expires_at(awaiting_.front().deadline);
+        const unsigned gen = generation_;
+        deadline_timer_.async_wait([self = shared_from_this(), gen](const asio::error_code& ec) {
+            if (ec || gen != self->generation_) return;
+            self->deadline_armed_ = false;
+            if (!self->awaiting_.empty() && self->awaiting_.front().deadline <= Clock::now()) {
+                self->fail("no reply in " + std::to_string(kCommandTimeout.count()) + " s");
+                return;
+            }
+            self->arm_deadline();
+        });
+    }
+
+    void write() {
+        writing_ = true;
+        auto sending = std::make_shared<std::string>();
+        sending->swap(outbox_);
+
+        const unsigned gen = generation_;
+        asio::async_write(socket_, asio::buffer(*sending),
+            [self = shared_from_this(), sending, gen](const asio::error_code& ec, size_t) {
+                if (gen != self->generation_) return;
+                self->writing_ = false;
+                if (ec) {
+                    self->fail("write: " + ec.message());
+                    return;
+                }
+                self->kick();
+            });
+    }
+
+    void read() {
+        // reader держим через shared_ptr: после обрыва создаётся новый, а
+        // буфер старого должен дожить до завершения незаконченного чтения.
+        auto reader = reader_;
+        char* buf = reader->prepare(kReadChunk);
+
+        const unsigned gen = generation_;
+        socket_.async_read_some(asio::buffer(buf, kReadChunk),
+            [self = shared_from_this(), reader, gen](const asio::error_code& ec, size_t n) {
+                if (gen != self->generation_) return;
+                if (ec) {
+                    self->fail("read: " + ec.message());
+                    return;
+                }
+
+                reader->commit(n);
+                try {
+                    RespValue v;
+                    while (reader->next(v)) {
+                        self->dispatch(v);
+                        // колбэк мог оборвать соединение
+                        if (gen != self->generation_) return;
+                    }
+                } catch (const std::exception& e) {
+                    self->fail(e.what());
+                    return;
+                }
+                self->read();
+            });
+    }
+
+    void dispatch(const RespValue& v) {
+        if (v.type == RespValue::Type::Push) {
+            if (!on_push_) return;
+            try {
+                on_push_(make_reply(v));
+            } catch (const std::exception& e) {
+                // колбэк не должен ронять цикл событий
+                CROW_LOG_ERROR << "redis push handler threw: " << e.what();
+            } catch (...) {
+                CROW_LOG_ERROR << "redis push handler threw a non-std exception";
+            }
+            return;
+        }
+        if (awaiting_.empty()) {
+            throw std::runtime_error("Redis: unexpected reply");
+        }
+        ReplyHandler handler = std::move(awaiting_.front().handler);
+        awaiting_.pop_front();
+        invoke(handler, nullptr, make_reply(v));
+    }
+
+    void fail(const std::string& reason) {
+        ++generation_;
+        state_ = State::Disconnected;
+        writing_ = false;
+        outbox_.clear();
+        reader_ = std::make_shared<RespReader>();
+
+        asio::error_code ignored;
+        socket_.close(ignored);
+        resolver_.cancel();
+        connect_timer_.cancel();
+        deadline_timer_.cancel();
+        deadline_armed_ = false;
+
+        auto awaiting = std::move(awaiting_);
+        awaiting_.clear();
+
+        auto err = std::make_exception_ptr(std::runtime_error("Redis connection error: " + reason));
+        for (auto& pending : awaiting) {
+            invoke(pending.handler, err, {});
+        }
+
+        if (!persistent_) return;
+        if (on_state_) on_state_(false);
+        if (closed_) return;
+
+        retry_timer_.expires_after(kReconnectDelay);
+        retry_timer_.async_wait([self = shared_from_this()](const asio::error_code& ec) {
+            if (ec || self->closed_) return;
+            if (self->state_ == State::Disconnected) self->connect();
+        });
+    }
+
+    static void invoke(ReplyHandler& handler, std::exception_ptr err, RedisReply rep) {
+        if (!handler) return;
+        try {
+            handler(err, std::move(rep));
+        } catch (const std::exception& e) {
+            // колбэк не должен ронять цикл событий
+            CROW_LOG_ERROR << "redis reply handler threw: " << e.what();
+        } catch (...) {
+            CROW_LOG_ERROR << "redis reply handler threw a non-std exception";
+        }
+    }
+
+    asio::strand<asio::io_context::executor_type> strand_;
+    asio::ip::tcp::socket socket_;
+    asio::ip::tcp::resolver resolver_;
+    asio::ip::tcp::resolver::results_type endpoints_;
+    asio::steady_timer retry_timer_;
+    asio::steady_timer connect_timer_;
+    asio::steady_timer deadline_timer_;
+    std::string host_;
+    int port_;
+
+    State state_ = State::Disconnected;
+    unsigned generation_ = 0;
+    bool closed_ = false;
+    bool writing_ = false;
+    struct Pending {
+        ReplyHandler handler;
+        Clock::time_point deadline;
+    };
+
+    std::string outbox_;
+    std::deque<Pending> awaiting_;
+    bool deadline_armed_ = false;
+    std::shared_ptr<RespReader> reader_ = std::make_shared<RespReader>();
+
+    bool persistent_ = false;
+    std::vector<std::vector<std::string>> setup_;
+    PushHandler on_push_;
+    StateHandler on_state_;
+};
+
+AsyncRedisClient::AsyncRedisClient(asio::io_context& io,
+                                   std::string host,
+                                   int port,
+                                   size_t connections)
+    : io_(io), host_(std::move(host)), port_(port) {
+    if (connections == 0) connections = 1;
+    connections_.reserve(connections);
+    for (size_t i = 0; i < connections; ++i) {
+        connections_.push_back(std::make_shared<Connection>(io_, host_, port_));
+    }
+}
+
+AsyncRedisClient::~AsyncRedisClient() {
+    for (auto& conn : connections_) conn->close();
+    for (auto& conn : listeners_) conn->close();
+}
+
+void AsyncRedisClient::listen(std::vector<std::vector<std::string>> setup,
+                              PushHandler on_push,
+                              StateHandler on_state) {
+    auto conn = std::make_shared<Connection>(io_, host_, port_);
+    conn->listen(std::move(setup), std::move(on_push), std::move(on_state));
+    listeners_.push_back(std::move(conn));
+}
+
+AsyncRedisClient::Connection& AsyncRedisClient::pick() {
+    return *connections_[next_.fetch_add(1, std::memory_order_relaxed) % connections_.size()];
+}
+
+void AsyncRedisClient::async_command(const std::vector<std::string>& parts, ReplyHandler handler) {
+    std::string name = parts.empty() ? std::string() : parts.front();
+    // Колбэк копируемый (std::function), поэтому участок — через shared_ptr,
+    // и только если trace есть.
+    auto request_trace = trace::current();
+    auto span = request_trace ? std::make_shared<trace::Span>("redis", name) : nullptr;
+    pick().submit(resp_command(parts), [handler = std::move(handler), name = std::move(name),
+                                        started = std::chrono::steady_clock::now(),
+                                        request_trace = std::move(request_trace),
+                                        span = std::move(span)](std::exception_ptr err, RedisReply rep) {
+        record_redis_command(name, started, err || rep.is_error());
+        if (span) span->end();
+        trace::Scope scope(request_trace);
+        handler(err, std::move(rep));
+    });
+}
+
+void AsyncRedisClient::async_transaction(const std::vector<std::vector<std::string>>& commands,
+                                         TransactionHandler handler) {
+    std::string request = resp_command({"MULTI"});
+    for (const auto& parts : commands) resp_append_command(request, parts);
+    resp_append_command(request, {"EXEC"});
+
+    // Ответы приходят по одному; итог — один раз, когда пришёл EXEC или обрыв.
+    struct State {
+        std::vector<RedisReply> replies;
+        bool done = false;
+    };
+    auto state = std::make_shared<State>();
+    const size_t expected = commands.size() + 2;
+    auto request_trace = trace::current();
+    auto span = request_trace ? std::make_shared<trace::Span>("redis", "MULTI") : nullptr;
+    pick().submit(std::move(request), [handler = std::move(handler), state, expected,
+                                       started = std::chrono::steady_clock::now(),
+                                       request_trace = std::move(request_trace),
+                                       span = std::move(span)](std::exception_ptr err, RedisReply rep) {
+        if (state->done) return;
+        if (!err) {
+            state->replies.push_back(std::move(rep));
+            if (state->replies.size() < expected) return;
+        }
+        state->done = true;
+
+        std::vector<RedisReply> results;
+        if (!err) {
+            try {
+                results = exec_replies(std::move(state->replies));
+            } catch (...) {
+                err = std::current_exception();
+            }
+        }
+        record_redis_command("MULTI", started, err != nullptr);
+        if (span) span->end();
+        trace::Scope scope(request_trace);
+        handler(err, std::move(results));
+    }, expected);
+}
+
+void AsyncRedisClient::async_get(const std::string& key, GetHandler handler) {
+    async_command({"GET", key}, [handler = std::move(handler)](std::exception_ptr err, RedisReply rep) {
+        if (err) return handler(err, std::nullopt);
+        if (rep.is_error()) return handler(reply_error(rep), std::nullopt);
+        if (rep.is_null()) return handler(nullptr, std::nullopt);
+        if (rep.type != RedisReply::Type::String) {
+            return handler(std::make_exception_ptr(std::runtime_error("Unexpected reply type for GET")),
+                           std::nullopt);
+        }
+        handler(nullptr, std::move(rep.str));
+    });
+}
+
+void AsyncRedisClient::async_set(const std::string& key, const std::string& value, DoneHandler handler) {
+    async_command({"SET", key, value}, [handler = std::move(handler)](std::exception_ptr err, RedisReply rep) {
+        if (!handler) return;
+        if (err) return handler(err);
+        if (rep.is_error()) return handler(reply_error(rep));
+        if (!rep.is_ok()) return handler(std::make_exception_ptr(std::runtime_error("Unexpected reply for SET")));
+        handler(nullptr);
+    });
+}
+
+void AsyncRedisClient::async_del(const std::string& key, DoneHandler handler) {
+    async_command({"DEL", key}, [handler = std::move(handler)](std::exception_ptr err, RedisReply rep) {
+        if (!handler) return;
+        if (err) return handler(err);
+        if (rep.is_error()) return handler(reply_error(rep));
+        handler(nullptr);
+    });
+}
+
+std::future<std::optional<std::string>> AsyncRedisClient::async_get(const std::string& key) {
+    auto promise = std::make_shared<std::promise<std::optional<std::string>>>();
+    auto future = promise->get_future();
+    async_get(key, GetHandler([promise](std::exception_ptr err, std::optional<std::string> value) {
+        if (err) {
+            promise->set_exception(err);
+        } else {
+            promise->set_value(std::move(value));
+        }
+    }));
+    return future;
+}
+
+namespace {
+
+AsyncRedisClient::DoneHandler fulfil(const std::shared_ptr<std::promise<void>>& promise) {
+    return [promise](std::exception_ptr err) {
+        if (err) {
+            promise->set_exception(err);
+        } else {
+            promise->set_value();
+        }
+    };
+}
+
+} // namespace
+
+std::future<void> AsyncRedisClient::async_set(const std::string& key, const std::string& value) {
+    auto promise = std::make_shared<std::promise<void>>();
+    auto future = promise->get_future();
+    async_set(key, value, fulfil(promise));
+    return future;
+}
+
+std::future<void> AsyncRedisClient::async_del(const std::string& key) {
+    auto promise = std::make_shared<std::promise<void>>();
+    auto future = promise->get_future();
+    async_del(key, fulfil(promise));
+    return future;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#ifndef ASIO_STANDALONE
+#define ASIO_STANDALONE
+#endif
+#include <asio.hpp>
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "redis.hpp"
+
+// Неблокирующий клиент Redis поверх asio.
+//
+// Команды ставятся в очередь соединения и пишутся пачками, ответы
+// сопоставляются с колбэками в порядке отправки (pipelining), поэтому на
+// нескольких соединениях в полёте могут быть тысячи команд, а ни один поток
+// не ждёт сети. Колбэки вызываются в потоке io_context и не должны блокировать.
+// При обрыве все ожидающие колбэки получают исключение, следующая команда
+// переподключается сама. Подключение дольше 2 с или команда без ответа 2 с
+// считаются обрывом.
+class AsyncRedisClient {
+public:
+    using ReplyHandler = std::function<void(std::exception_ptr, RedisReply)>;
+    using GetHandler = std::function<void(std::exception_ptr, std::optional<std::string>)>;
+    using DoneHandler = std::function<void(std::exception_ptr)>;
+    using TransactionHandler = std::function<void(std::exception_ptr, std::vector<RedisReply>)>;
+    using PushHandler = std::function<void(const RedisReply&)>;
+    using StateHandler = std::function<void(bool ready)>;
+
+    AsyncRedisClient(asio::io_context& io,
+                     std::string host = "redis",
+                     int port = 6379,
+                     size_t connections = 2);
+    ~AsyncRedisClient();
+
+    AsyncRedisClient(const AsyncRedisClient&) = delete;
+    AsyncRedisClient& operator=(const AsyncRedisClient&) = delete;
+
+    // Ошибка Redis (-ERR) приходит как RedisReply::Type::Error, не исключением.
+    void async_command(const std::vector<std::string>& parts, ReplyHandler handler);
+
+    // MULTI, commands, EXEC — одной записью в одно соединение, один round
+    // trip. Ответы команд — как у RedisClient::transaction(): ошибка
+    // отдельной команды — RedisReply::Type::Error, EXECABORT — исключение.
+    void async_transaction(const std::vector<std::vector<std::string>>& commands, TransactionHandler handler);
+
+    void async_get(const std::string& key, GetHandler handler);
+    void async_set(const std::string& key, const std::string& value, DoneHandler handler);
+    void async_del(const std::string& key, DoneHandler handler);
+
+    std::future<std::optional<std::string>> async_get(const std::string& key);
+    std::future<void> async_set(const std::string& key, const std::string& value);
+    std::future<void> async_del(const std::string& key);
+
+    // Отдельное постоянное соединение для внеполосных сообщений RESP3
+    // (например, инвалидаций CLIENT TRACKING). После каждого подключения
+    // выполняет setup (обычно HELLO 3 + подписка) и сообщает on_state(true);
+    // обрыв — on_state(false) и переподключение через секунду.
+    // Вызывать до начала работы, не потокобезопасно относительно себя.
+    void listen(std::vector<std::vector<std::string>> setup,
+                PushHandler on_push,
+                StateHandler on_state);
+
+private:
+    class Connection;
+
+    Connection& pick();
+
+    asio::io_context& io_;
+    std::string host_;
+    int port_;
+    std::vector<std::shared_ptr<Connection>> connections_;
+    std::vector<std::shared_ptr<Connection>> listeners_;
+    std::atomic<size_t> next_ {0};
+};
@@ -0,0 +1,169 @@
+#include "compression.hpp"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace {
+
+constexpr size_t kOutChunk = 16 * 1024;
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+std::string lower(std::string_view s) {
+    std::string out(s);
+    for (auto& c : out) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return out;
+}
+
+bool ends_with(std::string_view s, std::string_view suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// "gzip;q=0.5" -> q; без q — 1.
+double quality(std::string_view params) {
+    while (!params.empty()) {
+        const auto semicolon = params.find(';');
+        auto param = trim(params.substr(0, semicolon));
+        params = semicolon == std::string_view::npos ? std::string_view() : params.substr(semicolon + 1);
+        if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+            return std::strtod(std::string(param.substr(2)).c_str(), nullptr);
+        }
+    }
+    return 1.0;
+}
+
+} // namespace
+
+ContentEncoding negotiate_encoding(std::string_view accept_encoding) {
+    double gzip = -1, deflate = -1, any = -1;
+    while (!accept_encoding.empty()) {
+        const auto comma = accept_encoding.find(',');
+        auto item = trim(accept_encoding.substr(0, comma));
+        accept_encoding = comma == std::string_view::npos ? std::string_view() : accept_encoding.substr(comma + 1);
+
+        const auto semicolon = item.find(';');
+        const auto coding = lower(trim(item.substr(0, semicolon)));
+        const double q = semicolon == std::string_view::npos ? 1.0 : quality(item.substr(semicolon + 1));
+        if (coding == "gzip" || coding == "x-gzip") gzip = q;
+        else if (coding == "deflate") deflate = q;
+        else if (coding == "*") any = q;
+    }
+    if (gzip < 0) gzip = any;
+    if (deflate < 0) deflate = any;
+
+    if (gzip > 0 && gzip >= deflate) return ContentEncoding::Gzip;
+    if (deflate > 0) return ContentEncoding::Deflate;
+    return ContentEncoding::Identity;
+}
+
+const char* encoding_name(ContentEncoding encoding) {
+    switch (encoding) {
+        case ContentEncoding::Gzip: return "gzip";
+        case ContentEncoding::Deflate: return "deflate";
+        default: return "identity";
+    }
+}
+
+// --- Deflater ---
+
+Deflater::Deflater(ContentEncoding encoding, int level) : zs_(std::make_unique<z_stream_s>()) {
+    // windowBits: 15 — zlib-обёртка, +16 — gzip.
+    const int window_bits = encoding == ContentEncoding::Gzip ? 15 + 16 : 15;
+    if (deflateInit2(zs_.get(), level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::runtime_error("deflateInit2 failed");
+    }
+}
+
+Deflater::~Deflater() {
+    deflateEnd(zs_.get());
+}
+
+void Deflater::write(std::string_view in, std::string& out) {
+    run(in, Z_NO_FLUSH, out);
+}
+
+void Deflater::finish(std::string& out) {
+    run({}, Z_FINISH, out);
+}
+
+void Deflater::run(std::string_view in, int flush, std::string& out) {
+    zs_->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    zs_->avail_in = static_cast<uInt>(in.size());
+    do {
+        const size_t before = out.size();
+        out.resize(before + kOutChunk);
+        zs_->next_out = reinterpret_cast<Bytef*>(&out[before]);
+        zs_->avail_out = static_cast<uInt>(kOutChunk);
+
+        const int rc = deflate(zs_.get(), flush);
+        out.resize(before + kOutChunk - zs_->avail_out);
+        if (rc == Z_STREAM_ERROR) throw std::runtime_error("deflate failed");
+        if (rc == Z_STREAM_END) break;
+    } while (zs_->avail_in > 0 || zs_->avail_out == 0 || flush == Z_FINISH);
+}
+
+std::string compress_body(std::string_view body, ContentEncoding encoding, int level) {
+    Deflater deflater(encoding, level);
+    std::string out;
+    // Текст обычно сжимается в 3-5 раз — сразу места с запасом на это.
+    out.reserve(body.size() / 3 + 64);
+    deflater.write(body, out);
+    deflater.finish(out);
+    return out;
+}
+
+// --- Compression middleware ---
+
+bool Compression::compressible(std::string_view content_type) const {
+    const auto type = lower(trim(content_type.substr(0, content_type.find(';'))));
+    if (type.empty()) return false;
+    if (ends_with(type, "+json") || ends_with(type, "+xml")) return true;
+    return std::find(options.content_types.begin(), options.content_types.end(), type) != options.content_types.end();
+}
+
+void Compression::before_handle(crow::request&, crow::response&, context&) {}
+
+void Compression::after_handle(crow::request& req, crow::response& res, context&) {
+    if (options.level <= 0 || res.body.size() < options.min_size) return;
+    if (res.code < 200 || res.code == 204 || res.code == 206 || res.code == 304) return;
+    if (!res.get_header_value("Content-Encoding").empty()) return;
+    if (lower(res.get_header_value("Cache-Control")).find("no-transform") != std::string::npos) return;
+    if (!compressible(res.get_header_value("Content-Type"))) return;
+
+    // Ответ зависит от Accept-Encoding, даже если сейчас отдаём как есть.
+    const auto vary = res.get_header_value("Vary");
+    if (vary.empty()) {
+        res.set_header("Vary", "Accept-Encoding");
+    } else if (lower(vary).find("accept-encoding") == std::string::npos) {
+        res.set_header("Vary", vary + ", Accept-Encoding");
+    }
+
+    const auto encoding = negotiate_encoding(req.get_header_value("Accept-Encoding"));
+    if (encoding == ContentEncoding::Identity) return;
+
+    std::string compressed;
+    try {
+        compressed = compress_body(res.body, encoding, options.level);
+    } catch (const std::exception& e) {
+        CROW_LOG_WARNING << "compression: " << e.what();
+        return;
+    }
+    if (compressed.size() >= res.body.size()) return;
+
+    res.body = std::move(compressed);
+    res.set_header("Content-Encoding", encoding_name(encoding));
+
+    // Байты уже другие — сильный ETag (например, из Main) становится слабым.
+    const auto etag = res.get_header_value("ETag");
+    if (!etag.empty() && etag.compare(0, 2, "W/") != 0) {
+        res.set_header("ETag", "W/" + etag);
+    }
+}
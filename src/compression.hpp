@@ -0,0 +1,64 @@
+#pragma once
+#include <crow.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct z_stream_s;
+
+enum class ContentEncoding { Identity, Gzip, Deflate };
+
+// Лучшая из поддерживаемых кодировок по Accept-Encoding (с учётом q и "*").
+// При равных q — gzip.
+ContentEncoding negotiate_encoding(std::string_view accept_encoding);
+const char* encoding_name(ContentEncoding encoding);
+
+// Потоковое сжатие zlib: куски можно подавать по мере поступления,
+// выход дописывается в out. Deflate — это zlib-обёртка, как требует HTTP.
+// Ошибка инициализации zlib — std::runtime_error.
+class Deflater {
+public:
+    Deflater(ContentEncoding encoding, int level);
+    ~Deflater();
+
+    Deflater(const Deflater&) = delete;
+    Deflater& operator=(const Deflater&) = delete;
+
+    void write(std::string_view in, std::string& out);
+    void finish(std::string& out);
+
+private:
+    void run(std::string_view in, int flush, std::string& out);
+
+    std::unique_ptr<z_stream_s> zs_;
+};
+
+std::string compress_body(std::string_view body, ContentEncoding encoding, int level);
+
+struct CompressionOptions {
+    int level = 6;          // 1..9; 0 — не сжимать
+    size_t min_size = 1024; // тела короче не стоят лишнего CPU
+    // Сжимаются только эти типы (без параметров), а также *+json и *+xml.
+    std::vector<std::string> content_types = {
+        "text/html", "text/plain", "text/css", "text/csv", "text/xml",
+        "application/json", "application/javascript", "application/xml", "image/svg+xml",
+    };
+};
+
+// Middleware Crow: сжимает готовый ответ (страницы и тела из Main) по
+// Accept-Encoding клиента. Срабатывает и для асинхронных ответов — при
+// res.end(). Не трогает ответы, у которых уже есть Content-Encoding,
+// Cache-Control: no-transform, а также 1xx/204/206/304.
+struct Compression {
+    struct context {};
+
+    CompressionOptions options;
+
+    void before_handle(crow::request& req, crow::response& res, context& ctx);
+    void after_handle(crow::request& req, crow::response& res, context& ctx);
+
+    bool compressible(std::string_view content_type) const;
+};
@@ -0,0 +1,186 @@
+#include "config.hpp"
+#include "utils.hpp"
+
+#include <crow.h>
+
+#include <atomic>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+// Значения из CONFIG_FILE поверх окружения.
+class Source {
+public:
+    Source() {
+        const auto path = get_env("CONFIG_FILE", "");
+        if (path.empty()) return;
+        std::ifstream in(path);
+        if (!in) throw std::invalid_argument("CONFIG_FILE: cannot read " + path);
+
+        std::string line;
+        for (int number = 1; std::getline(in, line); ++number) {
+            const auto begin = line.find_first_not_of(" \t");
+            if (begin == std::string::npos || line[begin] == '#') continue;
+            const auto eq = line.find('=', begin);
+            if (eq == std::string::npos) {
+                throw std::invalid_argument(path + ":" + std::to_string(number) + ": expected KEY=VALUE");
+            }
+            auto key = line.substr(begin, eq - begin);
+            key.erase(key.find_last_not_of(" \t") + 1);
+            const auto value_begin = line.find_first_not_of(" \t", eq + 1);
+            const auto value_end = line.find_last_not_of(" \t\r");
+            values_[key] = value_begin == std::string::npos || value_end < value_begin
+                ? std::string()
+                : line.substr(value_begin, value_end - value_begin + 1);
+        }
+    }
+
+    std::string str(const char* key, const std::string& fallback) const {
+        auto it = values_.find(key);
+        return it != values_.end() ? it->second : get_env(key, fallback);
+    }
+
+    long long integer(const char* key, long long fallback) const {
+        const auto value = str(key, std::to_string(fallback));
+        try {
+            size_t used = 0;
+            const long long parsed = std::stoll(value, &used);
+            if (used == value.size() && parsed >= 0) return parsed;
+        } catch (const std::logic_error&) {
+        }
+        throw std::invalid_argument(std::string(key) + ": expected a non-negative integer, got '" + value + "'");
+    }
+
+    // Целое в [min, max]: иначе static_cast молча обрезал бы, например, PORT=70000 до 4464.
+    long long integer(const char* key, long long fallback, long long min, long long max) const {
+        const long long value = integer(key, fallback);
+        if (value < min || value > max) {
+            throw std::invalid_argument(std::string(key) + ": expected " + std::to_string(min) + ".." +
+                                        std::to_string(max) + ", got " + std::to_string(value));
+        }
+        return value;
+    }
+
+    double real(const char* key, double fallback) const {
+        const auto value = str(key, std::to_string(fallback));
+        try {
+            size_t used = 0;
+            const double parsed = std::stod(value, &used);
+            if (used == value.size()) return parsed;
+        } catch (const std::logic_error&) {
+        }
+        throw std::invalid_argument(std::string(key) + ": expected a number, got '" + value + "'");
+    }
+
+private:
+    std::unordered_map<std::string, std::string> values_;
+};
+
+std::shared_ptr<const Config>& current() {
+    static std::shared_ptr<const Config> snapshot;
+    return snapshot;
+}
+
+} // namespace
+
+Config load_config() {
+    using std::chrono::milliseconds;
+    using std::chrono::seconds;
+
+    const Source source;
+    Config c;
+    c.port = static_cast<int>(source.integer("PORT", c.port, 1, 65535));
+    // 0 — по числу ядер.
+    c.worker_threads = static_cast<unsigned>(source.integer("WORKER_THREADS", c.worker_threads, 0, 1024));
+
+    c.redis_host = source.str("REDIS_HOST", c.redis_host);
+    c.redis_port = static_cast<int>(source.integer("REDIS_PORT", c.redis_port, 1, 65535));
+    c.redis_pool_size = static_cast<size_t>(source.integer("REDIS_POOL_SIZE", c.redis_pool_size));
+    c.redis_async_connections =
+        static_cast<size_t>(source.integer("REDIS_ASYNC_CONNECTIONS", c.redis_async_connections));
+
+    // MAIN_BASE_URL не нужен — используем только MAIN_URL
+    c.auth_url = source.str("AUTH_URL", c.auth_url);
+    c.main_url = source.str("MAIN_URL", c.main_url);
+    c.upstream_connect_timeout =
+        milliseconds(source.integer("UPSTREAM_CONNECT_TIMEOUT_MS", c.upstream_connect_timeout.count()));
+    c.upstream_timeout = milliseconds(source.integer("UPSTREAM_TIMEOUT_MS", c.upstream_timeout.count()));
+    c.main_cache_capacity = static_cast<size_t>(source.integer("MAIN_CACHE_CAPACITY", c.main_cache_capacity));
+    c.proxy_max_body = static_cast<size_t>(source.integer("PROXY_MAX_BODY", c.proxy_max_body));
+
+    c.session_ttl_anonymous = seconds(source.integer("SESSION_TTL_ANONYMOUS", c.session_ttl_anonymous.count()));
+    c.session_ttl_authorized = seconds(source.integer("SESSION_TTL_AUTHORIZED", c.session_ttl_authorized.count()));
+    c.token_refresh_ahead = seconds(source.integer("TOKEN_REFRESH_AHEAD", c.token_refresh_ahead.count()));
+    c.refresh_wait = milliseconds(source.integer("REFRESH_WAIT_MS", c.refresh_wait.count()));
+    c.login_poll_min = milliseconds(source.integer("LOGIN_POLL_MIN_MS", c.login_poll_min.count()));
+    c.login_poll_max = milliseconds(source.integer("LOGIN_POLL_MAX_MS", c.login_poll_max.count()));
+
+    c.compression_level = static_cast<int>(source.integer("COMPRESSION_LEVEL", c.compression_level));
+    c.compression_min_size = static_cast<size_t>(source.integer("COMPRESSION_MIN_SIZE", c.compression_min_size));
+    c.trace_sample_rate = source.real("TRACE_SAMPLE_RATE", c.trace_sample_rate);
+    c.trace_trust_parent = source.str("TRACE_TRUST_PARENT", "0") != "0";
+    c.trace_server_timing = source.str("TRACE_SERVER_TIMING", "0") != "0";
+    c.trace_export_file = source.str("TRACE_EXPORT_FILE", c.trace_export_file);
+    return c;
+}
+
+std::vector<std::string> restart_required(const Config& old, const Config& next) {
+    std::vector<std::string> changed;
+    const auto check = [&changed](bool differs, const char* key) {
+        if (differs) changed.push_back(key);
+    };
+    check(old.port != next.port, "PORT");
+    check(old.worker_threads != next.worker_threads, "WORKER_THREADS");
+    check(old.redis_host != next.redis_host, "REDIS_HOST");
+    check(old.redis_port != next.redis_port, "REDIS_PORT");
+    check(old.redis_pool_size != next.redis_pool_size, "REDIS_POOL_SIZE");
+    check(old.redis_async_connections != next.redis_async_connections, "REDIS_ASYNC_CONNECTIONS");
+    check(old.main_cache_capacity != next.main_cache_capacity, "MAIN_CACHE_CAPACITY");
+    check(old.session_ttl_anonymous != next.session_ttl_anonymous, "SESSION_TTL_ANONYMOUS");
+    check(old.session_ttl_authorized != next.session_ttl_authorized, "SESSION_TTL_AUTHORIZED");
+    check(old.token_refresh_ahead != next.token_refresh_ahead, "TOKEN_REFRESH_AHEAD");
+    check(old.refresh_wait != next.refresh_wait, "REFRESH_WAIT_MS");
+    check(old.login_poll_min != next.login_poll_min, "LOGIN_POLL_MIN_MS");
+    check(old.login_poll_max != next.login_poll_max, "LOGIN_POLL_MAX_MS");
+    check(old.compression_level != next.compression_level, "COMPRESSION_LEVEL");
+    check(old.compression_min_size != next.compression_min_size, "COMPRESSION_MIN_SIZE");
+    check(old.trace_sample_rate != next.trace_sample_rate, "TRACE_SAMPLE_RATE");
+    check(old.trace_trust_parent != next.trace_trust_parent, "TRACE_TRUST_PARENT");
+    check(old.trace_server_timing != next.trace_server_timing, "TRACE_SERVER_TIMING");
+    check(old.trace_export_file != next.trace_export_file, "TRACE_EXPORT_FILE");
+    return changed;
+}
+
+std::shared_ptr<const Config> config() {
+    auto snapshot = std::atomic_load(&current());
+    if (snapshot) return snapshot;
+
+    // Первый вызов без set_config: при гонке побеждает один снимок.
+    std::shared_ptr<const Config> loaded = std::make_shared<const Config>(load_config());
+    std::atomic_compare_exchange_strong(&current(), &snapshot, loaded);
+    return std::atomic_load(&current());
+}
+
+void set_config(std::shared_ptr<const Config> next) {
+    std::atomic_store(&current(), std::move(next));
+}
+
+bool reload_config() {
+    std::shared_ptr<const Config> next;
+    try {
+        next = std::make_shared<const Config>(load_config());
+    } catch (const std::exception& e) {
+        CROW_LOG_ERROR << "config reload: " << e.what() << "; keeping the current config";
+        return false;
+    }
+
+    const auto old = config();
+    for (const auto& key : restart_required(*old, *next)) {
+        CROW_LOG_WARNING << "config reload: " << key << " changed, takes effect after restart";
+    }
+    set_config(next);
+    CROW_LOG_INFO << "config reloaded: AUTH_URL=" << next->auth_url << " MAIN_URL=" << next->main_url;
+    return true;
+}
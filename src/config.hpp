@@ -0,0 +1,65 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Настройки процесса одним неизменяемым снимком. Читаются из переменных
+// окружения; если задан CONFIG_FILE — сначала из него (строки KEY=VALUE,
+// '#' — комментарий), окружение — для ключей, которых в файле нет.
+//
+// Снимок не меняется: перезагрузка (SIGHUP) собирает новый и подменяет
+// указатель. Запрос, взявший снимок, дорабатывает с ним до конца.
+struct Config {
+    // Сервер
+    int port = 8080;
+    unsigned worker_threads = 0; // 0 — по числу ядер
+
+    // Redis
+    std::string redis_host = "redis";
+    int redis_port = 6379;
+    size_t redis_pool_size = 8;          // соединений у блокирующего клиента
+    size_t redis_async_connections = 2;  // у неблокирующего
+
+    // Upstream
+    std::string auth_url = "https://religiose-multinodular-jaqueline.ngrok-free.dev";
+    std::string main_url = "https://shabbiest-continuately-zulma.ngrok-free.dev";
+    std::chrono::milliseconds upstream_connect_timeout {10000};
+    std::chrono::milliseconds upstream_timeout {0}; // 0 — без предела (прокси больших файлов)
+    size_t main_cache_capacity = 10000;
+    size_t proxy_max_body = 8 * 1024 * 1024;
+
+    // Сессии и вход
+    std::chrono::seconds session_ttl_anonymous {900};
+    std::chrono::seconds session_ttl_authorized {86400};
+    std::chrono::seconds token_refresh_ahead {60};
+    std::chrono::milliseconds refresh_wait {5000}; // страница ждёт refresh не дольше
+    std::chrono::milliseconds login_poll_min {1000};
+    std::chrono::milliseconds login_poll_max {10000};
+
+    // Ответы
+    int compression_level = 6;
+    size_t compression_min_size = 1024;
+    double trace_sample_rate = 0;
+    bool trace_trust_parent = false;
+    bool trace_server_timing = false;
+    std::string trace_export_file;
+};
+
+// Собрать снимок из CONFIG_FILE и окружения. Неверное значение или
+// нечитаемый файл — std::invalid_argument с именем ключа.
+Config load_config();
+
+// Поля, которые различаются у old и next, но применяются только при
+// старте (порт, потоки, Redis, сроки сессий...): после перезагрузки их
+// новое значение заработает лишь после перезапуска.
+std::vector<std::string> restart_required(const Config& old, const Config& next);
+
+// Текущий снимок; до первого set_config — load_config() при первом вызове.
+std::shared_ptr<const Config> config();
+void set_config(std::shared_ptr<const Config> next);
+
+// Перечитать и подменить снимок (SIGHUP). Ошибка чтения — пишется в лог,
+// остаётся прежний снимок и возвращается false.
+bool reload_config();
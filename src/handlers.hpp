@@ -1,9 +1,19 @@
 #pragma once
 #include <crow.h>
-#include "redis.hpp"
+#include "app.hpp"
+#include "login_poller.hpp"
+#include "session_refresh.hpp"
+#include "session_store.hpp"
 #include "utils.hpp"
 
-void register_root(crow::SimpleApp& app, RedisClient& redis);
-void register_login(crow::SimpleApp& app, RedisClient& redis);
-void register_logout(crow::SimpleApp& app, RedisClient& redis);
-void register_catchall(crow::SimpleApp& app, RedisClient& redis);
+void register_root(App& app,
+                   SessionStore& sessions,
+                   SessionRefresher& refresher,
+                   LoginPoller& login_poller);
+void register_login(App& app, SessionStore& sessions);
+void register_logout(App& app, SessionStore& sessions);
+void register_metrics(App& app);
+void register_catchall(App& app,
+                       SessionStore& sessions,
+                       SessionRefresher& refresher,
+                       LoginPoller& login_poller);
@@ -1,26 +1,35 @@
 #include "common.hpp"
-#include <nlohmann/json.hpp>
+#include <asio.hpp>
 
+#include <chrono>
+#include <memory>
+#include <optional>
 #include <vector>
 #include <string>
+#include <string_view>
 
-#include "../redis.hpp"
+#include "../html.hpp"
+#include "../login_poller.hpp"
+#include "../pages.hpp"
 #include "../session.hpp"
+#include "../session_store.hpp"
+#include "../static_page.hpp"
 #include "../utils.hpp"
 
-#include "../api/auth_client.hpp"
-#include "../api/main_client.hpp"
+#include "../api/upstreams.hpp"
 
 namespace {
 
-std::string auth_base_url() {
-    return get_env("AUTH_URL", "https://religiose-multinodular-jaqueline.ngrok-free.dev");
-}
+// Заголовки ответа Main, которые отдаём клиенту. Hop-by-hop (Connection,
+// Transfer-Encoding, Keep-Alive...) и Content-Length не переносим: их
+// выставляет сам Crow.
+constexpr const char* kProxiedResponseHeaders[] = {
+    "content-type", "content-disposition", "content-language", "content-encoding",
+    "cache-control", "etag", "last-modified", "expires", "location", "vary",
+};
 
-std::string main_base_url() {
-    // MAIN_BASE_URL не нужен — используем только MAIN_URL
-    return get_env("MAIN_URL", "https://shabbiest-continuately-zulma.ngrok-free.dev");
-}
+// Заголовки клиента, без которых Main не разберёт тело или формат ответа.
+constexpr const char* kProxiedRequestHeaders[] = {"Content-Type", "Accept"};
 
 crow::response redirect_to(const std::string& location) {
     crow::response res(302);
@@ -28,62 +37,62 @@ crow::response redirect_to(const std::string& location) {
     return res;
 }
 
-// --- safe HTML helpers ---
-
-std::string html_escape(const std::string& s) {
-    std::string out;
-    out.reserve(s.size());
-    for (char c : s) {
-        switch (c) {
-            case '&': out += "&amp;"; break;
-            case '<': out += "&lt;";  break;
-            case '>': out += "&gt;";  break;
-            case '"': out += "&quot;"; break;
-            case '\'': out += "&#39;"; break;
-            default: out += c; break;
-        }
-    }
-    return out;
+// "session:<uuid>" -> "<uuid>"
+std::string session_id(const std::string& session_key) {
+    const std::string prefix = "session:";
+    return session_key.compare(0, prefix.size(), prefix) == 0 ? session_key.substr(prefix.size()) : session_key;
 }
 
-crow::response html_response(const std::string& html) {
-    crow::response res(html);
+// --- pages ---
+
+crow::response html_response(std::string html) {
+    crow::response res(std::move(html));
     res.add_header("Content-Type", "text/html; charset=utf-8");
     return res;
 }
 
-std::string wrap_html(const std::string& title, const std::string& body) {
-    return
-        "<!doctype html>"
-        "<html lang='ru'>"
-        "<head>"
-        "<meta charset='utf-8'>"
-        "<meta name='viewport' content='width=device-width, initial-scale=1'>"
-        "<title>" + html_escape(title) + "</title>"
-        "</head>"
-        "<body>" + body + "</body>"
-        "</html>";
+crow::response access_denied_page() {
+    return html_response(wrap_html("Access denied", "<h1>Access denied</h1>"));
 }
 
-// --- pages ---
-
-crow::response login_page() {
-    std::string body =
-        std::string("<h1>Login</h1>")
-        + "<a href='/login?type=github'>GitHub</a><br>"
-        + "<a href='/login?type=yandex'>Yandex</a><br>"
-        + "<a href='/login?type=code'>Code</a>";
+// Страницы входа одинаковы для всех — собраны и сжаты при старте.
+// no-cache: "/" у вошедшего — уже dashboard, так что браузер обязан
+// переспрашивать, но на совпавший ETag получает 304 без тела.
+const StaticPage kLoginPage(
+    "text/html; charset=utf-8",
+    wrap_html("Login", kLoginLinks),
+    "no-cache");
+
+// Вход начат, ждём подтверждения от Auth.
+const StaticPage kLoginPendingPage(
+    "text/html; charset=utf-8",
+    wrap_html("Login", std::string("<h1>Login</h1><p>Waiting for confirmation...</p>") + std::string(kLoginLinks)),
+    "no-cache",
+    {{"Refresh", "2"}});
+
+crow::response login_page(const crow::request& req) {
+    return kLoginPage.respond(req);
+}
 
-    return html_response(wrap_html("Login", body));
+crow::response login_pending_page(const crow::request& req) {
+    return kLoginPendingPage.respond(req);
 }
 
-crow::response dashboard_page() {
-    std::string body =
-        std::string("<h1>Dashboard</h1>")
-        + "<a href='/logout'>Logout</a><br>"
-        + "<a href='/logout?all=true'>Logout everywhere</a>";
+// Обновление токенов не уложилось в REFRESH_WAIT_MS: worker не держим,
+// страница сама повторит запрос — к тому времени токен, скорее всего, готов.
+const StaticPage kRefreshPendingPage(
+    "text/html; charset=utf-8",
+    wrap_html("Please wait", "<h1>Please wait</h1><p>Updating session...</p>"),
+    "no-store",
+    {{"Refresh", "1"}});
 
-    return html_response(wrap_html("Dashboard", body));
+crow::response refresh_pending_page(const crow::request& req) {
+    return kRefreshPendingPage.respond(req);
+}
+
+// Ответ Main как есть, в <pre>.
+crow::response text_page(std::string_view title, std::string_view back, std::string_view text) {
+    return html_response(render_text_page(title, back, text));
 }
 
 std::string path_only(const std::string& url) {
@@ -108,135 +117,97 @@ std::string method_to_string(crow::HTTPMethod m) {
 struct MainCallResult {
     int status;
     std::string body;
+    bool pending = false; // refresh ещё идёт, ответа нет
 };
 
 MainCallResult main_get_with_refresh(
     const std::string& url,
-    RedisClient& redis,
+    SessionStore& sessions,
+    SessionRefresher& refresher,
     const std::string& session_key,
     SessionData& session
 ) {
-    MainClient main(main_base_url());
+    const auto upstream = upstreams();
+    const MainClient& main = upstream->main;
     auto r = main.Do("GET", url, "", session.access_token);
 
     if (r.status != 401) {
         return {r.status, r.body};
     }
 
-    // 401 → пробуем refresh один раз
-    AuthClient auth(auth_base_url());
-    auto refreshed = auth.Refresh(session.refresh_token);
+    // 401 → пробуем refresh один раз (общий с параллельными запросами сессии)
+    bool pending = false;
+    auto refreshed = refresher.refresh(session_key, session, &pending);
     if (!refreshed) {
-        redis.del(session_key);
-        return {401, ""};
+        return {401, "", pending};
     }
-
-    session.access_token = refreshed->access_token;
-    session.refresh_token = refreshed->refresh_token;
-    redis.set(session_key, serialize_session(session));
+    session = std::move(*refreshed);
 
     // retry
     r = main.Do("GET", url, "", session.access_token);
     if (r.status == 401) {
-        redis.del(session_key);
+        sessions.drop(session_key);
         return {401, ""};
     }
 
     return {r.status, r.body};
 }
 
-// --- JSON helpers ---
-
-std::vector<nlohmann::json> json_as_list(const nlohmann::json& j) {
-    if (j.is_array()) return j.get<std::vector<nlohmann::json>>();
-
-    if (j.is_object()) {
-        for (const char* key : {"items", "results", "data"}) {
-            auto it = j.find(key);
-            if (it != j.end() && it->is_array()) {
-                return it->get<std::vector<nlohmann::json>>();
-            }
-        }
+// То же для нескольких GET сразу: запросы идут параллельно, refresh —
+// не больше одного на всю пачку, повторяются только ответившие 401.
+std::vector<MainCallResult> main_get_all_with_refresh(
+    const std::vector<std::string>& urls,
+    SessionStore& sessions,
+    SessionRefresher& refresher,
+    const std::string& session_key,
+    SessionData& session
+) {
+    const auto upstream = upstreams();
+    const MainClient& main = upstream->main;
+    std::vector<MainCallResult> results;
+    results.reserve(urls.size());
+    for (auto& r : main.GetAll(urls, session.access_token)) {
+        results.push_back({r.status, std::move(r.body)});
     }
-    return {};
-}
 
-std::string json_get_str(const nlohmann::json& o, const std::vector<std::string>& keys) {
-    for (const auto& k : keys) {
-        auto it = o.find(k);
-        if (it != o.end()) {
-            if (it->is_string()) return it->get<std::string>();
-            if (it->is_number_integer()) return std::to_string(it->get<long long>());
-            if (it->is_number_unsigned()) return std::to_string(it->get<unsigned long long>());
-        }
+    std::vector<size_t> unauthorized;
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (results[i].status == 401) unauthorized.push_back(i);
     }
-    return "";
-}
+    if (unauthorized.empty()) return results;
 
-std::string link_list_from_json(const std::string& title,
-                               const std::string& raw_json,
-                               const std::string& base_path,
-                               const std::string& id_param,
-                               const std::vector<std::string>& id_keys,
-                               const std::vector<std::string>& label_keys) {
-    std::string html;
-    html += "<h2>" + html_escape(title) + "</h2>";
-
-    nlohmann::json j;
-    try {
-        j = nlohmann::json::parse(raw_json);
-    } catch (...) {
-        html += "<p><b>Не смог распарсить JSON</b></p>";
-        html += "<pre>" + html_escape(raw_json) + "</pre>";
-        return html;
-    }
-
-    auto items = json_as_list(j);
-    if (items.empty()) {
-        html += "<pre>" + html_escape(raw_json) + "</pre>";
-        return html;
-    }
-
-    html += "<ul>";
-    for (const auto& it : items) {
-        if (!it.is_object()) continue;
-
-        std::string id = json_get_str(it, id_keys);
-        std::string label = json_get_str(it, label_keys);
-        if (label.empty()) label = id.empty() ? "(item)" : ("ID " + id);
-
-        if (!id.empty()) {
-            html += "<li><a href='" + base_path + "?" + id_param + "=" + id + "'>"
-                 + html_escape(label) + "</a></li>";
+    bool pending = false;
+    auto refreshed = refresher.refresh(session_key, session, &pending);
+    if (!refreshed) {
+        for (size_t i : unauthorized) results[i] = {401, "", pending};
+        return results;
+    }
+    session = std::move(*refreshed);
+
+    std::vector<std::string> retry_urls;
+    retry_urls.reserve(unauthorized.size());
+    for (size_t i : unauthorized) retry_urls.push_back(urls[i]);
+
+    auto retried = main.GetAll(retry_urls, session.access_token);
+    bool still_unauthorized = false;
+    for (size_t k = 0; k < unauthorized.size(); ++k) {
+        auto& r = retried[k];
+        if (r.status == 401) {
+            still_unauthorized = true;
+            results[unauthorized[k]] = {401, ""};
         } else {
-            html += "<li>" + html_escape(label) + "</li>";
+            results[unauthorized[k]] = {r.status, std::move(r.body)};
         }
     }
-    html += "</ul>";
+    if (still_unauthorized) sessions.drop(session_key);
 
-    return html;
+    return results;
 }
 
 crow::response dashboard_page_with_data(const std::string& courses_json,
                                        const std::string& notif_json,
                                        const std::string* users_json_or_null) {
-    std::string html;
-
-    html += "<h1>Dashboard</h1>";
-    html += "<a href='/logout'>Logout</a><br>";
-    html += "<a href='/logout?all=true'>Logout everywhere</a>";
-    html += "<hr>";
-
-    // Навигация
-    html += "<h2>Навигация</h2>";
-    html += "<ul>";
-    html += "<li><a href='/courses'>Courses</a></li>";
-    html += "<li><a href='/notifications'>Notifications</a></li>";
-    html += "<li><a href='/users'>Users</a></li>";
-    html += "</ul>";
-    html += "<hr>";
-
-    html += link_list_from_json(
+    const auto courses = parse_link_list(
         "Courses (кликабельно, если есть id/course_id)",
         courses_json,
         "/course",
@@ -245,45 +216,62 @@ crow::response dashboard_page_with_data(const std::string& courses_json,
         {"name", "title", "description"}
     );
 
-    html += "<h2>Notifications</h2>";
-    html += "<pre>" + html_escape(notif_json) + "</pre>";
-
-    if (users_json_or_null) {
-        html += link_list_from_json(
-            "Users (кликабельно, если есть id)",
-            *users_json_or_null,
-            "/user",
-            "id",
-            {"id", "user_id"},
-            {"fullName", "full_name", "name", "fio"}
-        );
-    } else {
-        html += "<h2>Users</h2><p><i>Нет доступа или endpoint недоступен</i></p>";
+    if (!users_json_or_null) {
+        return html_response(render_dashboard_page(courses, notif_json, nullptr));
     }
 
-    return html_response(wrap_html("Dashboard", html));
+    const auto users = parse_link_list(
+        "Users (кликабельно, если есть id)",
+        *users_json_or_null,
+        "/user",
+        "id",
+        {"id", "user_id"},
+        {"fullName", "full_name", "name", "fio"}
+    );
+    return html_response(render_dashboard_page(courses, notif_json, &users));
 }
 
 // --- END helpers ---
 
+// Страницы, которые собираем сами; остальные URL авторизованного
+// пользователя — прокси в Main.
+bool is_page_path(const std::string& path) {
+    for (const char* page : {"/", "/login", "/courses", "/users", "/notifications", "/course", "/user"}) {
+        if (path == page) return true;
+    }
+    return false;
+}
+
 crow::response handle_authorized(const crow::request& req,
-                                RedisClient& redis,
+                                SessionStore& sessions,
+                                SessionRefresher& refresher,
                                 const std::string& session_key,
                                 SessionData session) {
     const std::string path = path_only(req.url);
 
+    // Токен истёк по exp — обновляем до запросов в Main, а не после их 401.
+    bool pending = false;
+    if (!refresher.ensure_fresh(session_key, session, &pending)) {
+        return pending ? refresh_pending_page(req) : redirect_to("/");
+    }
+
     // Dashboard: интеграция с Main (и refresh работает через helper)
     if (path == "/") {
 
-        auto courses = main_get_with_refresh("/courses_list", redis, session_key, session);
+        // Три запроса параллельно: задержка страницы — как у самого медленного.
+        auto results = main_get_all_with_refresh(
+            {"/courses_list", "/notification", "/users_list"}, sessions, refresher, session_key, session);
+        const auto& courses = results[0];
+        const auto& notif = results[1];
+        const auto& users = results[2];
+
+        if (courses.pending || notif.pending || users.pending) return refresh_pending_page(req);
         if (courses.status == 401) return redirect_to("/");
-        if (courses.status == 403) return html_response(wrap_html("Access denied", "<h1>Access denied</h1>"));
+        if (courses.status == 403) return access_denied_page();
 
-        auto notif = main_get_with_refresh("/notification", redis, session_key, session);
         if (notif.status == 401) return redirect_to("/");
-        if (notif.status == 403) return html_response(wrap_html("Access denied", "<h1>Access denied</h1>"));
+        if (notif.status == 403) return access_denied_page();
 
-        auto users = main_get_with_refresh("/users_list", redis, session_key, session);
         if (users.status == 401) return redirect_to("/");
 
         if (users.status == 403 || users.status < 200 || users.status >= 300) {
@@ -298,41 +286,36 @@ crow::response handle_authorized(const crow::request& req,
 
     // Списки
     if (path == "/courses") {
-        auto r = main_get_with_refresh("/courses_list", redis, session_key, session);
+        auto r = main_get_with_refresh("/courses_list", sessions, refresher, session_key, session);
+        if (r.pending) return refresh_pending_page(req);
         if (r.status == 401) return redirect_to("/");
-        if (r.status == 403) return html_response(wrap_html("Access denied", "<h1>Access denied</h1>"));
-
-        std::string body;
-        body += "<h1>Courses</h1><a href='/'>Back</a><hr>";
-        body += link_list_from_json("Courses", r.body, "/course", "course_id",
-                                   {"course_id","id"}, {"name","title","description"});
+        if (r.status == 403) return access_denied_page();
 
-        return html_response(wrap_html("Courses", body));
+        return html_response(render_list_page(
+            "Courses", "/",
+            parse_link_list("Courses", r.body, "/course", "course_id",
+                            {"course_id","id"}, {"name","title","description"})));
     }
 
     if (path == "/users") {
-        auto r = main_get_with_refresh("/users_list", redis, session_key, session);
+        auto r = main_get_with_refresh("/users_list", sessions, refresher, session_key, session);
+        if (r.pending) return refresh_pending_page(req);
         if (r.status == 401) return redirect_to("/");
-        if (r.status == 403) return html_response(wrap_html("Access denied", "<h1>Access denied</h1>"));
+        if (r.status == 403) return access_denied_page();
 
-        std::string body;
-        body += "<h1>Users</h1><a href='/'>Back</a><hr>";
-        body += link_list_from_json("Users", r.body, "/user", "id",
-                                   {"id","user_id"}, {"fullName","full_name","name","fio"});
-
-        return html_response(wrap_html("Users", body));
+        return html_response(render_list_page(
+            "Users", "/",
+            parse_link_list("Users", r.body, "/user", "id",
+                            {"id","user_id"}, {"fullName","full_name","name","fio"})));
     }
 
     if (path == "/notifications") {
-        auto r = main_get_with_refresh("/notification", redis, session_key, session);
+        auto r = main_get_with_refresh("/notification", sessions, refresher, session_key, session);
+        if (r.pending) return refresh_pending_page(req);
         if (r.status == 401) return redirect_to("/");
-        if (r.status == 403) return html_response(wrap_html("Access denied", "<h1>Access denied</h1>"));
-
-        std::string body;
-        body += "<h1>Notifications</h1><a href='/'>Back</a><hr>";
-        body += "<pre>" + html_escape(r.body) + "</pre>";
+        if (r.status == 403) return access_denied_page();
 
-        return html_response(wrap_html("Notifications", body));
+        return text_page("Notifications", "/", r.body);
     }
 
     // Детали
@@ -341,15 +324,12 @@ crow::response handle_authorized(const crow::request& req,
         if (!course_id) return html_response(wrap_html("Bad request", "<h1>course_id required</h1>"));
 
         std::string url = std::string("/course_get?course_id=") + course_id;
-        auto r = main_get_with_refresh(url, redis, session_key, session);
+        auto r = main_get_with_refresh(url, sessions, refresher, session_key, session);
+        if (r.pending) return refresh_pending_page(req);
         if (r.status == 401) return redirect_to("/");
-        if (r.status == 403) return html_response(wrap_html("Access denied", "<h1>Access denied</h1>"));
-
-        std::string body;
-        body += "<h1>Course</h1><a href='/courses'>Back</a><hr>";
-        body += "<pre>" + html_escape(r.body) + "</pre>";
+        if (r.status == 403) return access_denied_page();
 
-        return html_response(wrap_html("Course", body));
+        return text_page("Course", "/courses", r.body);
     }
 
     if (path == "/user") {
@@ -357,142 +337,297 @@ crow::response handle_authorized(const crow::request& req,
         if (!id) return html_response(wrap_html("Bad request", "<h1>id required</h1>"));
 
         std::string url = std::string("/user_get?id=") + id;
-        auto r = main_get_with_refresh(url, redis, session_key, session);
+        auto r = main_get_with_refresh(url, sessions, refresher, session_key, session);
+        if (r.pending) return refresh_pending_page(req);
         if (r.status == 401) return redirect_to("/");
-        if (r.status == 403) return html_response(wrap_html("Access denied", "<h1>Access denied</h1>"));
+        if (r.status == 403) return access_denied_page();
 
-        std::string body;
-        body += "<h1>User</h1><a href='/users'>Back</a><hr>";
-        body += "<pre>" + html_escape(r.body) + "</pre>";
+        return text_page("User", "/users", r.body);
+    }
+
+    // Остальные URL проксируются в Main асинхронно (ProxyCall),
+    // сюда они не доходят.
+    return crow::response(404);
+}
+
+// Прокси в Main, не занимающий worker-поток: запросы (и refresh при 401)
+// идут через HTTP-цикл, а res.end() (и сжатие в after_handle) — снова в
+// io_context соединения: сокет Crow не потокобезопасен.
+class ProxyCall : public std::enable_shared_from_this<ProxyCall> {
+public:
+    ProxyCall(const crow::request& req,
+              crow::response& res,
+              SessionStore& sessions,
+              SessionRefresher& refresher,
+              std::string session_key,
+              SessionData session,
+              std::string set_cookie)
+        : io_(*req.io_context),
+          res_(res),
+          sessions_(sessions),
+          refresher_(refresher),
+          method_(method_to_string(req.method)),
+          url_(req.url),
+          body_(req.body),
+          session_key_(std::move(session_key)),
+          session_(std::move(session)),
+          set_cookie_(std::move(set_cookie)) {
+        for (const char* name : kProxiedRequestHeaders) {
+            const auto& value = req.get_header_value(name);
+            if (!value.empty()) forward_headers_.push_back(std::string(name) + ": " + value);
+        }
+    }
 
-        return html_response(wrap_html("User", body));
+    void Start() {
+        if (method_.empty()) {
+            Finish(crow::response(405));
+            return;
+        }
+        if (refresher_.expired(session_)) {
+            // Заведомый 401 не отправляем: сначала refresh, потом запрос.
+            Refresh();
+            return;
+        }
+        refresher_.refresh_if_expiring(session_key_, session_);
+        Send(true);
     }
 
-    // Остальные URL: общий прокси в Main как было
-    const std::string method = method_to_string(req.method);
-    if (method.empty()) {
-        return crow::response(405);
+private:
+    void Refresh() {
+        auto self = shared_from_this();
+        refresher_.refresh(session_key_, session_, [self](std::optional<SessionData> refreshed) {
+            self->OnRefresh(std::move(refreshed));
+        });
     }
 
-    MainClient main(main_base_url());
-    auto main_result = main.Do(method, req.url, req.body, session.access_token);
+    void Send(bool may_refresh) {
+        auto self = shared_from_this();
+        const auto upstream = upstreams();
+        MainForward forward;
+        forward.headers = forward_headers_;
+        forward.max_body = upstream->config->proxy_max_body;
+        // Повтора после этой попытки не будет — тело отдаём без копии.
+        std::string body = may_refresh ? body_ : std::move(body_);
+        upstream->main.DoAsync(method_, url_, std::move(body), session_.access_token, [self, may_refresh](MainResult r) {
+            self->OnMain(std::move(r), may_refresh);
+        }, std::move(forward));
+    }
 
-    if (main_result.status == 401) {
-        // Refresh once
-        AuthClient auth(auth_base_url());
-        auto refreshed = auth.Refresh(session.refresh_token);
-        if (!refreshed) {
-            redis.del(session_key);
-            return redirect_to("/");
+    void OnMain(MainResult r, bool may_refresh) {
+        if (r.status == 401 && may_refresh) {
+            // Refresh once (общий с параллельными запросами сессии)
+            Refresh();
+            return;
         }
 
-        session.access_token = refreshed->access_token;
-        session.refresh_token = refreshed->refresh_token;
-        redis.set(session_key, serialize_session(session));
+        if (r.status == 401) {
+            sessions_.drop(session_key_);
+            Finish(redirect_to("/"));
+            return;
+        }
 
-        // retry once
-        main_result = main.Do(method, req.url, req.body, session.access_token);
+        if (r.status == 403) {
+            Finish(access_denied_page());
+            return;
+        }
+
+        if (r.status == 0) {
+            // Main недоступен или ответ больше PROXY_MAX_BODY.
+            Finish(crow::response(502));
+            return;
+        }
 
-        if (main_result.status == 401) {
-            redis.del(session_key);
-            return redirect_to("/");
+        crow::response out(r.status);
+        for (const char* name : kProxiedResponseHeaders) {
+            auto it = r.headers.find(name);
+            if (it != r.headers.end()) out.set_header(name, it->second);
         }
+        out.body = std::move(r.body);
+        Finish(std::move(out));
     }
 
-    if (main_result.status == 403) {
-        return html_response(wrap_html("Access denied", "<h1>Access denied</h1>"));
+    void OnRefresh(std::optional<SessionData> refreshed) {
+        if (!refreshed) {
+            Finish(redirect_to("/"));
+            return;
+        }
+        session_ = std::move(*refreshed);
+
+        // retry once
+        Send(false);
     }
 
-    crow::response res(main_result.status);
-    res.write(main_result.body);
-    return res;
-}
+    void Finish(crow::response out) {
+        if (!set_cookie_.empty() && out.get_header_value("Set-Cookie").empty()) {
+            out.add_header("Set-Cookie", set_cookie_);
+        }
+        // Из кэша Main ответ приходит сразу, ещё в потоке соединения —
+        // тогда dispatch выполняет на месте.
+        out_ = std::move(out);
+        auto self = shared_from_this();
+        asio::dispatch(io_, [self] {
+            self->res_ = std::move(self->out_);
+            self->res_.end();
+        });
+    }
+
+    asio::io_context& io_;
+    crow::response& res_;
+    SessionStore& sessions_;
+    SessionRefresher& refresher_;
+    std::string method_;
+    std::string url_;
+    std::string body_;
+    std::string session_key_;
+    SessionData session_;
+    std::string set_cookie_;
+    std::vector<std::string> forward_headers_;
+    crow::response out_;
+};
 
 crow::response handle_anonymous(const crow::request& req,
-                               RedisClient& redis,
+                               SessionStore& sessions,
+                               LoginPoller& login_poller,
                                const std::string& session_key,
-                               SessionData session) {
+                               const SessionData& session) {
     const std::string path = path_only(req.url);
 
     if (path == "/login") {
         return redirect_to("/");
     }
 
+    // Пустой login_token — вход так и не начали или Auth отказал.
     if (session.login_token.empty()) {
-        redis.del(session_key);
+        sessions.drop(session_key);
         return redirect_to("/");
     }
 
-    AuthClient auth(auth_base_url());
-    auto st = auth.Status(session.login_token);
+    // В Auth не ходим: статус опрашивает LoginPoller и сам переводит
+    // сессию в authorized, страница просто перезагружается.
+    login_poller.watch(session_key, session.login_token);
 
-    if (!st) {
-        return redirect_to("/");
+    if (path == "/") {
+        return login_pending_page(req);
     }
+    return redirect_to("/");
+}
 
-    const std::string status = st->status;
-
-    if (status == "approved" || status == "success") {
-        if (st->access_token.empty() || st->refresh_token.empty()) {
-            return redirect_to("/");
-        }
-
-        session.status = "authorized";
-        session.access_token = st->access_token;
-        session.refresh_token = st->refresh_token;
-        session.login_token.clear();
+} // namespace
 
-        redis.set(session_key, serialize_session(session));
+namespace {
 
-        return handle_authorized(req, redis, session_key, session);
-    }
+// TTL в Redis продлён — сдвигаем и Max-Age, чтобы cookie не пережила ключ
+// и не умерла раньше него.
+std::string renewed_cookie(SessionStore& sessions, const std::string& session,
+                           const SessionData& data, bool renewed) {
+    if (!renewed) return "";
+    return session_cookie(session, sessions.ttl_for(data).count());
+}
 
-    if (status == "denied" || status == "expired") {
-        redis.del(session_key);
+crow::response respond(const crow::request& req,
+                       SessionStore& sessions,
+                       SessionRefresher& refresher,
+                       LoginPoller& login_poller,
+                       const std::string& path,
+                       const std::string& session,
+                       std::optional<SessionData>& session_data,
+                       bool renewed) {
+    if (!session_data) {
+        if (path == "/") return login_page(req);
         return redirect_to("/");
     }
 
-    if (path == "/") {
-        return login_page();
+    const std::string session_key = "session:" + session;
+    crow::response res = session_data->status == "authorized"
+        ? handle_authorized(req, sessions, refresher, session_key, *session_data)
+        : handle_anonymous(req, sessions, login_poller, session_key, *session_data);
+
+    auto cookie = renewed_cookie(sessions, session, *session_data, renewed);
+    if (!cookie.empty() && res.get_header_value("Set-Cookie").empty()) {
+        res.add_header("Set-Cookie", cookie);
     }
-    return redirect_to("/");
+    return res;
 }
 
 } // namespace
 
-crow::response handle_request(const crow::request& req, RedisClient& redis) {
-    const std::string path = path_only(req.url);
-
-    std::string session = extract_session(req.get_header_value("Cookie"));
-    if (session.empty()) {
-        if (path == "/") return login_page();
-        return redirect_to("/");
-    }
+namespace {
 
+// Сессия прочитана. Страницы собираются здесь же, в worker-потоке; прочие
+// URL авторизованного пользователя уходят в Main через ProxyCall.
+void continue_request(const crow::request& req,
+                      crow::response& res,
+                      SessionStore& sessions,
+                      SessionRefresher& refresher,
+                      LoginPoller& login_poller,
+                      const std::string& session,
+                      std::optional<SessionData> session_data,
+                      bool renewed) {
+    const std::string path = path_only(req.url);
     const std::string session_key = "session:" + session;
 
-    auto data = redis.get(session_key);
-    if (!data) {
-        if (path == "/") return login_page();
-        return redirect_to("/");
-    }
+    // Сессию только что авторизовал LoginPoller: у cookie ещё Max-Age
+    // анонимной сессии, выставляем заново, как при продлении.
+    const bool authorized = session_data && session_data->status == "authorized";
+    if (authorized && login_poller.take_authorized(session_key)) renewed = true;
 
-    auto session_data = parse_session(*data);
-    if (!session_data) {
-        redis.del(session_key);
-        return redirect_to("/");
+    if (!authorized || is_page_path(path)) {
+        res = respond(req, sessions, refresher, login_poller, path, session, session_data, renewed);
+        res.end();
+        return;
     }
 
-    if (session_data->status == "authorized") {
-        return handle_authorized(req, redis, session_key, *session_data);
+    auto cookie = renewed_cookie(sessions, session, *session_data, renewed);
+    std::make_shared<ProxyCall>(req, res, sessions, refresher, session_key, std::move(*session_data), std::move(cookie))
+        ->Start();
+}
+
+} // namespace
+
+void handle_request_async(const crow::request& req,
+                          crow::response& res,
+                          SessionStore& sessions,
+                          SessionRefresher& refresher,
+                          LoginPoller& login_poller) {
+    std::string session = extract_session(req.get_header_value("Cookie"));
+    if (session.empty()) {
+        res = path_only(req.url) == "/" ? login_page(req) : redirect_to("/");
+        res.end();
+        return;
     }
 
-    return handle_anonymous(req, redis, session_key, *session_data);
+    // Сессию читаем, не занимая worker-поток ожиданием Redis (битую load
+    // удаляет сам и отдаёт nullopt). Продолжение — снова в io_context
+    // соединения: из кэша сразу, иначе из потока asio.
+    asio::io_context& io = *req.io_context;
+    auto request_trace = trace::current();
+    sessions.load_async("session:" + session, [&req, &res, &sessions, &refresher, &login_poller, &io, session,
+                                               request_trace](std::exception_ptr err,
+                                                              std::optional<SessionData> data,
+                                                              bool renewed) {
+        asio::dispatch(io, [&req, &res, &sessions, &refresher, &login_poller, session, request_trace, err,
+                            data = std::move(data), renewed]() mutable {
+            trace::Scope scope(request_trace);
+            try {
+                if (err) std::rethrow_exception(err);
+                continue_request(req, res, sessions, refresher, login_poller, session, std::move(data), renewed);
+            } catch (const std::exception& e) {
+                // Исключение из обработчика asio уронило бы поток Crow.
+                CROW_LOG_ERROR << "request " << req.url << ": " << e.what();
+                res = crow::response(500);
+                res.end();
+            }
+        });
+    });
 }
 
-void register_catchall(crow::SimpleApp& app, RedisClient& redis) {
+void register_catchall(App& app,
+                       SessionStore& sessions,
+                       SessionRefresher& refresher,
+                       LoginPoller& login_poller) {
     CROW_CATCHALL_ROUTE(app)
-    ([&redis](const crow::request& req) {
-        return handle_request(req, redis);
+    ([&app, &sessions, &refresher, &login_poller](const crow::request& req, crow::response& res) {
+        trace::Scope scope(app.get_context<Tracing>(req).trace);
+        handle_request_async(req, res, sessions, refresher, login_poller);
     });
 }
@@ -1,7 +1,20 @@
 #pragma once
 
 #include <crow.h>
-#include "../redis.hpp"
+#include "../app.hpp"
+#include "../login_poller.hpp"
+#include "../session_refresh.hpp"
+#include "../session_store.hpp"
 
-crow::response handle_request(const crow::request& req, RedisClient& redis);
-void register_catchall(crow::SimpleApp& app, RedisClient& redis);
+// Ответ на запрос с сессией: сессия читается без блокировки, страницы
+// собираются в worker-потоке, прокси в Main не блокирует поток. Ответ
+// завершается через res.end() позже, в io_context соединения (req.io_context).
+void handle_request_async(const crow::request& req,
+                          crow::response& res,
+                          SessionStore& sessions,
+                          SessionRefresher& refresher,
+                          LoginPoller& login_poller);
+void register_catchall(App& app,
+                       SessionStore& sessions,
+                       SessionRefresher& refresher,
+                       LoginPoller& login_poller);
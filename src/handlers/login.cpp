@@ -1,8 +1,8 @@
 #include "../handlers.hpp"
 #include "../session.hpp"
 #include "../utils.hpp"
-#include "../redis.hpp"
-#include "../api/auth_client.hpp"
+#include "../session_store.hpp"
+#include "../api/upstreams.hpp"
 
 #include <crow.h>
 #include <sw/redis++/redis++.h>
@@ -17,8 +17,9 @@ crow::response redirect_to(const std::string& location) {
 }
 } // namespace
 
-void register_login(crow::SimpleApp& app, RedisClient& redis) {
-    CROW_ROUTE(app, "/login")([&redis](const crow::request& req) {
+void register_login(App& app, SessionStore& sessions) {
+    CROW_ROUTE(app, "/login")([&app, &sessions](const crow::request& req) {
+        trace::Scope scope(app.get_context<Tracing>(req).trace);
         try {
             auto type = req.url_params.get("type");
             if (!type) {
@@ -29,44 +30,29 @@ void register_login(crow::SimpleApp& app, RedisClient& redis) {
             std::string login_token = gen_uuid();
 
             SessionData data;
-            bool needs_new_session = session.empty();
-
-            // --- DEBUG: Redis health + GET ---
-            if (!session.empty()) {
-                CROW_LOG_INFO << "LOGIN before redis.get key=session:" << session;
-                auto existing = redis.get("session:" + session);
-                CROW_LOG_INFO << "LOGIN after redis.get";
-
-                if (existing) {
-                    auto parsed = parse_session(*existing);
-                    if (parsed && parsed->status == "authorized") {
-                        return redirect_to("/");
-                    }
-                } else {
-                    needs_new_session = true;
-                }
-            }
-
-            if (needs_new_session) {
-                session = gen_uuid();
-            }
-
             data.status = "anonymous";
             data.login_token = login_token;
-            data.access_token.clear();
-            data.refresh_token.clear();
 
-            // --- DEBUG: SET ---
-            CROW_LOG_INFO << "LOGIN before redis.set key=session:" << session;
-            redis.set("session:" + session, serialize_session(data));
-            CROW_LOG_INFO << "LOGIN after redis.set";
+            // Вход всегда начинается под новым id (прежний cookie мог быть
+            // подсунут). Прежнюю сессию читаем и новую пишем одной пачкой —
+            // один round trip вместо GET и SET по очереди.
+            const std::string next = gen_uuid();
+            if (session.empty()) {
+                sessions.save("session:" + next, data);
+            } else {
+                auto existing = sessions.load_and_save("session:" + session, "session:" + next, data);
+                if (existing && existing->status == "authorized") {
+                    sessions.drop("session:" + next);
+                    return redirect_to("/");
+                }
+                // Незавершённый прежний вход больше не нужен.
+                if (existing) sessions.drop("session:" + session);
+            }
+            session = next;
 
             // --- Auth call ---
-            std::string auth_url = get_env(
-                "AUTH_URL",
-                "https://religiose-multinodular-jaqueline.ngrok-free.dev"
-            );
-            AuthClient auth(auth_url);
+            const auto upstream = upstreams();
+            const AuthClient& auth = upstream->auth;
 
             std::string type_value = type;
             bool is_code = (type_value == "code");
@@ -98,7 +84,7 @@ void register_login(crow::SimpleApp& app, RedisClient& redis) {
 
             // --- Response ---
             crow::response res;
-            res.add_header("Set-Cookie", "SESSION=" + session + "; Path=/; HttpOnly; SameSite=Lax");
+            res.add_header("Set-Cookie", session_cookie(session, sessions.ttl_for(data).count()));
 
             if (is_code) {
                 res.code = 200;
@@ -1,5 +1,4 @@
 #include "../handlers.hpp"
-#include "../session.hpp"
 #include "../utils.hpp"
 
 namespace {
@@ -10,25 +9,18 @@ crow::response redirect_to_root() {
 }
 } // namespace
 
-void register_logout(crow::SimpleApp& app, RedisClient& redis) {
+void register_logout(App& app, SessionStore& sessions) {
     CROW_ROUTE(app, "/logout")
-    ([&redis](const crow::request& req) {
+    ([&app, &sessions](const crow::request& req) {
+        trace::Scope scope(app.get_context<Tracing>(req).trace);
 
         std::string session = extract_session(req.get_header_value("Cookie"));
         if (session.empty()) {
             return redirect_to_root();
         }
 
-        std::string session_key = "session:" + session;
-        auto data = redis.get(session_key);
-        if (!data) {
-            return redirect_to_root();
-        }
-
-        auto parsed = parse_session(*data);
-        (void)parsed;
-
-        redis.del(session_key);
+        // DEL несуществующего ключа безвреден — отдельный GET не нужен.
+        sessions.remove("session:" + session);
         return redirect_to_root();
     });
 }
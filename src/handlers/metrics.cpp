@@ -0,0 +1,11 @@
+#include "../handlers.hpp"
+#include "../metrics.hpp"
+
+void register_metrics(App& app) {
+    CROW_ROUTE(app, "/metrics")
+    ([] {
+        crow::response res(metrics::render());
+        res.add_header("Content-Type", "text/plain; version=0.0.4; charset=utf-8");
+        return res;
+    });
+}
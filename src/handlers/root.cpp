@@ -1,7 +1,10 @@
 #include "../handlers.hpp"
 #include "common.hpp"
 
-void register_root(crow::SimpleApp& app, RedisClient& redis) {
+void register_root(App& app,
+                   SessionStore& sessions,
+                   SessionRefresher& refresher,
+                   LoginPoller& login_poller) {
     CROW_ROUTE(app, "/")
         .methods(
             crow::HTTPMethod::GET,
@@ -12,7 +15,8 @@ void register_root(crow::SimpleApp& app, RedisClient& redis) {
             crow::HTTPMethod::HEAD,
             crow::HTTPMethod::OPTIONS
         )
-        ([&redis](const crow::request& req) {
-            return handle_request(req, redis);
+        ([&app, &sessions, &refresher, &login_poller](const crow::request& req, crow::response& res) {
+            trace::Scope scope(app.get_context<Tracing>(req).trace);
+            handle_request_async(req, res, sessions, refresher, login_poller);
         });
 }
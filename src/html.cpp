@@ -0,0 +1,290 @@
+#include "html.hpp"
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define WEB_CLIENT_HTML_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+struct Entity {
+    const char* text;
+    size_t size; // 0 — символ не экранируется
+};
+
+const Entity* entities() {
+    static const auto table = [] {
+        std::array<Entity, 256> t {};
+        t[static_cast<unsigned char>('&')] = {"&amp;", 5};
+        t[static_cast<unsigned char>('<')] = {"&lt;", 4};
+        t[static_cast<unsigned char>('>')] = {"&gt;", 4};
+        t[static_cast<unsigned char>('"')] = {"&quot;", 6};
+        t[static_cast<unsigned char>('\'')] = {"&#39;", 5};
+        return t;
+    }();
+    return table.data();
+}
+
+bool is_special(char c) {
+    return c == '&' || c == '<' || c == '>' || c == '"' || c == '\'';
+}
+
+// После найденного спецсимвола столько байт проходим побайтно: где их
+// много подряд, векторный поиск заново на каждый дороже, чем помогает.
+constexpr size_t kDenseWindow = 16;
+
+// Поиск первого символа, который надо экранировать ([p, end) — если нет).
+// Тела ответов Main почти целиком «чистые», так что время уходит сюда:
+// на x86 смотрим по 16/32 байта за раз, реализацию выбираем при старте.
+using FindSpecial = const char* (*)(const char* p, const char* end);
+
+const char* find_special_scalar(const char* p, const char* end) {
+    while (p != end && !is_special(*p)) ++p;
+    return p;
+}
+
+#ifdef WEB_CLIENT_HTML_X86
+
+__attribute__((target("sse2")))
+const char* find_special_sse2(const char* p, const char* end) {
+    const __m128i amp = _mm_set1_epi8('&');
+    const __m128i lt = _mm_set1_epi8('<');
+    const __m128i gt = _mm_set1_epi8('>');
+    const __m128i quot = _mm_set1_epi8('"');
+    const __m128i apos = _mm_set1_epi8('\'');
+
+    while (end - p >= 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i hit = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, amp), _mm_cmpeq_epi8(v, lt)),
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, gt), _mm_cmpeq_epi8(v, quot)), _mm_cmpeq_epi8(v, apos)));
+        const int mask = _mm_movemask_epi8(hit);
+        if (mask != 0) return p + __builtin_ctz(static_cast<unsigned>(mask));
+        p += 16;
+    }
+    return find_special_scalar(p, end);
+}
+
+__attribute__((target("avx2")))
+const char* find_special_avx2(const char* p, const char* end) {
+    const __m256i amp = _mm256_set1_epi8('&');
+    const __m256i lt = _mm256_set1_epi8('<');
+    const __m256i gt = _mm256_set1_epi8('>');
+    const __m256i quot = _mm256_set1_epi8('"');
+    const __m256i apos = _mm256_set1_epi8('\'');
+
+    while (end - p >= 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i hit = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, amp), _mm256_cmpeq_epi8(v, lt)),
+            _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, gt), _mm256_cmpeq_epi8(v, quot)),
+                            _mm256_cmpeq_epi8(v, apos)));
+        const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+        if (mask != 0) return p + __builtin_ctz(mask);
+        p += 32;
+    }
+    return find_special_sse2(p, end);
+}
+
+#endif
+
+struct Impl {
+    FindSpecial find;
+    const char* name;
+};
+
+Impl pick_impl() {
+#ifdef WEB_CLIENT_HTML_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return {find_special_avx2, "avx2"};
+    if (__builtin_cpu_supports("sse2")) return {find_special_sse2, "sse2"};
+#endif
+    return {find_special_scalar, "scalar"};
+}
+
+const Impl& impl() {
+    static const Impl chosen = pick_impl();
+    return chosen;
+}
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && s.front() == ' ') s.remove_prefix(1);
+    while (!s.empty() && s.back() == ' ') s.remove_suffix(1);
+    return s;
+}
+
+} // namespace
+
+size_t html_escaped_size(std::string_view s) {
+    const FindSpecial find = impl().find;
+    const Entity* table = entities();
+    const char* p = s.data();
+    const char* end = s.data() + s.size();
+    size_t size = s.size();
+    while (p != end) {
+        p = find(p, end);
+        const char* dense_end = static_cast<size_t>(end - p) > kDenseWindow ? p + kDenseWindow : end;
+        for (; p != dense_end; ++p) {
+            const size_t entity = table[static_cast<unsigned char>(*p)].size;
+            if (entity) size += entity - 1;
+        }
+    }
+    return size;
+}
+
+char* html_escape_to(char* out, std::string_view s) {
+    const FindSpecial find = impl().find;
+    const Entity* table = entities();
+    const char* p = s.data();
+    const char* end = s.data() + s.size();
+    while (p != end) {
+        // Чистый кусок — одним memcpy.
+        const char* special = find(p, end);
+        std::memcpy(out, p, static_cast<size_t>(special - p));
+        out += special - p;
+        p = special;
+
+        const char* dense_end = static_cast<size_t>(end - p) > kDenseWindow ? p + kDenseWindow : end;
+        for (; p != dense_end; ++p) {
+            const Entity& entity = table[static_cast<unsigned char>(*p)];
+            if (entity.size) {
+                std::memcpy(out, entity.text, entity.size);
+                out += entity.size;
+            } else {
+                *out++ = *p;
+            }
+        }
+    }
+    return out;
+}
+
+void html_escape_append(std::string& out, std::string_view s) {
+    const size_t start = out.size();
+    out.resize(start + html_escaped_size(s));
+    html_escape_to(&out[start], s);
+}
+
+std::string html_escape(std::string_view s) {
+    std::string out;
+    html_escape_append(out, s);
+    return out;
+}
+
+const char* html_escape_isa() {
+    return impl().name;
+}
+
+// --- HtmlTemplate ---
+
+HtmlTemplate::HtmlTemplate(std::string_view source) {
+    size_t pos = 0;
+    while (pos < source.size()) {
+        const size_t open = source.find("{{", pos);
+        if (open == std::string_view::npos) break;
+
+        if (open > pos) {
+            segments_.push_back({Kind::Text, std::string(source.substr(pos, open - pos))});
+        }
+
+        const bool raw = source.compare(open, 3, "{{{") == 0;
+        const std::string_view close_tag = raw ? "}}}" : "}}";
+        const size_t name_begin = open + (raw ? 3 : 2);
+        const size_t close = source.find(close_tag, name_begin);
+        if (close == std::string_view::npos) {
+            throw std::invalid_argument("html template: unclosed slot at " + std::to_string(open));
+        }
+
+        const auto name = trim(source.substr(name_begin, close - name_begin));
+        if (name.empty() || name.find_first_of("{}") != std::string_view::npos) {
+            throw std::invalid_argument("html template: bad slot name at " + std::to_string(open));
+        }
+        segments_.push_back({raw ? Kind::Raw : Kind::Escaped, "", slot_index(name)});
+        pos = close + close_tag.size();
+    }
+    if (pos < source.size()) {
+        segments_.push_back({Kind::Text, std::string(source.substr(pos))});
+    }
+
+    for (const auto& segment : segments_) {
+        static_size_ += segment.text.size();
+    }
+}
+
+size_t HtmlTemplate::slot_index(std::string_view name) {
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        if (slots_[i] == name) return i;
+    }
+    if (slots_.size() == kMaxSlots) {
+        throw std::invalid_argument("html template: too many slots");
+    }
+    slots_.emplace_back(name);
+    return slots_.size() - 1;
+}
+
+HtmlTemplate::Resolved HtmlTemplate::resolve(Values values) const {
+    Resolved resolved {};
+    for (const auto& [name, value] : values) {
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            if (slots_[i] == name) {
+                resolved[i] = value;
+                break;
+            }
+        }
+    }
+    return resolved;
+}
+
+size_t HtmlTemplate::rendered_size(const Resolved& values) const {
+    size_t size = static_size_;
+    for (const auto& segment : segments_) {
+        if (segment.kind == Kind::Escaped) size += html_escaped_size(values[segment.slot]);
+        if (segment.kind == Kind::Raw) size += values[segment.slot].size();
+    }
+    return size;
+}
+
+char* HtmlTemplate::write(char* p, const Resolved& values) const {
+    for (const auto& segment : segments_) {
+        switch (segment.kind) {
+            case Kind::Text:
+                std::memcpy(p, segment.text.data(), segment.text.size());
+                p += segment.text.size();
+                break;
+            case Kind::Escaped:
+                p = html_escape_to(p, values[segment.slot]);
+                break;
+            case Kind::Raw:
+                if (!values[segment.slot].empty()) {
+                    std::memcpy(p, values[segment.slot].data(), values[segment.slot].size());
+                    p += values[segment.slot].size();
+                }
+                break;
+        }
+    }
+    return p;
+}
+
+size_t HtmlTemplate::size(Values values) const {
+    return rendered_size(resolve(values));
+}
+
+char* HtmlTemplate::render_to(char* out, Values values) const {
+    return write(out, resolve(values));
+}
+
+void HtmlTemplate::render_to(std::string& out, Values values) const {
+    const auto resolved = resolve(values);
+    const size_t start = out.size();
+    out.resize(start + rendered_size(resolved));
+    write(&out[start], resolved);
+}
+
+std::string HtmlTemplate::render(Values values) const {
+    std::string out;
+    render_to(out, values);
+    return out;
+}
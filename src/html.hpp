@@ -0,0 +1,66 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Экранирование для текста и значений атрибутов: & < > " '.
+// Чистые участки ищутся по 16/32 байта (SSE2/AVX2, выбор при первом
+// вызове по CPU) и копируются целиком.
+std::string html_escape(std::string_view s);
+// Длина после экранирования — чтобы выделить буфер заранее.
+size_t html_escaped_size(std::string_view s);
+// Пишет в out ровно html_escaped_size(s) байт, возвращает конец записанного.
+char* html_escape_to(char* out, std::string_view s);
+void html_escape_append(std::string& out, std::string_view s);
+// Выбранная реализация: "avx2", "sse2" или "scalar".
+const char* html_escape_isa();
+
+// Шаблон HTML, разобранный один раз (при старте): статические куски и слоты.
+//   {{name}}   — значение экранируется;
+//   {{{name}}} — вставляется как есть (уже готовый HTML).
+// Рендер сначала считает точный размер результата, затем за один проход
+// пишет в буфер, выделенный один раз. Значения, которых нет среди слотов,
+// игнорируются; слоты без значения остаются пустыми.
+// Ошибка в разметке шаблона — std::invalid_argument из конструктора.
+class HtmlTemplate {
+public:
+    using Values = std::initializer_list<std::pair<std::string_view, std::string_view>>;
+
+    static constexpr size_t kMaxSlots = 16;
+
+    explicit HtmlTemplate(std::string_view source);
+
+    std::string render(Values values) const;
+    // Дописывает в конец out, место резервирует сам.
+    void render_to(std::string& out, Values values) const;
+
+    // Для страниц из нескольких шаблонов: сначала сумма size() всех частей,
+    // затем render_to(char*) каждой в один буфер. Пишет ровно size(values)
+    // байт, возвращает конец записанного.
+    size_t size(Values values) const;
+    char* render_to(char* out, Values values) const;
+
+private:
+    enum class Kind { Text, Escaped, Raw };
+
+    struct Segment {
+        Kind kind;
+        std::string text; // Text
+        size_t slot = 0;  // Escaped, Raw
+    };
+
+    using Resolved = std::array<std::string_view, kMaxSlots>;
+
+    size_t slot_index(std::string_view name);
+    Resolved resolve(Values values) const;
+    size_t rendered_size(const Resolved& values) const;
+    char* write(char* out, const Resolved& values) const;
+
+    std::vector<Segment> segments_;
+    std::vector<std::string> slots_;
+    size_t static_size_ = 0;
+};
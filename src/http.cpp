@@ -1,18 +1,29 @@
 #include "http.hpp"
+#include "trace.hpp"
 
 #include <curl/curl.h>
 #include <algorithm>
 #include <cctype>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 namespace {
+// Больше заранее не резервируем, даже если Content-Length обещает больше:
+// дальше строка растёт как обычно.
+constexpr size_t kMaxBodyReserve = 16 * 1024 * 1024;
+
 size_t write_body(char* ptr, size_t size, size_t nmemb, void* userdata) {
-    auto* body = static_cast<std::string*>(userdata);
-    body->append(ptr, size * nmemb);
+    auto* response = static_cast<HttpResponse*>(userdata);
+    response->body.append(ptr, size * nmemb);
     return size * nmemb;
 }
 
 size_t write_header(char* buffer, size_t size, size_t nitems, void* userdata) {
-    auto* headers = static_cast<std::map<std::string, std::string>*>(userdata);
+    auto* response = static_cast<HttpResponse*>(userdata);
     std::string line(buffer, size * nitems);
 
     auto pos = line.find(':');
@@ -30,59 +41,408 @@ size_t write_header(char* buffer, size_t size, size_t nitems, void* userdata) {
         return static_cast<char>(std::tolower(c));
     });
 
-    (*headers)[key] = value;
+    // Тело сразу в один буфер нужного размера, без перевыделений по ходу.
+    if (key == "content-length") {
+        char* end = nullptr;
+        unsigned long long length = std::strtoull(value.c_str(), &end, 10);
+        if (end != value.c_str()) {
+            response->body.reserve(static_cast<size_t>(std::min<unsigned long long>(length, kMaxBodyReserve)));
+        }
+    }
+
+    response->headers[key] = value;
     return size * nitems;
 }
 
-curl_slist* build_headers(const std::vector<std::string>& headers) {
+curl_slist* build_headers(const std::vector<std::string>& headers, const std::string& traceparent) {
     curl_slist* list = nullptr;
     for (const auto& header : headers) {
         list = curl_slist_append(list, header.c_str());
     }
+    if (!traceparent.empty()) {
+        list = curl_slist_append(list, ("traceparent: " + traceparent).c_str());
+    }
     return list;
 }
-} // namespace
 
-HttpResponse http_request(const std::string& method,
-                          const std::string& url,
-                          const std::string& body,
-                          const std::vector<std::string>& headers) {
-    HttpResponse response;
+// Участок trace на запрос; без текущего trace — пустой и без лишних строк.
+trace::Span http_span(const char* name, const std::string& method, const std::string& url) {
+    if (!trace::current()) return trace::Span();
+    std::string desc = method;
+    desc += ' ';
+    desc += trace::url_path(url);
+    return trace::Span(name, desc);
+}
+
+// Общие для всех потоков кэши DNS и TLS-сессий: новое соединение из любого
+// worker-потока обходится без резолва и с укороченным TLS handshake.
+// Кэш соединений не общий — libcurl не поддерживает его разделение между
+// одновременно работающими потоками; он живёт в easy-хендле потока.
+class CurlShare {
+public:
+    CurlShare() {
+        curl_global_init(CURL_GLOBAL_DEFAULT);
+        share_ = curl_share_init();
+        curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, lock);
+        curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, unlock);
+        curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+        curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    }
+
+    CURLSH* get() const { return share_; }
+
+private:
+    static void lock(CURL*, curl_lock_data data, curl_lock_access, void* userptr) {
+        static_cast<CurlShare*>(userptr)->mutex_for(data).lock();
+    }
 
+    static void unlock(CURL*, curl_lock_data data, void* userptr) {
+        static_cast<CurlShare*>(userptr)->mutex_for(data).unlock();
+    }
+
+    std::mutex& mutex_for(curl_lock_data data) {
+        auto index = static_cast<size_t>(data);
+        return mutexes_[index < CURL_LOCK_DATA_LAST ? index : 0];
+    }
+
+    CURLSH* share_ = nullptr;
+    std::mutex mutexes_[CURL_LOCK_DATA_LAST];
+};
+
+// Не разрушается намеренно: easy-хендлы других потоков могут пережить main().
+CurlShare& curl_share() {
+    static auto* share = new CurlShare();
+    return *share;
+}
+
+// Один easy-хендл на поток. curl_easy_reset() между запросами сбрасывает
+// опции, но сохраняет соединения и кэши хендла.
+struct EasyHandle {
     CURL* curl = curl_easy_init();
-    if (!curl) {
-        response.status = 0;
-        return response;
+
+    EasyHandle() = default;
+    EasyHandle(const EasyHandle&) = delete;
+    EasyHandle& operator=(const EasyHandle&) = delete;
+
+    ~EasyHandle() {
+        if (curl) curl_easy_cleanup(curl);
+    }
+};
+
+struct MultiHandle {
+    CURLM* multi = curl_multi_init();
+
+    ~MultiHandle() {
+        if (multi) curl_multi_cleanup(multi);
     }
+};
 
+// Сбрасывает опции прошлого запроса и выставляет общие.
+void reset_easy(CURL* curl) {
+    curl_easy_reset(curl);
+    curl_easy_setopt(curl, CURLOPT_SHARE, curl_share().get());
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, 30L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, 15L);
+    curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, 60L);
+#if LIBCURL_VERSION_NUM >= 0x074100 // 7.65.0
+    // Прокси перед upstream (ngrok) рвут простаивающие соединения —
+    // не берём из кэша те, что простояли слишком долго.
+    curl_easy_setopt(curl, CURLOPT_MAXAGE_CONN, 55L);
+#endif
+}
+
+CURL* thread_easy_handle() {
+    curl_share();
+    thread_local EasyHandle handle;
+    if (!handle.curl) return nullptr;
+
+    reset_easy(handle.curl);
+    return handle.curl;
+}
+
+// Опции конкретного запроса. libcurl хранит указатели на строки, поэтому
+// method/body и response должны жить до конца передачи; возвращённый список
+// заголовков освобождает вызывающий.
+curl_slist* prepare_transfer(CURL* curl,
+                             const std::string& method,
+                             const std::string& url,
+                             const std::string& body,
+                             const std::vector<std::string>& headers,
+                             size_t max_body,
+                             const HttpTimeouts& timeouts,
+                             const std::string& traceparent,
+                             HttpResponse& response) {
     curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
     curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method.c_str());
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_body);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response.body);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
     curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, write_header);
-    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &response.headers);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &response);
     curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 0L);
+    if (max_body > 0) {
+        curl_easy_setopt(curl, CURLOPT_MAXFILESIZE_LARGE, static_cast<curl_off_t>(max_body));
+    }
+    if (timeouts.connect.count() > 0) {
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, static_cast<long>(timeouts.connect.count()));
+    }
+    if (timeouts.total.count() > 0) {
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, static_cast<long>(timeouts.total.count()));
+    }
 
-    curl_slist* header_list = build_headers(headers);
+    curl_slist* header_list = build_headers(headers, traceparent);
     if (header_list) {
         curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header_list);
     }
 
     if (!body.empty()) {
         curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body.c_str());
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, body.size());
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(body.size()));
     }
+    return header_list;
+}
 
-    curl_easy_perform(curl);
+// Оборванная передача (обрыв, таймаут, превышен max_body) — это не ответ
+// upstream, даже если статус уже пришёл: недокачанное тело не отдаём.
+void finish_status(CURL* curl, CURLcode result, HttpResponse& response) {
+    if (result != CURLE_OK) {
+        response.status = 0;
+        return;
+    }
     curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response.status);
+}
+} // namespace
+
+namespace {
+// Цикл событий для асинхронных запросов: один поток крутит curl_multi,
+// запросы из других потоков приходят через очередь и curl_multi_wakeup.
+class HttpLoop {
+public:
+    HttpLoop() : multi_(curl_multi_init()) {
+        curl_share();
+        if (multi_) {
+            curl_multi_setopt(multi_, CURLMOPT_MAXCONNECTS, 64L);
+            thread_ = std::thread([this] { run(); });
+        }
+    }
+
+    ~HttpLoop() {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            stopping_ = true;
+        }
+        wakeup();
+        if (thread_.joinable()) thread_.join();
+        if (multi_) curl_multi_cleanup(multi_);
+    }
+
+    HttpLoop(const HttpLoop&) = delete;
+    HttpLoop& operator=(const HttpLoop&) = delete;
+
+    void submit(HttpRequest request, HttpCallback on_done) {
+        auto transfer = std::make_unique<Transfer>();
+        transfer->span = http_span(request.span, request.method, request.url);
+        transfer->trace = trace::current();
+        transfer->request = std::move(request);
+        transfer->on_done = std::move(on_done);
+
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            if (!stopping_ && multi_) {
+                queue_.push_back(std::move(transfer));
+                transfer = nullptr;
+            }
+        }
+        if (transfer) {
+            transfer->span.end();
+            transfer->on_done(HttpResponse{});
+            return;
+        }
+        wakeup();
+    }
+
+private:
+    struct Transfer {
+        HttpRequest request;
+        HttpResponse response;
+        HttpCallback on_done;
+        trace::Span span;
+        std::shared_ptr<trace::Trace> trace;
+        curl_slist* header_list = nullptr;
+        std::unique_ptr<EasyHandle> easy;
+    };
+
+    static constexpr size_t kMaxIdleHandles = 64;
+
+    void wakeup() {
+#if LIBCURL_VERSION_NUM >= 0x074400 // 7.68.0
+        if (multi_) curl_multi_wakeup(multi_);
+#endif
+    }
+
+    void run() {
+        for (;;) {
+            std::deque<std::unique_ptr<Transfer>> incoming;
+            {
+                std::lock_guard<std::mutex> lock(mu_);
+                if (stopping_) break;
+                incoming.swap(queue_);
+            }
+            for (auto& transfer : incoming) {
+                start(std::move(transfer));
+            }
+
+            int running = 0;
+            curl_multi_perform(multi_, &running);
+            finish_done();
+
+#if LIBCURL_VERSION_NUM >= 0x074400 // 7.68.0
+            curl_multi_poll(multi_, nullptr, 0, 1000, nullptr);
+#else
+            // Без curl_multi_wakeup новые запросы подхватываются по таймауту.
+            curl_multi_wait(multi_, nullptr, 0, 20, nullptr);
+#endif
+        }
+
+        // Остановка процесса: незавершённые запросы просто бросаем, их
+        // колбэки могут ссылаться на уже разрушенные объекты.
+        for (auto& [curl, transfer] : active_) {
+            curl_multi_remove_handle(multi_, curl);
+            if (transfer->header_list) curl_slist_free_all(transfer->header_list);
+        }
+        active_.clear();
+        idle_.clear();
+    }
+
+    void start(std::unique_ptr<Transfer> transfer) {
+        std::unique_ptr<EasyHandle> easy;
+        if (!idle_.empty()) {
+            easy = std::move(idle_.back());
+            idle_.pop_back();
+        } else {
+            easy = std::make_unique<EasyHandle>();
+        }
+        if (!easy->curl) {
+            complete(std::move(transfer));
+            return;
+        }
+
+        CURL* curl = easy->curl;
+        const auto& req = transfer->request;
+        reset_easy(curl);
+        transfer->header_list = prepare_transfer(curl, req.method, req.url, req.body, req.headers, req.max_body,
+                                                 req.timeouts, transfer->span.traceparent(), transfer->response);
+        transfer->easy = std::move(easy);
+
+        if (curl_multi_add_handle(multi_, curl) != CURLM_OK) {
+            complete(std::move(transfer));
+            return;
+        }
+        active_.emplace(curl, std::move(transfer));
+    }
+
+    void finish_done() {
+        int left = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi_, &left)) {
+            if (msg->msg != CURLMSG_DONE) continue;
+
+            CURL* curl = msg->easy_handle;
+            auto it = active_.find(curl);
+            if (it == active_.end()) continue;
+
+            auto transfer = std::move(it->second);
+            active_.erase(it);
+
+            finish_status(curl, msg->data.result, transfer->response);
+            curl_multi_remove_handle(multi_, curl);
+            complete(std::move(transfer));
+        }
+    }
+
+    void complete(std::unique_ptr<Transfer> transfer) {
+        if (transfer->header_list) {
+            curl_slist_free_all(transfer->header_list);
+            transfer->header_list = nullptr;
+        }
+        if (transfer->easy && idle_.size() < kMaxIdleHandles) {
+            idle_.push_back(std::move(transfer->easy));
+        }
+
+        transfer->span.end();
+        // Исключение из колбэка не должно останавливать цикл, но и теряться
+        // молча тоже: значит, вызывающий не получил свой результат.
+        try {
+            trace::Scope scope(std::move(transfer->trace));
+            transfer->on_done(std::move(transfer->response));
+        } catch (const std::exception& e) {
+            CROW_LOG_ERROR << "http: callback for " << transfer->request.method << " " << transfer->request.url
+                           << " threw: " << e.what();
+        } catch (...) {
+            CROW_LOG_ERROR << "http: callback for " << transfer->request.method << " " << transfer->request.url
+                           << " threw a non-std exception";
+        }
+    }
+
+    CURLM* multi_ = nullptr;
+    std::thread thread_;
+
+    std::mutex mu_;
+    std::deque<std::unique_ptr<Transfer>> queue_;
+    bool stopping_ = false;
+
+    // Дальше — только поток цикла.
+    std::unordered_map<CURL*, std::unique_ptr<Transfer>> active_;
+    std::vector<std::unique_ptr<EasyHandle>> idle_;
+};
+
+HttpLoop& http_loop() {
+    static HttpLoop loop;
+    return loop;
+}
+} // namespace
+
+namespace {
+HttpResponse perform(const std::string& method,
+                     const std::string& url,
+                     const std::string& body,
+                     const std::vector<std::string>& headers,
+                     size_t max_body,
+                     const HttpTimeouts& timeouts,
+                     const char* span_name) {
+    HttpResponse response;
+
+    CURL* curl = thread_easy_handle();
+    if (!curl) {
+        response.status = 0;
+        return response;
+    }
+
+    auto span = http_span(span_name, method, url);
+    curl_slist* header_list = prepare_transfer(curl, method, url, body, headers, max_body, timeouts,
+                                               span.traceparent(), response);
+    finish_status(curl, curl_easy_perform(curl), response);
 
     if (header_list) {
         curl_slist_free_all(header_list);
     }
-    curl_easy_cleanup(curl);
 
     return response;
 }
+} // namespace
+
+HttpResponse http_request(const std::string& method,
+                          const std::string& url,
+                          const std::string& body,
+                          const std::vector<std::string>& headers) {
+    return perform(method, url, body, headers, 0, HttpTimeouts{}, "http");
+}
+
+HttpResponse http_request(const HttpRequest& request) {
+    return perform(request.method, request.url, request.body, request.headers, request.max_body, request.timeouts,
+                   request.span);
+}
 
 HttpResponse http_get(const std::string& url, const std::vector<std::string>& headers) {
     return http_request("GET", url, "", headers);
@@ -95,3 +455,107 @@ HttpResponse http_post_json(const std::string& url,
     merged_headers.push_back("Content-Type: application/json");
     return http_request("POST", url, body, merged_headers);
 }
+
+std::vector<HttpResponse> http_request_all(const std::vector<HttpRequest>& requests) {
+    std::vector<HttpResponse> responses(requests.size());
+    if (requests.empty()) return responses;
+
+    // Multi-хендл на поток держит свой кэш соединений между вызовами,
+    // easy-хендлы тоже переиспользуются (растут до максимального размера пачки).
+    curl_share();
+    thread_local MultiHandle multi;
+    thread_local std::vector<std::unique_ptr<EasyHandle>> easy;
+    if (!multi.multi) return responses;
+
+    while (easy.size() < requests.size()) {
+        easy.push_back(std::make_unique<EasyHandle>());
+    }
+
+    std::vector<curl_slist*> header_lists(requests.size(), nullptr);
+    std::vector<trace::Span> spans(requests.size());
+    std::vector<CURL*> added;
+    added.reserve(requests.size());
+    std::unordered_map<CURL*, size_t> index_of;
+
+    for (size_t i = 0; i < requests.size(); ++i) {
+        CURL* curl = easy[i]->curl;
+        if (!curl) continue; // status останется 0, как у одиночного запроса
+
+        const auto& req = requests[i];
+        reset_easy(curl);
+        spans[i] = http_span(req.span, req.method, req.url);
+        header_lists[i] = prepare_transfer(curl, req.method, req.url, req.body, req.headers, req.max_body,
+                                           req.timeouts, spans[i].traceparent(), responses[i]);
+        if (curl_multi_add_handle(multi.multi, curl) == CURLM_OK) {
+            added.push_back(curl);
+            index_of[curl] = i;
+        }
+    }
+
+    // Завершённые читаем по ходу: у каждого участка trace своё время.
+    std::unordered_map<CURL*, CURLcode> results;
+    auto collect_done = [&] {
+        int left = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi.multi, &left)) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            results[msg->easy_handle] = msg->data.result;
+            spans[index_of[msg->easy_handle]].end();
+        }
+    };
+
+    int running = 0;
+    do {
+        if (curl_multi_perform(multi.multi, &running) != CURLM_OK) break;
+        collect_done();
+        if (running == 0) break;
+#if LIBCURL_VERSION_NUM >= 0x074200 // 7.66.0
+        if (curl_multi_poll(multi.multi, nullptr, 0, 1000, nullptr) != CURLM_OK) break;
+#else
+        if (curl_multi_wait(multi.multi, nullptr, 0, 1000, nullptr) != CURLM_OK) break;
+#endif
+    } while (true);
+    collect_done();
+
+    for (size_t i = 0; i < requests.size(); ++i) {
+        CURL* curl = easy[i]->curl;
+        if (!curl) continue;
+        if (std::find(added.begin(), added.end(), curl) != added.end()) {
+            auto done = results.find(curl);
+            finish_status(curl, done != results.end() ? done->second : CURLE_RECV_ERROR, responses[i]);
+            curl_multi_remove_handle(multi.multi, curl);
+        }
+        if (header_lists[i]) {
+            curl_slist_free_all(header_lists[i]);
+        }
+    }
+
+    return responses;
+}
+
+void http_request_async(HttpRequest request, HttpCallback on_done) {
+    http_loop().submit(std::move(request), std::move(on_done));
+}
+
+std::future<HttpResponse> http_request_async(HttpRequest request) {
+    auto promise = std::make_shared<std::promise<HttpResponse>>();
+    auto future = promise->get_future();
+    http_request_async(std::move(request), [promise](HttpResponse response) {
+        promise->set_value(std::move(response));
+    });
+    return future;
+}
+
+// --- UpstreamCall ---
+
+UpstreamCall::UpstreamCall(const char* service, const char* call) {
+    const metrics::Labels labels = {{"service", service}, {"call", call}};
+    latency = metrics::histogram("web_client_upstream_duration_seconds",
+                                 "Auth/Main client call time, by service and call", labels);
+    errors = metrics::counter("web_client_upstream_errors_total",
+                              "Auth/Main client calls without a usable response, by service and call", labels);
+}
+
+void UpstreamCall::done(std::chrono::steady_clock::time_point started, bool ok) const {
+    latency.observe_since(started);
+    if (!ok) errors.inc();
+}
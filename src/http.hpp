@@ -1,19 +1,46 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <future>
 #include <map>
 #include <string>
 #include <vector>
 
+#include "metrics.hpp"
+
+// status == 0 — ответа нет (ошибка соединения или оборванная передача).
 struct HttpResponse {
     long status = 0;
     std::string body;
     std::map<std::string, std::string> headers;
 };
 
+// Пределы времени передачи; 0 — без предела (как у libcurl по умолчанию
+// для total; connect у libcurl тогда 300 с).
+struct HttpTimeouts {
+    std::chrono::milliseconds connect {0};
+    std::chrono::milliseconds total {0};
+};
+
+struct HttpRequest {
+    std::string method;
+    std::string url;
+    std::string body;
+    std::vector<std::string> headers;
+    size_t max_body = 0; // 0 — без ограничения; больше — запрос не удался
+    const char* span = "http"; // имя участка trace (auth, main...)
+    HttpTimeouts timeouts;
+};
+
+// Все варианты добавляют участок в текущий trace (trace.hpp) и передают
+// его upstream заголовком traceparent.
 HttpResponse http_request(const std::string& method,
                           const std::string& url,
                           const std::string& body,
                           const std::vector<std::string>& headers);
+HttpResponse http_request(const HttpRequest& request);
 
 HttpResponse http_get(const std::string& url,
                       const std::vector<std::string>& headers = {});
@@ -21,3 +48,28 @@ HttpResponse http_get(const std::string& url,
 HttpResponse http_post_json(const std::string& url,
                             const std::string& body,
                             const std::vector<std::string>& headers = {});
+
+// Выполняет запросы одновременно (curl_multi) и ждёт все: время — как у
+// самого медленного. Ответы в порядке запросов; status == 0 — запрос не удался.
+std::vector<HttpResponse> http_request_all(const std::vector<HttpRequest>& requests);
+
+// Неблокирующий запрос: выполняется в общем потоке цикла curl_multi, так что
+// ожидание upstream не занимает worker-поток. Колбэк вызывается в потоке
+// цикла — он должен быть коротким и не ждать других запросов. На время
+// колбэка текущим ставится trace, бывший текущим при вызове.
+using HttpCallback = std::function<void(HttpResponse)>;
+
+void http_request_async(HttpRequest request, HttpCallback on_done);
+std::future<HttpResponse> http_request_async(HttpRequest request);
+
+// Метрики вызовов Auth и Main: время и неудачи по сервису и методу клиента.
+// Держать в static в месте вызова — регистрация один раз.
+struct UpstreamCall {
+    UpstreamCall(const char* service, const char* call);
+
+    // Время с started; ok == false — ответа нет или он не тот, что ждали.
+    void done(std::chrono::steady_clock::time_point started, bool ok) const;
+
+    metrics::Histogram latency;
+    metrics::Counter errors;
+};
@@ -0,0 +1,361 @@
+#include "json_scan.hpp"
+
+#include <charconv>
+
+namespace {
+
+// Глубже — отдаём полному разбору.
+constexpr int kMaxDepth = 512;
+
+bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+void append_utf8(std::string& out, unsigned cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+// Проверяющий проход по тексту JSON (RFC 8259, строки — валидный UTF-8,
+// как требует и nlohmann). Значения не копируются: наружу отдаются куски
+// исходного текста, строки декодируются только по запросу.
+class Scanner {
+public:
+    explicit Scanner(std::string_view text) : p_(text.data()), end_(text.data() + text.size()) {}
+
+    char peek() {
+        skip_ws();
+        return p_ == end_ ? '\0' : *p_;
+    }
+
+    bool at_end() {
+        skip_ws();
+        return p_ == end_;
+    }
+
+    // Значение целиком; span — его текст.
+    bool value(std::string_view* span, int depth = 0) {
+        if (depth > kMaxDepth) return false;
+        skip_ws();
+        if (p_ == end_) return false;
+
+        const char* begin = p_;
+        bool ok = false;
+        switch (*p_) {
+            case '{': ok = object(depth, [](const std::string&, std::string_view) {}); break;
+            case '[': ok = array(depth, [](std::string_view) {}); break;
+            case '"': ok = string(nullptr); break;
+            case 't': ok = literal("true"); break;
+            case 'f': ok = literal("false"); break;
+            case 'n': ok = literal("null"); break;
+            default: ok = number(); break;
+        }
+        if (ok && span) *span = std::string_view(begin, static_cast<size_t>(p_ - begin));
+        return ok;
+    }
+
+    // На '{': on_member(ключ, текст значения) для каждого члена.
+    template <class OnMember>
+    bool object(int depth, OnMember&& on_member) {
+        ++p_;
+        if (consume('}')) return true;
+
+        std::string key;
+        do {
+            if (peek() != '"') return false;
+            key.clear();
+            if (!string(&key)) return false;
+            if (!consume(':')) return false;
+
+            std::string_view span;
+            if (!value(&span, depth + 1)) return false;
+            on_member(key, span);
+        } while (consume(','));
+        return consume('}');
+    }
+
+    // На '[': on_element(текст элемента) для каждого элемента.
+    template <class OnElement>
+    bool array(int depth, OnElement&& on_element) {
+        ++p_;
+        if (consume(']')) return true;
+
+        do {
+            std::string_view span;
+            if (!value(&span, depth + 1)) return false;
+            on_element(span);
+        } while (consume(','));
+        return consume(']');
+    }
+
+    // На '"'; out == nullptr — только проверить.
+    bool string(std::string* out) {
+        ++p_;
+        while (true) {
+            // Обычные ASCII-символы копируем одним куском.
+            const char* run = p_;
+            while (p_ != end_) {
+                const auto c = static_cast<unsigned char>(*p_);
+                if (c < 0x20 || c >= 0x80 || c == '"' || c == '\\') break;
+                ++p_;
+            }
+            if (out) out->append(run, static_cast<size_t>(p_ - run));
+            if (p_ == end_) return false;
+
+            const auto c = static_cast<unsigned char>(*p_);
+            if (c == '"') {
+                ++p_;
+                return true;
+            }
+            if (c == '\\') {
+                if (!escape(out)) return false;
+                continue;
+            }
+            if (c < 0x20) return false;
+
+            const char* start = p_;
+            if (!utf8()) return false;
+            if (out) out->append(start, static_cast<size_t>(p_ - start));
+        }
+    }
+
+private:
+    void skip_ws() {
+        while (p_ != end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) ++p_;
+    }
+
+    bool consume(char c) {
+        skip_ws();
+        if (p_ == end_ || *p_ != c) return false;
+        ++p_;
+        return true;
+    }
+
+    bool literal(std::string_view word) {
+        if (static_cast<size_t>(end_ - p_) < word.size()) return false;
+        if (std::string_view(p_, word.size()) != word) return false;
+        p_ += word.size();
+        return true;
+    }
+
+    bool digits() {
+        if (p_ == end_ || !is_digit(*p_)) return false;
+        while (p_ != end_ && is_digit(*p_)) ++p_;
+        return true;
+    }
+
+    bool number() {
+        if (p_ != end_ && *p_ == '-') ++p_;
+        if (p_ == end_) return false;
+        if (*p_ == '0') {
+            ++p_;
+        } else if (!digits()) {
+            return false;
+        }
+        if (p_ != end_ && *p_ == '.') {
+            ++p_;
+            if (!digits()) return false;
+        }
+        if (p_ != end_ && (*p_ == 'e' || *p_ == 'E')) {
+            ++p_;
+            if (p_ != end_ && (*p_ == '+' || *p_ == '-')) ++p_;
+            if (!digits()) return false;
+        }
+        return true;
+    }
+
+    bool hex4(unsigned& cp) {
+        if (end_ - p_ < 4) return false;
+        cp = 0;
+        for (int i = 0; i < 4; ++i) {
+            const int v = hex_value(p_[i]);
+            if (v < 0) return false;
+            cp = (cp << 4) | static_cast<unsigned>(v);
+        }
+        p_ += 4;
+        return true;
+    }
+
+    bool escape(std::string* out) {
+        ++p_;
+        if (p_ == end_) return false;
+
+        char decoded = 0;
+        switch (*p_++) {
+            case '"': decoded = '"'; break;
+            case '\\': decoded = '\\'; break;
+            case '/': decoded = '/'; break;
+            case 'b': decoded = '\b'; break;
+            case 'f': decoded = '\f'; break;
+            case 'n': decoded = '\n'; break;
+            case 'r': decoded = '\r'; break;
+            case 't': decoded = '\t'; break;
+            case 'u': {
+                unsigned cp = 0;
+                if (!hex4(cp)) return false;
+                if (cp >= 0xDC00 && cp <= 0xDFFF) return false;
+                if (cp >= 0xD800 && cp <= 0xDBFF) {
+                    // Суррогатная пара: сразу за ней обязана идти вторая половина.
+                    unsigned low = 0;
+                    if (end_ - p_ < 2 || p_[0] != '\\' || p_[1] != 'u') return false;
+                    p_ += 2;
+                    if (!hex4(low) || low < 0xDC00 || low > 0xDFFF) return false;
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                }
+                if (out) append_utf8(*out, cp);
+                return true;
+            }
+            default: return false;
+        }
+        if (out) *out += decoded;
+        return true;
+    }
+
+    // Один многобайтовый символ UTF-8 (без overlong и суррогатов).
+    bool utf8() {
+        const auto lead = static_cast<unsigned char>(*p_);
+        int tail = 0;
+        unsigned char lo = 0x80, hi = 0xBF; // допустимый диапазон второго байта
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            tail = 1;
+        } else if (lead == 0xE0) {
+            tail = 2; lo = 0xA0;
+        } else if ((lead >= 0xE1 && lead <= 0xEC) || lead == 0xEE || lead == 0xEF) {
+            tail = 2;
+        } else if (lead == 0xED) {
+            tail = 2; hi = 0x9F;
+        } else if (lead == 0xF0) {
+            tail = 3; lo = 0x90;
+        } else if (lead >= 0xF1 && lead <= 0xF3) {
+            tail = 3;
+        } else if (lead == 0xF4) {
+            tail = 3; hi = 0x8F;
+        } else {
+            return false;
+        }
+        if (end_ - p_ <= tail) return false;
+
+        for (int i = 1; i <= tail; ++i) {
+            const auto c = static_cast<unsigned char>(p_[i]);
+            if (c < (i == 1 ? lo : 0x80) || c > (i == 1 ? hi : 0xBF)) return false;
+        }
+        p_ += tail + 1;
+        return true;
+    }
+
+    const char* p_;
+    const char* end_;
+};
+
+// Значение поля по его тексту. Целые — как их печатает nlohmann (не
+// влезающее в 64 бита nlohmann считает дробным — здесь это Other).
+JsonField field_of(std::string_view span) {
+    JsonField field;
+    const char first = span.front();
+    if (first == '"') {
+        field.type = JsonField::Type::String;
+        Scanner(span).string(&field.text);
+        return field;
+    }
+
+    field.type = JsonField::Type::Other;
+    if (first != '-' && !is_digit(first)) return field;
+    if (span.find_first_of(".eE") != std::string_view::npos) return field;
+
+    const char* begin = span.data();
+    const char* end = span.data() + span.size();
+    if (first == '-') {
+        long long value = 0;
+        if (std::from_chars(begin, end, value).ec != std::errc()) return field;
+        field.text = std::to_string(value);
+    } else {
+        unsigned long long value = 0;
+        if (std::from_chars(begin, end, value).ec != std::errc()) return field;
+        field.text = std::to_string(value);
+    }
+    field.type = JsonField::Type::Integer;
+    return field;
+}
+
+void collect(const std::vector<std::string>& keys, JsonFields& fields, const std::string& key, std::string_view span) {
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (keys[i] == key) fields[i] = field_of(span);
+    }
+}
+
+} // namespace
+
+std::optional<JsonFields> json_scan_object(std::string_view json, const std::vector<std::string>& keys) {
+    Scanner scanner(json);
+    if (scanner.peek() != '{') return std::nullopt;
+
+    JsonFields fields(keys.size());
+    const bool ok = scanner.object(0, [&](const std::string& key, std::string_view span) {
+        collect(keys, fields, key, span);
+    });
+    if (!ok || !scanner.at_end()) return std::nullopt;
+    return fields;
+}
+
+std::optional<JsonList> json_scan_list(std::string_view json, const std::vector<std::string>& keys) {
+    static const char* const kListKeys[] = {"items", "results", "data"};
+
+    Scanner scanner(json);
+    std::string_view list;
+    bool ok = false;
+    if (scanner.peek() == '{') {
+        std::string_view candidates[3];
+        ok = scanner.object(0, [&](const std::string& key, std::string_view span) {
+            for (size_t i = 0; i < 3; ++i) {
+                if (key == kListKeys[i]) candidates[i] = span;
+            }
+        });
+        for (auto candidate : candidates) {
+            if (!candidate.empty() && candidate.front() == '[') {
+                list = candidate;
+                break;
+            }
+        }
+    } else {
+        ok = scanner.value(&list);
+        if (ok && list.front() != '[') list = {};
+    }
+    if (!ok || !scanner.at_end()) return std::nullopt;
+
+    JsonList result;
+    if (list.empty()) return result;
+
+    // Второй проход только по самому списку.
+    Scanner items(list);
+    items.array(0, [&](std::string_view span) {
+        ++result.size;
+        if (span.front() != '{') return;
+
+        JsonFields fields(keys.size());
+        Scanner(span).object(1, [&](const std::string& key, std::string_view value) {
+            collect(keys, fields, key, value);
+        });
+        result.objects.push_back(std::move(fields));
+    });
+    return result;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Разбор JSON «по требованию»: документ проходится один раз с проверкой
+// синтаксиса, но без построения DOM — достаются только запрошенные поля
+// корневого объекта или элементов списка. Остальное лишь пропускается.
+//
+// nullopt — документ некорректен (или слишком глубоко вложен); тогда
+// вызывающий откатывается на полный разбор nlohmann и ведёт себя как
+// раньше. При повторяющихся ключах, как и в nlohmann, берётся последний.
+
+struct JsonField {
+    enum class Type { Missing, String, Integer, Other };
+
+    Type type = Type::Missing;
+    std::string text; // String — декодированная строка, Integer — десятичная запись
+};
+
+// Поля в порядке запрошенных ключей.
+using JsonFields = std::vector<JsonField>;
+
+// Корень — объект: значения ключей keys. Корень не объект — тоже nullopt.
+std::optional<JsonFields> json_scan_object(std::string_view json, const std::vector<std::string>& keys);
+
+struct JsonList {
+    size_t size = 0;                 // элементов всего, включая не-объекты
+    std::vector<JsonFields> objects; // поля элементов-объектов, по порядку
+};
+
+// Список — корневой массив или массив под "items", "results", "data"
+// корневого объекта (в этом порядке). Списка нет — size == 0.
+std::optional<JsonList> json_scan_list(std::string_view json, const std::vector<std::string>& keys);
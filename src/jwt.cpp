@@ -0,0 +1,88 @@
+#include "jwt.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <limits>
+#include <string_view>
+
+namespace {
+
+int base64url_value(unsigned char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '-' || c == '+') return 62;
+    if (c == '_' || c == '/') return 63;
+    return -1;
+}
+
+std::optional<std::string> base64url_decode(std::string_view in) {
+    while (!in.empty() && in.back() == '=') in.remove_suffix(1);
+
+    std::string out;
+    out.reserve(in.size() * 3 / 4);
+
+    uint32_t acc = 0;
+    int bits = 0;
+    for (unsigned char c : in) {
+        int v = base64url_value(c);
+        if (v < 0) return std::nullopt;
+        acc = (acc << 6) | static_cast<uint32_t>(v);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out.push_back(static_cast<char>((acc >> bits) & 0xff));
+        }
+    }
+    return out;
+}
+
+// Payload JWT как JSON-объект; discarded — не JWT.
+nlohmann::json jwt_payload(const std::string& token) {
+    // header.payload.signature
+    auto first = token.find('.');
+    if (first == std::string::npos) return nlohmann::json::value_t::discarded;
+    auto second = token.find('.', first + 1);
+    if (second == std::string::npos) return nlohmann::json::value_t::discarded;
+
+    auto payload = base64url_decode(std::string_view(token).substr(first + 1, second - first - 1));
+    if (!payload) return nlohmann::json::value_t::discarded;
+
+    auto j = nlohmann::json::parse(*payload, nullptr, false);
+    if (!j.is_object()) return nlohmann::json::value_t::discarded;
+    return j;
+}
+
+} // namespace
+
+std::optional<int64_t> jwt_exp(const std::string& token) {
+    auto j = jwt_payload(token);
+    if (j.is_discarded()) return std::nullopt;
+
+    auto it = j.find("exp");
+    if (it == j.end()) return std::nullopt;
+    if (it->is_number_unsigned()) {
+        const auto exp = it->get<uint64_t>();
+        if (exp > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) return std::nullopt;
+        return static_cast<int64_t>(exp);
+    }
+    if (it->is_number_integer()) return it->get<int64_t>();
+    if (!it->is_number_float()) return std::nullopt;
+
+    // NumericDate может быть дробным; вне диапазона int64_t (1e300, inf) — битый токен.
+    const double exp = it->get<double>();
+    if (!(exp >= -9223372036854775808.0 && exp < 9223372036854775808.0)) return std::nullopt;
+    return static_cast<int64_t>(exp);
+}
+
+std::optional<std::string> jwt_sub(const std::string& token) {
+    auto j = jwt_payload(token);
+    if (j.is_discarded()) return std::nullopt;
+
+    auto it = j.find("sub");
+    if (it == j.end()) return std::nullopt;
+    if (it->is_string()) return it->get<std::string>();
+    if (it->is_number_unsigned()) return std::to_string(it->get<uint64_t>());
+    if (it->is_number_integer()) return std::to_string(it->get<int64_t>());
+    return std::nullopt;
+}
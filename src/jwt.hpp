@@ -0,0 +1,12 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// Claim exp из JWT (unix-время, секунды). Подпись не проверяется: токен
+// выдал Auth, нам нужно только знать, когда он истечёт.
+// nullopt — не JWT или exp нет.
+std::optional<int64_t> jwt_exp(const std::string& token);
+
+// Claim sub (идентификатор пользователя); число приводится к строке.
+std::optional<std::string> jwt_sub(const std::string& token);
@@ -0,0 +1,330 @@
+#include "login_poller.hpp"
+#include "api/upstreams.hpp"
+#include "jwt.hpp"
+
+#include <crow.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+
+// Больше входов в одном тике не опрашиваем: остальные уйдут следующим,
+// сразу за этим.
+constexpr size_t kMaxBatch = 128;
+
+// Входы, которым пора вот-вот, опрашиваем вместе с текущими: так расписания
+// сходятся и пачки получаются крупнее.
+constexpr auto kBatchSlack = std::chrono::milliseconds(50);
+
+// Пачка auth_fetcher завершается не позже этого: неответившие — nullopt.
+constexpr auto kBatchDeadline = std::chrono::seconds(15);
+
+// Опрос, итог которого так и не пришёл (fetcher потерял колбэк), больше не
+// считается «в полёте»: вход снова опрашивается или вытесняется по idle.
+constexpr auto kStuckInFlight = std::chrono::seconds(30);
+
+bool is_approved(const AuthStatus& st) {
+    return st.status == "approved" || st.status == "success";
+}
+
+bool is_refused(const AuthStatus& st) {
+    return st.status == "denied" || st.status == "expired";
+}
+
+} // namespace
+
+class LoginPoller::Core : public std::enable_shared_from_this<Core> {
+public:
+    Core(SessionStore& sessions, asio::io_context& io, StatusFetcher fetch, LoginBackoff backoff)
+        : sessions_(sessions),
+          io_(io),
+          fetch_(std::move(fetch)),
+          backoff_(backoff),
+          timer_(std::make_shared<asio::steady_timer>(io)) {}
+
+    ~Core() {
+        // Таймер трогаем только из потока asio.
+        asio::post(io_, [timer = timer_] { timer->cancel(); });
+    }
+
+    void watch(const std::string& session_key, const std::string& login_token) {
+        const auto now = Clock::now();
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            auto& entry = pending_[session_key];
+            if (entry.login_token != login_token) {
+                entry = Pending{};
+                entry.login_token = login_token;
+                entry.next_poll = now;
+            } else if (!entry.in_flight) {
+                // Пользователь ждёт на странице — опрашиваем снова часто,
+                // но не чаще initial. Опрос в полёте учтёт это в back_off().
+                entry.interval = backoff_.initial;
+                entry.next_poll = std::min(entry.next_poll, std::max(entry.last_poll + backoff_.initial, now));
+            }
+            entry.last_seen = now;
+            if (entry.in_flight || entry.next_poll >= armed_for_) return;
+            armed_for_ = entry.next_poll;
+        }
+        post_arm();
+    }
+
+    bool take_authorized(const std::string& session_key) {
+        if (authorized_count_.load(std::memory_order_acquire) == 0) return false;
+
+        std::lock_guard<std::mutex> lock(mu_);
+        if (authorized_.erase(session_key) == 0) return false;
+        authorized_count_.store(authorized_.size(), std::memory_order_release);
+        return true;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Pending {
+        std::string login_token;
+        Clock::time_point next_poll;
+        Clock::time_point last_poll;
+        Clock::time_point last_seen;
+        std::chrono::milliseconds interval {0};
+        bool in_flight = false;
+    };
+
+    void post_arm() {
+        std::weak_ptr<Core> weak = shared_from_this();
+        asio::post(io_, [weak] {
+            if (auto core = weak.lock()) core->arm();
+        });
+    }
+
+    // Только в потоке asio.
+    void arm() {
+        Clock::time_point at;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            at = armed_for_;
+        }
+        if (at == Clock::time_point::max()) return;
+
+        timer_->expires_at(at);
+        std::weak_ptr<Core> weak = shared_from_this();
+        timer_->async_wait([weak, timer = timer_](const asio::error_code& ec) {
+            auto core = weak.lock();
+            if (!core || ec) return;
+            core->tick();
+        });
+    }
+
+    // Входов в ожидании немного (сотни), поэтому просто проходим по всем.
+    void tick() {
+        const auto now = Clock::now();
+        std::vector<std::string> keys;
+        std::vector<std::string> tokens;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            armed_for_ = Clock::time_point::max();
+            for (auto it = pending_.begin(); it != pending_.end();) {
+                auto& entry = it->second;
+                if (entry.in_flight && now - entry.last_poll > kStuckInFlight) {
+                    CROW_LOG_WARNING << "login poll " << it->first << ": no status in "
+                                     << kStuckInFlight.count() << " s, polling again";
+                    entry.in_flight = false;
+                    entry.next_poll = now;
+                }
+                if (!entry.in_flight && now - entry.last_seen > backoff_.idle) {
+                    it = pending_.erase(it);
+                    continue;
+                }
+                if (!entry.in_flight) {
+                    if (entry.next_poll <= now + kBatchSlack && keys.size() < kMaxBatch) {
+                        entry.in_flight = true;
+                        entry.last_poll = now;
+                        keys.push_back(it->first);
+                        tokens.push_back(entry.login_token);
+                    } else {
+                        armed_for_ = std::min(armed_for_, entry.next_poll);
+                    }
+                }
+                if (entry.in_flight) armed_for_ = std::min(armed_for_, entry.last_poll + kStuckInFlight);
+                ++it;
+            }
+            for (auto it = authorized_.begin(); it != authorized_.end();) {
+                it = now - it->second > backoff_.idle ? authorized_.erase(it) : std::next(it);
+            }
+            authorized_count_.store(authorized_.size(), std::memory_order_release);
+        }
+
+        if (!keys.empty()) {
+            std::weak_ptr<Core> weak = shared_from_this();
+            fetch_(tokens, [weak, keys, tokens](Statuses statuses) {
+                auto core = weak.lock();
+                if (!core) return;
+                core->on_statuses(keys, tokens, std::move(statuses));
+            });
+        }
+        arm();
+    }
+
+    void on_statuses(const std::vector<std::string>& keys,
+                     const std::vector<std::string>& tokens,
+                     Statuses statuses) {
+        bool rearm = false;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            std::optional<AuthStatus> st;
+            if (i < statuses.size()) st = std::move(statuses[i]);
+
+            if (st && is_approved(*st) && !st->access_token.empty() && !st->refresh_token.empty()) {
+                authorize(keys[i], tokens[i], std::move(*st));
+            } else if (st && is_refused(*st)) {
+                refuse(keys[i], tokens[i]);
+            } else {
+                rearm = back_off(keys[i], tokens[i]) || rearm;
+            }
+        }
+        if (rearm) post_arm();
+    }
+
+    // Ещё ждём (или Auth не ответил): следующий опрос — через больший интервал.
+    bool back_off(const std::string& session_key, const std::string& login_token) {
+        std::lock_guard<std::mutex> lock(mu_);
+        auto it = pending_.find(session_key);
+        if (it == pending_.end() || it->second.login_token != login_token) return false;
+
+        auto& entry = it->second;
+        entry.in_flight = false;
+        const bool active = entry.last_seen >= entry.last_poll;
+        entry.interval = active || entry.interval.count() == 0
+            ? backoff_.initial
+            : std::min(backoff_.max, std::chrono::duration_cast<std::chrono::milliseconds>(entry.interval * backoff_.factor));
+        entry.next_poll = entry.last_poll + entry.interval;
+        if (entry.next_poll >= armed_for_) return false;
+        armed_for_ = entry.next_poll;
+        return true;
+    }
+
+    void authorize(const std::string& session_key, const std::string& login_token, AuthStatus st) {
+        const int64_t access_exp = jwt_exp(st.access_token).value_or(0);
+        auto mutate = [login_token, st = std::move(st), access_exp](const SessionData& current) -> std::optional<SessionData> {
+            if (current.status == "authorized" || current.login_token != login_token) return std::nullopt;
+            SessionData session = current;
+            session.status = "authorized";
+            session.access_token = st.access_token;
+            session.refresh_token = st.refresh_token;
+            session.access_exp = access_exp;
+            session.login_token.clear();
+            return session;
+        };
+        resolve(session_key, login_token, std::move(mutate), true);
+    }
+
+    // Отказ: стираем login_token, такую сессию удалит обработчик.
+    void refuse(const std::string& session_key, const std::string& login_token) {
+        auto mutate = [login_token](const SessionData& current) -> std::optional<SessionData> {
+            if (current.status == "authorized" || current.login_token != login_token) return std::nullopt;
+            SessionData session = current;
+            session.login_token.clear();
+            return session;
+        };
+        resolve(session_key, login_token, std::move(mutate), false);
+    }
+
+    // Вход завершён, опрос прекращаем при любом исходе записи: если записать
+    // не вышло, а сессия всё ещё ждёт, следующий запрос снова вызовет watch().
+    void resolve(const std::string& session_key,
+                 const std::string& login_token,
+                 SessionStore::Mutate mutate,
+                 bool authorized) {
+        std::weak_ptr<Core> weak = shared_from_this();
+        sessions_.update_async(session_key, std::move(mutate), [weak, session_key, login_token, authorized](bool written) {
+            auto core = weak.lock();
+            if (!core) return;
+
+            std::lock_guard<std::mutex> lock(core->mu_);
+            auto it = core->pending_.find(session_key);
+            if (it != core->pending_.end() && it->second.login_token == login_token) core->pending_.erase(it);
+            if (written && authorized) {
+                core->authorized_[session_key] = Clock::now();
+                core->authorized_count_.store(core->authorized_.size(), std::memory_order_release);
+            }
+        });
+    }
+
+    SessionStore& sessions_;
+    asio::io_context& io_;
+    StatusFetcher fetch_;
+    LoginBackoff backoff_;
+    std::shared_ptr<asio::steady_timer> timer_;
+
+    std::mutex mu_;
+    std::unordered_map<std::string, Pending> pending_;
+    Clock::time_point armed_for_ = Clock::time_point::max();
+    std::unordered_map<std::string, Clock::time_point> authorized_;
+    std::atomic<size_t> authorized_count_ {0};
+};
+
+LoginPoller::LoginPoller(SessionStore& sessions, asio::io_context& io, StatusFetcher fetch, LoginBackoff backoff)
+    : core_(std::make_shared<Core>(sessions, io, std::move(fetch), backoff)) {}
+
+LoginPoller::~LoginPoller() = default;
+
+LoginPoller::StatusFetcher LoginPoller::auth_fetcher(asio::io_context& io) {
+    return [&io](const std::vector<std::string>& tokens, std::function<void(Statuses)> on_done) {
+        struct Batch {
+            std::mutex mu;
+            Statuses results;
+            size_t left;
+            bool done = false;
+            std::function<void(Statuses)> on_done;
+            asio::steady_timer deadline;
+
+            explicit Batch(asio::io_context& io) : deadline(io, kBatchDeadline) {}
+
+            // Ровно один вызов on_done: по последнему ответу или по сроку.
+            void complete() {
+                Statuses out;
+                {
+                    std::lock_guard<std::mutex> lock(mu);
+                    if (done) return;
+                    done = true;
+                    out = std::move(results);
+                }
+                on_done(std::move(out));
+            }
+        };
+        auto batch = std::make_shared<Batch>(io);
+        batch->results.resize(tokens.size());
+        batch->left = tokens.size();
+        batch->on_done = std::move(on_done);
+        batch->deadline.async_wait([batch](const asio::error_code& ec) {
+            if (!ec) batch->complete();
+        });
+
+        const auto upstream = upstreams();
+        for (size_t i = 0; i < tokens.size(); ++i) {
+            upstream->auth.StatusAsync(tokens[i], [batch, &io, i](std::optional<AuthStatus> st) {
+                bool last = false;
+                {
+                    std::lock_guard<std::mutex> lock(batch->mu);
+                    if (batch->done) return;
+                    batch->results[i] = std::move(st);
+                    last = --batch->left == 0;
+                }
+                if (!last) return;
+                batch->complete();
+                // Таймер трогаем только из потока asio.
+                asio::post(io, [batch] { batch->deadline.cancel(); });
+            });
+        }
+    };
+}
+
+void LoginPoller::watch(const std::string& session_key, const std::string& login_token) {
+    core_->watch(session_key, login_token);
+}
+
+bool LoginPoller::take_authorized(const std::string& session_key) {
+    return core_->take_authorized(session_key);
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "api/auth_client.hpp"
+#include "async_redis.hpp"
+#include "session_store.hpp"
+
+// Интервалы опроса Auth по незавершённому входу. После каждого «pending»
+// интервал растёт в factor раз до max; запрос пользователя по этой сессии
+// возвращает его к initial. Вход, по которому давно не было запросов
+// (вкладку закрыли), больше не опрашивается.
+struct LoginBackoff {
+    std::chrono::milliseconds initial {1000};
+    std::chrono::milliseconds max {10000};
+    double factor = 2.0;
+    std::chrono::seconds idle {300};
+};
+
+// Фоновый опрос статуса входа.
+//
+// Обработчики анонимных сессий больше не ходят в Auth сами: они только
+// сообщают watch(), что вход по login_token ещё ждут, и отдают страницу
+// входа. Поллер раз в тик собирает все входы, которым пора, и одним
+// вызовом fetcher'а спрашивает Auth о них всех. Итог пишется прямо в сессию
+// (compare-and-set в Redis), так что следующий запрос с любого инстанса
+// видит уже авторизованную сессию; отказ стирает login_token, и обработчик
+// удаляет такую сессию.
+class LoginPoller {
+public:
+    using Statuses = std::vector<std::optional<AuthStatus>>;
+    // Статусы в порядке tokens; nullopt — Auth не ответил. on_done можно
+    // вызвать из любого потока.
+    using StatusFetcher = std::function<void(const std::vector<std::string>& tokens,
+                                             std::function<void(Statuses)> on_done)>;
+
+    LoginPoller(SessionStore& sessions,
+                asio::io_context& io,
+                StatusFetcher fetch,
+                LoginBackoff backoff = {});
+    ~LoginPoller();
+
+    LoginPoller(const LoginPoller&) = delete;
+    LoginPoller& operator=(const LoginPoller&) = delete;
+
+    // Fetcher поверх AuthClient::StatusAsync (клиент — из upstreams() на
+    // каждую пачку). Пакетного статуса у Auth нет, поэтому запросы пачки
+    // уходят параллельно через HTTP-цикл. Пачка завершается не позже чем
+    // через 15 с (таймер в io): неответившие получают nullopt.
+    static StatusFetcher auth_fetcher(asio::io_context& io);
+
+    // Вход по login_token для этой сессии ещё ждут.
+    void watch(const std::string& session_key, const std::string& login_token);
+
+    // Сессию только что авторизовал этот поллер (один раз true): пора
+    // выставить cookie с Max-Age авторизованной сессии.
+    bool take_authorized(const std::string& session_key);
+
+private:
+    class Core;
+    std::shared_ptr<Core> core_;
+};
@@ -1,16 +1,89 @@
 #include <crow.h>
+#include "app.hpp"
+#include "async_redis.hpp"
+#include "config.hpp"
+#include "login_poller.hpp"
 #include "redis.hpp"
+#include "session_refresh.hpp"
+#include "session_store.hpp"
 #include "handlers.hpp"
+#include "api/upstreams.hpp"
+
+#include <csignal>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace {
+
+// SIGHUP — перечитать конфигурацию. Обработчик идёт в потоке redis_io:
+// запросы в это время продолжают работать со своими снимками.
+void reload_on_sighup(asio::signal_set& signals) {
+    signals.async_wait([&signals](const asio::error_code& ec, int) {
+        if (ec) return;
+        if (reload_config()) upstreams(); // клиенты — сразу, а не первым запросом
+        reload_on_sighup(signals);
+    });
+}
+
+} // namespace
 
 int main() {
-    crow::SimpleApp app;
-    RedisClient redis;
+    set_config(std::make_shared<const Config>(load_config()));
+    const auto cfg = config();
+
+    App app;
+    auto& compression = app.get_middleware<Compression>().options;
+    compression.level = cfg->compression_level;
+    compression.min_size = cfg->compression_min_size;
+    auto& tracing = app.get_middleware<Tracing>().options;
+    tracing.sample_rate = cfg->trace_sample_rate;
+    tracing.trust_parent = cfg->trace_trust_parent;
+    tracing.server_timing = cfg->trace_server_timing;
+    if (!cfg->trace_export_file.empty()) tracing.exporter = std::make_shared<trace::Exporter>(cfg->trace_export_file);
+    RedisClient redis(cfg->redis_host, cfg->redis_port, cfg->redis_pool_size);
+    upstreams();
+
+    // Отдельный цикл событий для неблокирующих команд Redis: Crow не отдаёт
+    // свой io_context наружу, а одному потоку хватает на тысячи команд в полёте.
+    asio::io_context redis_io;
+    auto redis_work = asio::make_work_guard(redis_io);
+    asio::signal_set reload_signals(redis_io, SIGHUP);
+    reload_on_sighup(reload_signals);
+    std::thread redis_thread([&redis_io] { redis_io.run(); });
+
+    {
+        AsyncRedisClient redis_async(redis_io, cfg->redis_host, cfg->redis_port, cfg->redis_async_connections);
+        SessionTtl session_ttl;
+        session_ttl.anonymous = cfg->session_ttl_anonymous;
+        session_ttl.authorized = cfg->session_ttl_authorized;
+        SessionStore sessions(redis, redis_async, session_ttl);
+        SessionRefresher refresher(sessions, redis_async, redis_io, cfg->token_refresh_ahead, cfg->refresh_wait);
+
+        LoginBackoff login_backoff;
+        login_backoff.initial = cfg->login_poll_min;
+        login_backoff.max = cfg->login_poll_max;
+        LoginPoller login_poller(sessions, redis_io, LoginPoller::auth_fetcher(redis_io), login_backoff);
 
-    register_root(app, redis);
-    register_login(app, redis);
-    register_logout(app, redis);
-    register_catchall(app, redis);
+        register_root(app, sessions, refresher, login_poller);
+        register_login(app, sessions);
+        register_logout(app, sessions);
+        register_metrics(app);
+        register_catchall(app, sessions, refresher, login_poller);
 
-    app.bindaddr("0.0.0.0").port(8080).multithreaded().run();
+        app.bindaddr("0.0.0.0").port(static_cast<uint16_t>(cfg->port));
+        if (cfg->worker_threads > 0) {
+            app.concurrency(static_cast<uint16_t>(cfg->worker_threads));
+        } else {
+            app.multithreaded();
+        }
+        app.run();
+    }
 
+    asio::error_code ignored;
+    reload_signals.cancel(ignored);
+    redis_work.reset();
+    redis_io.stop();
+    redis_thread.join();
 }
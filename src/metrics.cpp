@@ -0,0 +1,370 @@
+#include "metrics.hpp"
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+namespace metrics {
+namespace {
+
+enum class Type { Counter, Gauge, Histogram };
+
+// Значения одного потока. Пишет только владелец, читает /metrics — поэтому
+// хватает load + store без read-modify-write.
+struct Shard {
+    struct Hist {
+        std::array<std::atomic<uint64_t>, kBuckets> buckets;
+        std::atomic<uint64_t> sum_ns;
+    };
+
+    std::array<std::atomic<uint64_t>, kMaxCounters> counters;
+    std::array<Hist, kMaxHistograms> histograms;
+};
+
+void bump(std::atomic<uint64_t>& cell, uint64_t n) {
+    cell.store(cell.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+struct Series {
+    std::string labels; // уже в виде name="value",...
+    size_t slot;
+};
+
+struct Family {
+    std::string name;
+    std::string help;
+    Type type;
+    std::vector<Series> series;
+};
+
+std::string escape_label(std::string_view value) {
+    std::string out;
+    out.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\' || c == '"') out += '\\';
+        if (c == '\n') {
+            out += "\\n";
+            continue;
+        }
+        out += c;
+    }
+    return out;
+}
+
+std::string format_labels(const Labels& labels) {
+    std::string out;
+    for (const auto& [name, value] : labels) {
+        if (!out.empty()) out += ',';
+        out += name;
+        out += "=\"";
+        out += escape_label(value);
+        out += '"';
+    }
+    return out;
+}
+
+class Registry {
+public:
+    size_t add(const std::string& name, const std::string& help, Type type, const Labels& labels) {
+        const auto formatted = format_labels(labels);
+        std::lock_guard<std::mutex> lock(mu_);
+
+        Family* family = nullptr;
+        for (auto& f : families_) {
+            if (f.name == name) family = &f;
+        }
+        if (!family) {
+            families_.push_back({name, help, type, {}});
+            family = &families_.back();
+        } else if (family->type != type) {
+            throw std::invalid_argument("metrics: " + name + " registered with another type");
+        }
+
+        for (const auto& s : family->series) {
+            if (s.labels == formatted) return s.slot;
+        }
+
+        size_t& next = type == Type::Histogram ? next_histogram_ : next_counter_;
+        const size_t limit = type == Type::Histogram ? kMaxHistograms : kMaxCounters;
+        if (next == limit) {
+            CROW_LOG_WARNING << "metrics: too many series, dropping " << name << "{" << formatted << "}";
+            return kDropped;
+        }
+        family->series.push_back({formatted, next});
+        return next++;
+    }
+
+    Shard* attach() {
+        auto shard = std::make_unique<Shard>();
+        std::lock_guard<std::mutex> lock(mu_);
+        shards_.push_back(std::move(shard));
+        return shards_.back().get();
+    }
+
+    std::string render() {
+        std::lock_guard<std::mutex> lock(mu_);
+        std::string out;
+        out.reserve(64 * 1024);
+        for (const auto& family : families_) {
+            out += "# HELP " + family.name + " " + family.help + "\n";
+            out += "# TYPE " + family.name + " " + type_name(family.type) + "\n";
+            for (const auto& series : family.series) {
+                if (family.type == Type::Histogram) {
+                    render_histogram(out, family.name, series);
+                } else {
+                    render_value(out, family.name, series, family.type);
+                }
+            }
+        }
+        return out;
+    }
+
+private:
+    static const char* type_name(Type type) {
+        switch (type) {
+            case Type::Counter: return "counter";
+            case Type::Gauge: return "gauge";
+            default: return "histogram";
+        }
+    }
+
+    static void append_series(std::string& out, const std::string& name, std::string_view suffix,
+                              const std::string& labels, std::string_view extra) {
+        out += name;
+        out += suffix;
+        if (!labels.empty() || !extra.empty()) {
+            out += '{';
+            out += labels;
+            if (!labels.empty() && !extra.empty()) out += ',';
+            out += extra;
+            out += '}';
+        }
+        out += ' ';
+    }
+
+    void render_value(std::string& out, const std::string& name, const Series& series, Type type) const {
+        uint64_t total = 0;
+        for (const auto& shard : shards_) {
+            total += shard->counters[series.slot].load(std::memory_order_relaxed);
+        }
+        append_series(out, name, "", series.labels, "");
+        // Gauge хранится как int64 по модулю 2^64.
+        out += type == Type::Gauge ? std::to_string(static_cast<int64_t>(total)) : std::to_string(total);
+        out += '\n';
+    }
+
+    void render_histogram(std::string& out, const std::string& name, const Series& series) const {
+        std::array<uint64_t, kBuckets> buckets {};
+        uint64_t sum_ns = 0;
+        for (const auto& shard : shards_) {
+            const auto& h = shard->histograms[series.slot];
+            for (size_t i = 0; i < kBuckets; ++i) buckets[i] += h.buckets[i].load(std::memory_order_relaxed);
+            sum_ns += h.sum_ns.load(std::memory_order_relaxed);
+        }
+
+        char num[32];
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            cumulative += buckets[i];
+            std::string le = "le=\"";
+            if (i + 1 == kBuckets) {
+                le += "+Inf";
+            } else {
+                std::snprintf(num, sizeof(num), "%.9g", bucket_bound(i));
+                le += num;
+            }
+            le += '"';
+            append_series(out, name, "_bucket", series.labels, le);
+            out += std::to_string(cumulative);
+            out += '\n';
+        }
+        std::snprintf(num, sizeof(num), "%.9g", static_cast<double>(sum_ns) / 1e9);
+        append_series(out, name, "_sum", series.labels, "");
+        out += num;
+        out += '\n';
+        append_series(out, name, "_count", series.labels, "");
+        out += std::to_string(cumulative);
+        out += '\n';
+    }
+
+    std::mutex mu_;
+    std::vector<Family> families_; // ссылки на элементы не хранятся — можно расти
+    std::vector<std::unique_ptr<Shard>> shards_;
+    size_t next_counter_ = 0;
+    size_t next_histogram_ = 0;
+};
+
+// Не разрушается: потоки asio и curl могут писать метрики до самого выхода.
+Registry& registry() {
+    static Registry* instance = new Registry();
+    return *instance;
+}
+
+Shard& local() {
+    // Шард потока живёт до конца процесса: значения завершившихся потоков
+    // остаются в суммах, счётчики не откатываются.
+    thread_local Shard* shard = registry().attach();
+    return *shard;
+}
+
+// Ряды семейств с динамической меткой: id семейства -> значение -> слот.
+std::atomic<size_t> next_family_id {0};
+
+using FamilyCache = std::vector<std::map<std::string, size_t, std::less<>>>;
+
+template <class Make>
+size_t cached_slot(size_t family_id, std::string_view value, Make&& make) {
+    thread_local FamilyCache cache;
+    if (cache.size() <= family_id) cache.resize(family_id + 1);
+    auto& slots = cache[family_id];
+    auto it = slots.find(value);
+    if (it != slots.end()) return it->second;
+    const size_t slot = make();
+    slots.emplace(std::string(value), slot);
+    return slot;
+}
+
+} // namespace
+
+void Counter::inc(uint64_t n) const {
+    if (slot == kDropped) return;
+    bump(local().counters[slot], n);
+}
+
+void Gauge::add(int64_t n) const {
+    if (slot == kDropped) return;
+    bump(local().counters[slot], static_cast<uint64_t>(n));
+}
+
+void Histogram::observe(Clock::duration d) const {
+    if (slot == kDropped) return;
+    auto& h = local().histograms[slot];
+    bump(h.buckets[bucket_for(d)], 1);
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+    bump(h.sum_ns, ns > 0 ? static_cast<uint64_t>(ns) : 0);
+}
+
+Counter counter(const std::string& name, const std::string& help, const Labels& labels) {
+    return Counter{registry().add(name, help, Type::Counter, labels)};
+}
+
+Gauge gauge(const std::string& name, const std::string& help, const Labels& labels) {
+    return Gauge{registry().add(name, help, Type::Gauge, labels)};
+}
+
+Histogram histogram(const std::string& name, const std::string& help, const Labels& labels) {
+    return Histogram{registry().add(name, help, Type::Histogram, labels)};
+}
+
+HistogramFamily::HistogramFamily(std::string name, std::string help, std::string label)
+    : name_(std::move(name)), help_(std::move(help)), label_(std::move(label)), id_(next_family_id++) {}
+
+Histogram HistogramFamily::with(std::string_view value) const {
+    return Histogram{cached_slot(id_, value, [&] {
+        return registry().add(name_, help_, Type::Histogram, {{label_, std::string(value)}});
+    })};
+}
+
+CounterFamily::CounterFamily(std::string name, std::string help, std::string label)
+    : name_(std::move(name)), help_(std::move(help)), label_(std::move(label)), id_(next_family_id++) {}
+
+Counter CounterFamily::with(std::string_view value) const {
+    return Counter{cached_slot(id_, value, [&] {
+        return registry().add(name_, help_, Type::Counter, {{label_, std::string(value)}});
+    })};
+}
+
+// Корзина 0 — до 8 мкс; дальше на каждую степень двойки 2^o мкс (o = 3..25)
+// две: до 1.5 * 2^o и до 2^(o+1); последняя — больше 2^26 мкс.
+double bucket_bound(size_t bucket) {
+    if (bucket == 0) return 8e-6;
+    if (bucket + 1 >= kBuckets) return std::numeric_limits<double>::infinity();
+    const int octave = 3 + static_cast<int>((bucket - 1) / 2);
+    const double base = std::ldexp(1.0, octave);
+    return ((bucket - 1) % 2 == 0 ? base * 1.5 : base * 2) * 1e-6;
+}
+
+size_t bucket_for(Clock::duration d) {
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+    if (ns <= 8000) return 0;
+    const uint64_t us = (static_cast<uint64_t>(ns) + 999) / 1000;
+    if (us <= 8) return 0;
+
+    // 2^octave < us <= 2^(octave+1)
+    const int octave = 63 - __builtin_clzll(us - 1);
+    if (octave > 25) return kBuckets - 1;
+    const uint64_t base = uint64_t(1) << octave;
+    const size_t upper_half = (us - 1 - base) >= (base >> 1) ? 1 : 0;
+    return 1 + static_cast<size_t>(octave - 3) * 2 + upper_half;
+}
+
+std::string render() {
+    return registry().render();
+}
+
+} // namespace metrics
+
+// --- RequestMetrics ---
+
+namespace {
+
+constexpr const char* kRoutes[] = {"/", "/login", "/logout", "/metrics", "catchall"};
+constexpr size_t kRouteCount = sizeof(kRoutes) / sizeof(kRoutes[0]);
+constexpr const char* kCodeClasses[] = {"1xx", "2xx", "3xx", "4xx", "5xx"};
+
+size_t route_of(const std::string& url) {
+    const std::string_view path = std::string_view(url).substr(0, url.find('?'));
+    for (size_t i = 0; i + 1 < kRouteCount; ++i) {
+        if (path == kRoutes[i]) return i;
+    }
+    return kRouteCount - 1;
+}
+
+struct RouteSeries {
+    metrics::Histogram latency;
+    metrics::Gauge in_flight;
+    metrics::Counter responses[5];
+};
+
+const RouteSeries& route_series(size_t route) {
+    static const auto table = [] {
+        std::array<RouteSeries, kRouteCount> t;
+        for (size_t i = 0; i < kRouteCount; ++i) {
+            t[i].latency = metrics::histogram("web_client_request_duration_seconds",
+                                              "Time from request start to response end, by route",
+                                              {{"route", kRoutes[i]}});
+            t[i].in_flight = metrics::gauge("web_client_requests_in_flight",
+                                            "Requests being handled now, by route",
+                                            {{"route", kRoutes[i]}});
+            for (size_t c = 0; c < 5; ++c) {
+                t[i].responses[c] = metrics::counter("web_client_responses_total",
+                                                     "Responses sent, by route and status class",
+                                                     {{"route", kRoutes[i]}, {"code", kCodeClasses[c]}});
+            }
+        }
+        return t;
+    }();
+    return table[route];
+}
+
+} // namespace
+
+void RequestMetrics::before_handle(crow::request& req, crow::response&, context& ctx) {
+    ctx.start = metrics::Clock::now();
+    ctx.route = route_of(req.url);
+    route_series(ctx.route).in_flight.inc();
+}
+
+void RequestMetrics::after_handle(crow::request&, crow::response& res, context& ctx) {
+    const auto& series = route_series(ctx.route);
+    series.in_flight.dec();
+    series.latency.observe_since(ctx.start);
+    const int code_class = res.code / 100;
+    if (code_class >= 1 && code_class <= 5) series.responses[code_class - 1].inc();
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <crow.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Метрики в формате Prometheus.
+//
+// Значения лежат в шардах по потокам: каждый поток пишет только в свой
+// (атомики с relaxed, без блокировок и без общих кэш-линий), /metrics
+// складывает шарды при чтении. Регистрация ряда — под мьютексом, но один
+// раз: хэндлы Counter/Gauge/Histogram — это просто индексы, их держат в
+// static и дальше на горячем пути только thread_local и одно сложение.
+//
+// Гистограммы задержек — логарифмические, как в HDR: по две корзины на
+// каждую степень двойки от 8 мкс до ~67 с (погрешность оценки квантиля —
+// меньше четверти значения).
+namespace metrics {
+
+using Clock = std::chrono::steady_clock;
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+constexpr size_t kMaxCounters = 1024; // счётчики и gauge вместе
+constexpr size_t kMaxHistograms = 128;
+constexpr size_t kBuckets = 48;       // последняя — +Inf
+
+// Ряды сверх лимита не регистрируются: их хэндлы ничего не делают.
+constexpr size_t kDropped = static_cast<size_t>(-1);
+
+class Counter {
+public:
+    void inc(uint64_t n = 1) const;
+
+    size_t slot = kDropped;
+};
+
+// Может уходить в минус в отдельном потоке (например, запрос начат в одном,
+// завершён в другом) — сумма по потокам всё равно верна.
+class Gauge {
+public:
+    void add(int64_t n) const;
+    void inc() const { add(1); }
+    void dec() const { add(-1); }
+
+    size_t slot = kDropped;
+};
+
+class Histogram {
+public:
+    void observe(Clock::duration d) const;
+    void observe_since(Clock::time_point start) const { observe(Clock::now() - start); }
+
+    size_t slot = kDropped;
+};
+
+// Ряд с метками; повторная регистрация того же имени и меток возвращает
+// тот же ряд. У одного имени — один тип и одно описание.
+Counter counter(const std::string& name, const std::string& help, const Labels& labels = {});
+Gauge gauge(const std::string& name, const std::string& help, const Labels& labels = {});
+Histogram histogram(const std::string& name, const std::string& help, const Labels& labels = {});
+
+// Семейство с одной меткой, значение которой известно только в момент
+// вызова (имя команды Redis). Значения должны быть из ограниченного набора.
+// Поиск ряда — в thread_local кэше, без блокировок после первого раза.
+class HistogramFamily {
+public:
+    HistogramFamily(std::string name, std::string help, std::string label);
+
+    Histogram with(std::string_view value) const;
+
+private:
+    std::string name_;
+    std::string help_;
+    std::string label_;
+    size_t id_;
+};
+
+class CounterFamily {
+public:
+    CounterFamily(std::string name, std::string help, std::string label);
+
+    Counter with(std::string_view value) const;
+
+private:
+    std::string name_;
+    std::string help_;
+    std::string label_;
+    size_t id_;
+};
+
+// Верхние границы корзин, секунды (последняя — бесконечность).
+double bucket_bound(size_t bucket);
+size_t bucket_for(Clock::duration d);
+
+// Все ряды в текстовом формате Prometheus 0.0.4.
+std::string render();
+
+} // namespace metrics
+
+// Middleware Crow: время и число запросов по маршрутам, запросы в полёте.
+// Для асинхронных ответов время считается до res.end().
+struct RequestMetrics {
+    struct context {
+        metrics::Clock::time_point start;
+        size_t route = 0;
+    };
+
+    void before_handle(crow::request& req, crow::response& res, context& ctx);
+    void after_handle(crow::request& req, crow::response& res, context& ctx);
+};
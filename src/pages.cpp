@@ -0,0 +1,269 @@
+#include "pages.hpp"
+#include <nlohmann/json.hpp>
+
+#include <cstring>
+
+#include "html.hpp"
+#include "json_scan.hpp"
+
+namespace {
+
+constexpr std::string_view kPageHead =
+    "<!doctype html>"
+    "<html lang='ru'>"
+    "<head>"
+    "<meta charset='utf-8'>"
+    "<meta name='viewport' content='width=device-width, initial-scale=1'>"
+    "<title>{{title}}</title>"
+    "</head>"
+    "<body>";
+
+constexpr std::string_view kPageTail = "</body></html>";
+
+constexpr std::string_view kSectionHead = "<h1>{{title}}</h1><a href='{{back}}'>Back</a><hr>";
+
+std::string concat(std::initializer_list<std::string_view> parts) {
+    std::string out;
+    for (auto part : parts) out += part;
+    return out;
+}
+
+// Шаблоны разбираются один раз, при первом обращении: страницы,
+// собранные при старте (StaticPage в других единицах трансляции), могут
+// рендериться раньше, чем дошла бы очередь до глобальных объектов здесь.
+struct Templates {
+    HtmlTemplate layout {concat({kPageHead, "{{{body}}}", kPageTail})};
+    HtmlTemplate text_page {concat({kPageHead, kSectionHead, "<pre>{{text}}</pre>", kPageTail})};
+    HtmlTemplate section_open {concat({kPageHead, kSectionHead})};
+
+    HtmlTemplate dashboard_open {
+        "<!doctype html>"
+        "<html lang='ru'>"
+        "<head>"
+        "<meta charset='utf-8'>"
+        "<meta name='viewport' content='width=device-width, initial-scale=1'>"
+        "<title>Dashboard</title>"
+        "</head>"
+        "<body>"
+        "<h1>Dashboard</h1>"
+        "<a href='/logout'>Logout</a><br>"
+        "<a href='/logout?all=true'>Logout everywhere</a>"
+        "<hr>"
+        "<h2>Навигация</h2>"
+        "<ul>"
+        "<li><a href='/courses'>Courses</a></li>"
+        "<li><a href='/notifications'>Notifications</a></li>"
+        "<li><a href='/users'>Users</a></li>"
+        "</ul>"
+        "<hr>"};
+    HtmlTemplate notifications {"<h2>Notifications</h2><pre>{{text}}</pre>"};
+    HtmlTemplate users_denied {"<h2>Users</h2><p><i>Нет доступа или endpoint недоступен</i></p>"};
+
+    HtmlTemplate list_title {"<h2>{{title}}</h2>"};
+    HtmlTemplate list_link {"<li><a href='{{path}}?{{param}}={{id}}'>{{label}}</a></li>"};
+    HtmlTemplate list_item {"<li>{{label}}</li>"};
+    HtmlTemplate list_text {"<pre>{{json}}</pre>"};
+    HtmlTemplate list_unparsed {"<p><b>Не смог распарсить JSON</b></p><pre>{{json}}</pre>"};
+};
+
+const Templates& templates() {
+    static const Templates instance;
+    return instance;
+}
+
+// Страница описывается одной функцией, которая проходится дважды: сначала
+// PageWriter только складывает размеры частей, затем пишет их в буфер,
+// выделенный ровно под этот размер.
+class PageWriter {
+public:
+    PageWriter() = default;
+    explicit PageWriter(char* out) : out_(out) {}
+
+    void add(const HtmlTemplate& part, HtmlTemplate::Values values = {}) {
+        if (out_) {
+            out_ = part.render_to(out_, values);
+        } else {
+            size_ += part.size(values);
+        }
+    }
+
+    void add(std::string_view text) {
+        if (out_) {
+            std::memcpy(out_, text.data(), text.size());
+            out_ += text.size();
+        } else {
+            size_ += text.size();
+        }
+    }
+
+    size_t size() const { return size_; }
+
+private:
+    char* out_ = nullptr;
+    size_t size_ = 0;
+};
+
+template <typename Build>
+std::string render_page(const Build& build) {
+    PageWriter counter;
+    build(counter);
+
+    std::string html(counter.size(), '\0');
+    PageWriter writer(html.data());
+    build(writer);
+    return html;
+}
+
+void add_link_list(PageWriter& page, const LinkList& list) {
+    const auto& t = templates();
+    page.add(t.list_title, {{"title", list.title}});
+
+    switch (list.kind) {
+        case LinkList::Kind::Links:
+            page.add("<ul>");
+            for (const auto& item : list.items) {
+                if (item.id.empty()) {
+                    page.add(t.list_item, {{"label", item.label}});
+                } else {
+                    page.add(t.list_link, {{"path", list.base_path},
+                                           {"param", list.id_param},
+                                           {"id", item.id},
+                                           {"label", item.label}});
+                }
+            }
+            page.add("</ul>");
+            break;
+        case LinkList::Kind::Text:
+            page.add(t.list_text, {{"json", list.json}});
+            break;
+        case LinkList::Kind::Unparsed:
+            page.add(t.list_unparsed, {{"json", list.json}});
+            break;
+    }
+}
+
+// --- JSON helpers ---
+
+std::vector<nlohmann::json> json_as_list(const nlohmann::json& j) {
+    if (j.is_array()) return j.get<std::vector<nlohmann::json>>();
+
+    if (j.is_object()) {
+        for (const char* key : {"items", "results", "data"}) {
+            auto it = j.find(key);
+            if (it != j.end() && it->is_array()) {
+                return it->get<std::vector<nlohmann::json>>();
+            }
+        }
+    }
+    return {};
+}
+
+std::string json_get_str(const nlohmann::json& o, const std::vector<std::string>& keys) {
+    for (const auto& k : keys) {
+        auto it = o.find(k);
+        if (it != o.end()) {
+            if (it->is_string()) return it->get<std::string>();
+            if (it->is_number_integer()) return std::to_string(it->get<long long>());
+            if (it->is_number_unsigned()) return std::to_string(it->get<unsigned long long>());
+        }
+    }
+    return "";
+}
+
+// Первое из полей [from, to), что есть строкой или целым (как json_get_str).
+std::string first_field(const JsonFields& fields, size_t from, size_t to) {
+    for (size_t i = from; i < to; ++i) {
+        if (fields[i].type == JsonField::Type::String || fields[i].type == JsonField::Type::Integer) {
+            return fields[i].text;
+        }
+    }
+    return "";
+}
+
+void add_item(LinkList& list, std::string id, std::string label) {
+    if (label.empty()) label = id.empty() ? "(item)" : ("ID " + id);
+    list.items.push_back({std::move(id), std::move(label)});
+}
+
+} // namespace
+
+std::string wrap_html(std::string_view title, std::string_view body) {
+    return templates().layout.render({{"title", title}, {"body", body}});
+}
+
+LinkList parse_link_list(std::string_view title,
+                         const std::string& raw_json,
+                         std::string_view base_path,
+                         std::string_view id_param,
+                         const std::vector<std::string>& id_keys,
+                         const std::vector<std::string>& label_keys) {
+    LinkList list;
+    list.title = title;
+    list.base_path = base_path;
+    list.id_param = id_param;
+    list.json = raw_json;
+
+    std::vector<std::string> keys;
+    keys.reserve(id_keys.size() + label_keys.size());
+    keys.insert(keys.end(), id_keys.begin(), id_keys.end());
+    keys.insert(keys.end(), label_keys.begin(), label_keys.end());
+
+    if (auto scanned = json_scan_list(raw_json, keys)) {
+        if (scanned->size == 0) return list;
+        list.kind = LinkList::Kind::Links;
+        list.items.reserve(scanned->objects.size());
+        for (const auto& fields : scanned->objects) {
+            add_item(list,
+                     first_field(fields, 0, id_keys.size()),
+                     first_field(fields, id_keys.size(), keys.size()));
+        }
+        return list;
+    }
+
+    nlohmann::json j;
+    try {
+        j = nlohmann::json::parse(raw_json);
+    } catch (...) {
+        list.kind = LinkList::Kind::Unparsed;
+        return list;
+    }
+
+    auto items = json_as_list(j);
+    if (items.empty()) return list;
+
+    list.kind = LinkList::Kind::Links;
+    list.items.reserve(items.size());
+    for (const auto& it : items) {
+        if (!it.is_object()) continue;
+
+        add_item(list, json_get_str(it, id_keys), json_get_str(it, label_keys));
+    }
+    return list;
+}
+
+std::string render_text_page(std::string_view title, std::string_view back, std::string_view text) {
+    return templates().text_page.render({{"title", title}, {"back", back}, {"text", text}});
+}
+
+std::string render_list_page(std::string_view title, std::string_view back, const LinkList& list) {
+    return render_page([&](PageWriter& page) {
+        page.add(templates().section_open, {{"title", title}, {"back", back}});
+        add_link_list(page, list);
+        page.add(kPageTail);
+    });
+}
+
+std::string render_dashboard_page(const LinkList& courses, std::string_view notifications, const LinkList* users) {
+    return render_page([&](PageWriter& page) {
+        const auto& t = templates();
+        page.add(t.dashboard_open);
+        add_link_list(page, courses);
+        page.add(t.notifications, {{"text", notifications}});
+        if (users) {
+            add_link_list(page, *users);
+        } else {
+            page.add(t.users_denied);
+        }
+        page.add(kPageTail);
+    });
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Сборка HTML страниц — без Crow, только строки (ответы собирает
+// handlers/common.cpp). Каждая страница — разобранный при старте макет:
+// сначала из всех частей считается точный размер, затем страница
+// пишется за один проход в буфер, выделенный один раз.
+
+constexpr std::string_view kLoginLinks =
+    "<a href='/login?type=github'>GitHub</a><br>"
+    "<a href='/login?type=yandex'>Yandex</a><br>"
+    "<a href='/login?type=code'>Code</a>";
+
+// Целая страница: body вставляется как есть.
+std::string wrap_html(std::string_view title, std::string_view body);
+
+// Список ссылок из JSON-ответа Main, выбранный до рендера.
+// Нужны только id и подпись, поэтому сначала разбор «по требованию»;
+// полный DOM nlohmann — только если тот документ не принял.
+// json ссылается на raw_json: список не должен его пережить.
+struct LinkList {
+    enum class Kind {
+        Links,    // items
+        Text,     // не список или пустой — JSON как есть, в <pre>
+        Unparsed, // не JSON
+    };
+
+    struct Item {
+        std::string id; // пусто — без ссылки
+        std::string label;
+    };
+
+    Kind kind = Kind::Text;
+    std::string_view title;
+    std::string_view base_path;
+    std::string_view id_param;
+    std::vector<Item> items;
+    std::string_view json;
+};
+
+LinkList parse_link_list(std::string_view title,
+                         const std::string& raw_json,
+                         std::string_view base_path,
+                         std::string_view id_param,
+                         const std::vector<std::string>& id_keys,
+                         const std::vector<std::string>& label_keys);
+
+// Заголовок, «Назад» и ответ Main как есть, в <pre>.
+std::string render_text_page(std::string_view title, std::string_view back, std::string_view text);
+// Заголовок, «Назад» и список.
+std::string render_list_page(std::string_view title, std::string_view back, const LinkList& list);
+// users == nullptr — нет доступа или endpoint недоступен.
+std::string render_dashboard_page(const LinkList& courses, std::string_view notifications, const LinkList* users);
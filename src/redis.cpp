@@ -1,21 +1,47 @@
 #include "redis.hpp"
+#include "metrics.hpp"
+#include "resp.hpp"
+#include "trace.hpp"
 
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sys/socket.h>
+#include <sys/time.h>
 #include <unistd.h>
 
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
 #include <cstring>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
-RedisClient::RedisClient() : host_("redis"), port_(6379) {}
-
 namespace {
 
-// Connect to host:port, return fd
-int connect_tcp(const std::string& host, int port) {
+using Clock = std::chrono::steady_clock;
+
+// Соединение, простоявшее в пуле дольше этого, перед выдачей проверяется PING-ом.
+constexpr auto kHealthCheckIdle = std::chrono::seconds(5);
+// Сколько ждать свободного соединения, если все заняты.
+constexpr auto kAcquireTimeout = std::chrono::seconds(2);
+// Таймаут send/recv, чтобы зависший Redis не держал worker-поток вечно.
+constexpr int kIoTimeoutMs = 2000;
+
+// Результат getaddrinfo, скопированный, чтобы не резолвить адрес на каждое соединение.
+struct Endpoint {
+    sockaddr_storage addr {};
+    socklen_t addrlen = 0;
+    int family = 0;
+    int socktype = 0;
+    int protocol = 0;
+};
+
+std::vector<Endpoint> resolve(const std::string& host, int port) {
     struct addrinfo hints {};
     hints.ai_family = AF_UNSPEC;
     hints.ai_socktype = SOCK_STREAM;
@@ -28,191 +54,502 @@ int connect_tcp(const std::string& host, int port) {
         throw std::runtime_error("getaddrinfo failed for " + host + ":" + port_str + " : " + gai_strerror(rc));
     }
 
-    int fd = -1;
+    std::vector<Endpoint> out;
     for (auto p = res; p != nullptr; p = p->ai_next) {
-        fd = ::socket(p->ai_family, p->ai_socktype, p->ai_protocol);
+        Endpoint ep;
+        std::memcpy(&ep.addr, p->ai_addr, p->ai_addrlen);
+        ep.addrlen = p->ai_addrlen;
+        ep.family = p->ai_family;
+        ep.socktype = p->ai_socktype;
+        ep.protocol = p->ai_protocol;
+        out.push_back(ep);
+    }
+
+    freeaddrinfo(res);
+    return out;
+}
+
+void set_socket_options(int fd) {
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    ::setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+
+    struct timeval tv {};
+    tv.tv_sec = kIoTimeoutMs / 1000;
+    tv.tv_usec = (kIoTimeoutMs % 1000) * 1000;
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+// Connect to the first reachable endpoint, return fd or -1
+int connect_any(const std::vector<Endpoint>& endpoints) {
+    for (const auto& ep : endpoints) {
+        int fd = ::socket(ep.family, ep.socktype, ep.protocol);
         if (fd < 0) continue;
 
-        if (::connect(fd, p->ai_addr, p->ai_addrlen) == 0) {
-            freeaddrinfo(res);
+        if (::connect(fd, reinterpret_cast<const sockaddr*>(&ep.addr), ep.addrlen) == 0) {
+            set_socket_options(fd);
             return fd;
         }
         ::close(fd);
-        fd = -1;
     }
-
-    freeaddrinfo(res);
-    throw std::runtime_error("connect failed to " + host + ":" + port_str);
+    return -1;
 }
 
 void send_all(int fd, const std::string& data) {
     const char* p = data.data();
     size_t left = data.size();
     while (left > 0) {
-        ssize_t n = ::send(fd, p, left, 0);
+        ssize_t n = ::send(fd, p, left, MSG_NOSIGNAL);
         if (n <= 0) throw std::runtime_error("send failed");
         p += n;
         left -= static_cast<size_t>(n);
     }
 }
 
-// read exactly N bytes
-std::string recv_n(int fd, size_t n) {
-    std::string out;
-    out.resize(n);
-    size_t got = 0;
-    while (got < n) {
-        ssize_t r = ::recv(fd, &out[got], n - got, 0);
-        if (r <= 0) throw std::runtime_error("recv failed");
-        got += static_cast<size_t>(r);
+struct ConnectionClosed : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+[[noreturn]] void throw_redis_error(const RedisReply& rep) {
+    throw std::runtime_error("Redis error: " + rep.str);
+}
+
+const std::string kMulti = resp_command({"MULTI"});
+const std::string kExec = resp_command({"EXEC"});
+
+} // namespace
+
+RedisReply make_reply(const RespValue& v) {
+    RedisReply out;
+    switch (v.type) {
+        case RespValue::Type::SimpleString:
+            out.type = RedisReply::Type::Status;
+            out.str = std::string(v.str);
+            break;
+        case RespValue::Type::Error:
+            out.type = RedisReply::Type::Error;
+            out.str = std::string(v.str);
+            break;
+        case RespValue::Type::Integer:
+        case RespValue::Type::Boolean:
+            out.type = RedisReply::Type::Integer;
+            out.integer = v.integer;
+            break;
+        case RespValue::Type::BulkString:
+        case RespValue::Type::BigNumber:
+            out.type = RedisReply::Type::String;
+            out.str = std::string(v.str);
+            break;
+        case RespValue::Type::Double:
+            out.type = RedisReply::Type::String;
+            out.str = std::to_string(v.number);
+            break;
+        case RespValue::Type::Null:
+            out.type = RedisReply::Type::Null;
+            break;
+        case RespValue::Type::Array:
+        case RespValue::Type::Map:
+        case RespValue::Type::Set:
+        case RespValue::Type::Push:
+            out.type = RedisReply::Type::Array;
+            out.elements.reserve(v.elements.size());
+            for (const auto& e : v.elements) out.elements.push_back(make_reply(e));
+            break;
     }
     return out;
 }
 
-// read until \r\n (returns line without CRLF)
-std::string recv_line(int fd) {
-    std::string line;
-    char c;
-    bool last_cr = false;
-    while (true) {
-        ssize_t r = ::recv(fd, &c, 1, 0);
-        if (r <= 0) throw std::runtime_error("recv failed");
-        if (last_cr) {
-            if (c == '\n') {
-                // drop the \r
-                if (!line.empty() && line.back() == '\r') line.pop_back();
-                return line;
-            }
-            last_cr = false;
+std::vector<RedisReply> exec_replies(std::vector<RedisReply> replies) {
+    if (replies.size() < 2) throw std::runtime_error("Redis transaction: missing replies");
+
+    // MULTI -> +OK, каждая команда -> +QUEUED (или ошибка), EXEC -> массив ответов.
+    if (replies.front().is_error()) throw_redis_error(replies.front());
+
+    auto& exec_reply = replies.back();
+    if (exec_reply.is_error()) {
+        // EXECABORT: покажем причину — первую ошибку постановки в очередь.
+        for (size_t i = 1; i + 1 < replies.size(); ++i) {
+            if (replies[i].is_error()) throw_redis_error(replies[i]);
         }
-        line.push_back(c);
-        if (c == '\r') last_cr = true;
+        throw_redis_error(exec_reply);
     }
+    if (exec_reply.type != RedisReply::Type::Array) {
+        throw std::runtime_error("Redis transaction aborted");
+    }
+    return std::move(exec_reply.elements);
 }
 
-// Build RESP array: ["CMD", arg1, arg2, ...]
-std::string resp_array(const std::vector<std::string>& parts) {
-    std::string out = "*" + std::to_string(parts.size()) + "\r\n";
-    for (const auto& s : parts) {
-        out += "$" + std::to_string(s.size()) + "\r\n";
-        out += s;
-        out += "\r\n";
+// Пул долгоживущих соединений, общий для всех worker-потоков.
+// Свободные соединения выдаются LIFO, чтобы чаще использовались "тёплые".
+class RedisClient::Pool {
+public:
+    Pool(std::string host, int port, size_t max_size)
+        : host_(std::move(host)), port_(port), max_size_(max_size ? max_size : 1) {}
+
+    ~Pool() {
+        for (auto& conn : idle_) ::close(conn.fd);
     }
-    return out;
-}
 
-// Parse minimal RESP replies:
-//
-// +OK\r\n                     -> status "OK"
-// -ERR ...\r\n                -> throw
-// :123\r\n                    -> integer 123
-// $-1\r\n                     -> null bulk
-// $<len>\r\n<bytes>\r\n        -> bulk string
-//
-struct RespReply {
-    enum class Type { Status, Error, Integer, Bulk, NullBulk } type;
-    std::string str;
-    long long integer = 0;
-};
+    // Отправить готовый буфер команд и прочитать replies ответов, отдавая
+    // каждый в on_reply, пока соединение ещё за нами (строки в RespValue
+    // указывают в его буфер). on_reply не должен бросать.
+    // Если переиспользованное соединение оказалось мёртвым (Redis перезапущен,
+    // idle timeout) — send не прошёл или на первое чтение пришёл EOF/RST, —
+    // запрос повторяется один раз на свежем соединении. После таймаута чтения
+    // не повторяем: команда могла уже выполниться.
+    template <typename F>
+    void execute(const std::string& request, size_t replies, F&& on_reply) {
+        for (int attempt = 0;; ++attempt) {
+            bool reused = false;
+            Connection conn = acquire(reused);
+            const bool may_retry = reused && attempt == 0;
 
-RespReply read_reply(int fd) {
-    std::string first = recv_n(fd, 1);
-    char t = first[0];
+            try {
+                send_all(conn.fd, request);
+            } catch (...) {
+                discard(conn);
+                if (may_retry) continue;
+                throw;
+            }
 
-    if (t == '+') {
-        auto line = recv_line(fd);
-        return {RespReply::Type::Status, line, 0};
-    }
-    if (t == '-') {
-        auto line = recv_line(fd);
-        return {RespReply::Type::Error, line, 0};
-    }
-    if (t == ':') {
-        auto line = recv_line(fd);
-        return {RespReply::Type::Integer, "", std::stoll(line)};
+            try {
+                for (size_t delivered = 0; delivered < replies; ++delivered) {
+                    on_reply(delivered == 0 ? read_first(conn) : conn.reader.read(conn.fd));
+                }
+            } catch (const ConnectionClosed&) {
+                discard(conn);
+                if (may_retry) continue;
+                throw;
+            } catch (...) {
+                discard(conn);
+                throw;
+            }
+
+            // В буфере не должно остаться лишних байт, иначе поток рассинхронизирован.
+            if (conn.reader.has_pending()) {
+                discard(conn);
+                throw std::runtime_error("Redis: unexpected data after reply");
+            }
+            release(std::move(conn));
+            return;
+        }
     }
-    if (t == '$') {
-        auto line = recv_line(fd);
-        long long len = std::stoll(line);
-        if (len == -1) {
-            return {RespReply::Type::NullBulk, "", 0};
+
+private:
+    struct Connection {
+        int fd = -1;
+        Clock::time_point last_used;
+        RespReader reader;
+    };
+
+    // Первый ответ: EOF или RST до единого байта значит, что соединение
+    // умерло, пока лежало в пуле, — отличаем это от таймаута и мусора.
+    static RespValue read_first(Connection& conn) {
+        RespValue out;
+        while (!conn.reader.next(out)) {
+            const ssize_t n = conn.reader.fill(conn.fd);
+            if (n > 0) continue;
+            if ((n == 0 || errno == ECONNRESET) && !conn.reader.has_pending()) {
+                throw ConnectionClosed("recv failed: connection closed");
+            }
+            throw std::runtime_error("recv failed");
         }
-        auto data = recv_n(fd, static_cast<size_t>(len));
-        // trailing CRLF
-        (void)recv_n(fd, 2);
-        return {RespReply::Type::Bulk, data, 0};
+        return out;
     }
 
-    throw std::runtime_error("unknown RESP reply type");
-}
+    Connection acquire(bool& reused) {
+        std::unique_lock<std::mutex> lock(mu_);
+        while (true) {
+            if (!idle_.empty()) {
+                Connection conn = std::move(idle_.back());
+                idle_.pop_back();
+                lock.unlock();
 
-} // namespace
+                if (Clock::now() - conn.last_used < kHealthCheckIdle || ping(conn)) {
+                    reused = true;
+                    return conn;
+                }
+                discard(conn);
+                lock.lock();
+                continue;
+            }
 
-std::optional<std::string> RedisClient::get(const std::string& key) {
-    int fd = connect_tcp(host_, port_);
-    try {
-        auto req = resp_array({"GET", key});
-        send_all(fd, req);
+            if (open_ < max_size_) {
+                ++open_;
+                lock.unlock();
 
-        auto rep = read_reply(fd);
-        ::close(fd);
+                Connection conn;
+                try {
+                    conn.fd = open_connection();
+                } catch (...) {
+                    lock.lock();
+                    --open_;
+                    cv_.notify_one();
+                    throw;
+                }
+                reused = false;
+                return conn;
+            }
+
+            bool ready = cv_.wait_for(lock, kAcquireTimeout, [this] {
+                return !idle_.empty() || open_ < max_size_;
+            });
+            if (!ready) {
+                throw std::runtime_error("Redis pool exhausted: " + host_ + ":" + std::to_string(port_));
+            }
+        }
+    }
 
-        if (rep.type == RespReply::Type::Error) {
-            throw std::runtime_error("Redis error: " + rep.str);
+    void release(Connection conn) {
+        conn.last_used = Clock::now();
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            idle_.push_back(std::move(conn));
         }
-        if (rep.type == RespReply::Type::NullBulk) {
-            return std::nullopt;
+        cv_.notify_one();
+    }
+
+    void discard(const Connection& conn) {
+        ::close(conn.fd);
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            --open_;
         }
-        if (rep.type != RespReply::Type::Bulk) {
-            throw std::runtime_error("Unexpected reply type for GET");
+        cv_.notify_one();
+    }
+
+    int open_connection() {
+        std::vector<Endpoint> endpoints;
+        {
+            std::lock_guard<std::mutex> lock(resolve_mu_);
+            if (endpoints_.empty()) endpoints_ = resolve(host_, port_);
+            endpoints = endpoints_;
         }
-        return rep.str;
 
+        int fd = connect_any(endpoints);
+        if (fd >= 0) return fd;
+
+        // Адрес мог смениться (например, контейнер redis пересоздан) — резолвим заново.
+        {
+            std::lock_guard<std::mutex> lock(resolve_mu_);
+            endpoints_ = resolve(host_, port_);
+            endpoints = endpoints_;
+        }
+        fd = connect_any(endpoints);
+        if (fd >= 0) return fd;
+
+        throw std::runtime_error("connect failed to " + host_ + ":" + std::to_string(port_));
+    }
+
+    static bool ping(Connection& conn) {
+        try {
+            send_all(conn.fd, resp_command({"PING"}));
+            auto rep = conn.reader.read(conn.fd);
+            return rep.type == RespValue::Type::SimpleString && rep.str == "PONG" && !conn.reader.has_pending();
+        } catch (...) {
+            return false;
+        }
+    }
+
+    std::string host_;
+    int port_;
+    size_t max_size_;
+
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::vector<Connection> idle_;
+    size_t open_ = 0;
+
+    std::mutex resolve_mu_;
+    std::vector<Endpoint> endpoints_;
+};
+
+void record_redis_command(std::string_view name, std::chrono::steady_clock::time_point started, bool failed) {
+    static const metrics::HistogramFamily latency(
+        "web_client_redis_command_duration_seconds", "Redis command time including queueing, by command", "command");
+    static const metrics::CounterFamily errors(
+        "web_client_redis_command_errors_total", "Redis commands failed with I/O error or error reply, by command", "command");
+
+    latency.with(name).observe_since(started);
+    if (failed) errors.with(name).inc();
+}
+
+RedisClient::RedisClient(std::string host, int port, size_t pool_size)
+    : host_(std::move(host)),
+      port_(port),
+      pool_(std::make_unique<Pool>(host_, port_, pool_size)) {}
+
+RedisClient::~RedisClient() = default;
+
+std::vector<RedisReply> RedisClient::execute(const std::string& request, size_t replies, std::string_view name) {
+    std::vector<RedisReply> out;
+    out.reserve(replies);
+    trace::Span span("redis", name);
+    const auto started = std::chrono::steady_clock::now();
+    try {
+        pool_->execute(request, replies, [&out](const RespValue& rep) {
+            out.push_back(make_reply(rep));
+        });
     } catch (...) {
-        ::close(fd);
+        record_redis_command(name, started, true);
         throw;
     }
+    record_redis_command(name, started, false);
+    return out;
 }
 
-void RedisClient::set(const std::string& key, const std::string& value) {
-    int fd = connect_tcp(host_, port_);
+RedisReply RedisClient::command(const std::vector<std::string>& parts) {
+    const std::string_view name = parts.empty() ? std::string_view() : std::string_view(parts.front());
+    RedisReply out;
+    trace::Span span("redis", name);
+    const auto started = std::chrono::steady_clock::now();
     try {
-        auto req = resp_array({"SET", key, value});
-        send_all(fd, req);
-
-        auto rep = read_reply(fd);
-        ::close(fd);
-
-        if (rep.type == RespReply::Type::Error) {
-            throw std::runtime_error("Redis error: " + rep.str);
-        }
-        if (rep.type != RespReply::Type::Status || rep.str != "OK") {
-            throw std::runtime_error("Unexpected reply for SET");
-        }
+        pool_->execute(resp_command(parts), 1, [&out](const RespValue& rep) {
+            out = make_reply(rep);
+        });
     } catch (...) {
-        ::close(fd);
+        record_redis_command(name, started, true);
         throw;
     }
+    record_redis_command(name, started, out.is_error());
+    return out;
+}
+
+std::optional<std::string> RedisClient::get(const std::string& key) {
+    auto rep = command({"GET", key});
+
+    if (rep.is_error()) throw_redis_error(rep);
+    if (rep.is_null()) return std::nullopt;
+    if (rep.type != RedisReply::Type::String) {
+        throw std::runtime_error("Unexpected reply type for GET");
+    }
+    return std::move(rep.str);
+}
+
+void RedisClient::set(const std::string& key, const std::string& value) {
+    set(key, value, std::chrono::seconds(0));
+}
+
+void RedisClient::set(const std::string& key, const std::string& value, std::chrono::seconds ttl) {
+    auto rep = ttl.count() > 0
+        ? command({"SET", key, value, "EX", std::to_string(ttl.count())})
+        : command({"SET", key, value});
+
+    if (rep.is_error()) throw_redis_error(rep);
+    if (!rep.is_ok()) {
+        throw std::runtime_error("Unexpected reply for SET");
+    }
 }
 
 void RedisClient::del(const std::string& key) {
-    int fd = connect_tcp(host_, port_);
-    try {
-        auto req = resp_array({"DEL", key});
-        send_all(fd, req);
+    auto rep = command({"DEL", key});
 
-        auto rep = read_reply(fd);
-        ::close(fd);
+    if (rep.is_error()) throw_redis_error(rep);
+    // DEL returns integer, but we don't care
+    if (rep.type != RedisReply::Type::Integer) {
+        throw std::runtime_error("Unexpected reply type for DEL");
+    }
+}
 
-        if (rep.type == RespReply::Type::Error) {
-            throw std::runtime_error("Redis error: " + rep.str);
-        }
-        // DEL returns integer, but we don't care
-        if (rep.type != RespReply::Type::Integer) {
-            throw std::runtime_error("Unexpected reply type for DEL");
+std::vector<std::optional<std::string>> RedisClient::mget(const std::vector<std::string>& keys) {
+    std::vector<std::optional<std::string>> out;
+    if (keys.empty()) return out;
+
+    std::vector<std::string> parts;
+    parts.reserve(keys.size() + 1);
+    parts.push_back("MGET");
+    parts.insert(parts.end(), keys.begin(), keys.end());
+
+    auto rep = command(parts);
+    if (rep.is_error()) throw_redis_error(rep);
+    if (rep.type != RedisReply::Type::Array || rep.elements.size() != keys.size()) {
+        throw std::runtime_error("Unexpected reply for MGET");
+    }
+
+    out.reserve(keys.size());
+    for (auto& e : rep.elements) {
+        if (e.type == RedisReply::Type::String) {
+            out.emplace_back(std::move(e.str));
+        } else {
+            out.emplace_back(std::nullopt);
         }
-    } catch (...) {
-        ::close(fd);
-        throw;
     }
+    return out;
+}
+
+void RedisClient::mset(const std::vector<std::pair<std::string, std::string>>& items) {
+    if (items.empty()) return;
+
+    std::vector<std::string> parts;
+    parts.reserve(items.size() * 2 + 1);
+    parts.push_back("MSET");
+    for (const auto& [key, value] : items) {
+        parts.push_back(key);
+        parts.push_back(value);
+    }
+
+    auto rep = command(parts);
+    if (rep.is_error()) throw_redis_error(rep);
+    if (!rep.is_ok()) {
+        throw std::runtime_error("Unexpected reply for MSET");
+    }
+}
+
+RedisPipeline RedisClient::pipeline() {
+    return RedisPipeline(*this, false);
+}
+
+RedisPipeline RedisClient::transaction() {
+    return RedisPipeline(*this, true);
+}
+
+// --- RedisPipeline ---
+
+RedisPipeline::RedisPipeline(RedisClient& client, bool transaction)
+    : client_(client), transaction_(transaction) {}
+
+RedisPipeline& RedisPipeline::command(const std::vector<std::string>& parts) {
+    resp_append_command(buffer_, parts);
+    ++count_;
+    return *this;
+}
+
+RedisPipeline& RedisPipeline::get(const std::string& key) {
+    return command({"GET", key});
+}
+
+RedisPipeline& RedisPipeline::set(const std::string& key, const std::string& value) {
+    return command({"SET", key, value});
+}
+
+RedisPipeline& RedisPipeline::set(const std::string& key, const std::string& value, std::chrono::seconds ttl) {
+    if (ttl.count() <= 0) return set(key, value);
+    return command({"SET", key, value, "EX", std::to_string(ttl.count())});
+}
+
+RedisPipeline& RedisPipeline::del(const std::string& key) {
+    return command({"DEL", key});
+}
+
+std::vector<RedisReply> RedisPipeline::exec() {
+    if (count_ == 0) return {};
+
+    std::string request;
+    size_t replies = count_;
+    if (transaction_) {
+        request.reserve(kMulti.size() + buffer_.size() + kExec.size());
+        request += kMulti;
+        request += buffer_;
+        request += kExec;
+        replies += 2;
+    } else {
+        request.swap(buffer_);
+    }
+    buffer_.clear();
+    count_ = 0;
+
+    auto replies_out = client_.execute(request, replies, transaction_ ? "MULTI" : "PIPELINE");
+    if (!transaction_) return replies_out;
+    return exec_replies(std::move(replies_out));
 }
@@ -1,16 +1,104 @@
 #pragma once
+#include <chrono>
+#include <cstddef>
+#include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+class RedisClient;
+struct RespValue;
+
+// Ответ Redis, владеющий своими данными.
+struct RedisReply {
+    enum class Type { Status, Error, Integer, String, Null, Array };
+
+    Type type = Type::Null;
+    std::string str;          // Status, Error, String
+    long long integer = 0;    // Integer
+    std::vector<RedisReply> elements; // Array
+
+    bool is_error() const { return type == Type::Error; }
+    bool is_null() const { return type == Type::Null; }
+    bool is_ok() const { return type == Type::Status && str == "OK"; }
+};
+
+// Скопировать разобранный ответ из буфера RespReader.
+RedisReply make_reply(const RespValue& v);
+
+// Метрики команды (для RedisClient и AsyncRedisClient): name — первое
+// слово команды, failed — обрыв или ответ-ошибка.
+void record_redis_command(std::string_view name, std::chrono::steady_clock::time_point started, bool failed);
+
+// Ответы MULTI, команд и EXEC одной транзакции -> ответы команд (массив
+// EXEC). Отказ MULTI, EXECABORT или отмена транзакции — исключение.
+std::vector<RedisReply> exec_replies(std::vector<RedisReply> replies);
+
+// Пачка команд, которая уходит в Redis одной записью и читается одним
+// проходом по тому же соединению. Полученный из RedisClient::transaction()
+// pipeline оборачивается в MULTI/EXEC.
+class RedisPipeline {
+public:
+    RedisPipeline& command(const std::vector<std::string>& parts);
+    RedisPipeline& get(const std::string& key);
+    RedisPipeline& set(const std::string& key, const std::string& value);
+    RedisPipeline& set(const std::string& key, const std::string& value, std::chrono::seconds ttl);
+    RedisPipeline& del(const std::string& key);
+
+    size_t size() const { return count_; }
+
+    // Ответы в порядке добавления команд; ошибка отдельной команды приходит
+    // как RedisReply::Type::Error. Если транзакция отклонена (EXECABORT) —
+    // исключение. После exec() pipeline пуст и может использоваться снова.
+    std::vector<RedisReply> exec();
+
+private:
+    friend class RedisClient;
+    RedisPipeline(RedisClient& client, bool transaction);
+
+    RedisClient& client_;
+    bool transaction_;
+    std::string buffer_;
+    size_t count_ = 0;
+};
 
 class RedisClient {
 public:
-    RedisClient();
+    // pool_size — максимум одновременно открытых соединений (общий на все
+    // worker-потоки Crow).
+    explicit RedisClient(std::string host = "redis", int port = 6379, size_t pool_size = 8);
+    ~RedisClient();
+
+    RedisClient(const RedisClient&) = delete;
+    RedisClient& operator=(const RedisClient&) = delete;
 
     std::optional<std::string> get(const std::string& key);
     void set(const std::string& key, const std::string& value);
     void del(const std::string& key);
 
+    // SET ... EX ttl; ttl <= 0 — без срока жизни, как обычный set.
+    void set(const std::string& key, const std::string& value, std::chrono::seconds ttl);
+
+    // Пакетные варианты — один round trip на все ключи.
+    std::vector<std::optional<std::string>> mget(const std::vector<std::string>& keys);
+    void mset(const std::vector<std::pair<std::string, std::string>>& items);
+
+    // Произвольная команда, ответ как есть (ошибка Redis не бросается).
+    RedisReply command(const std::vector<std::string>& parts);
+
+    RedisPipeline pipeline();
+    RedisPipeline transaction();
+
 private:
+    friend class RedisPipeline;
+    class Pool;
+
+    // name — метка для метрик (PIPELINE или MULTI).
+    std::vector<RedisReply> execute(const std::string& request, size_t replies, std::string_view name);
+
     std::string host_;
     int port_;
+    std::unique_ptr<Pool> pool_;
 };
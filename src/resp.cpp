@@ -0,0 +1,293 @@
+#include "resp.hpp"
+
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+constexpr size_t kIncomplete = std::string::npos;
+// Минимальный размер одного recv.
+constexpr size_t kReadChunk = 16 * 1024;
+// Ограничения из самого Redis (proto-max-bulk-len) + защита от мусора в потоке.
+constexpr long long kMaxBulkLen = 512LL * 1024 * 1024;
+constexpr long long kMaxElements = 1LL << 32;
+constexpr int kMaxDepth = 64;
+
+long long parse_int(std::string_view s) {
+    if (s.empty()) throw std::runtime_error("RESP: empty integer");
+
+    size_t i = 0;
+    bool neg = false;
+    if (s[0] == '-' || s[0] == '+') {
+        neg = s[0] == '-';
+        i = 1;
+        if (s.size() == 1) throw std::runtime_error("RESP: bad integer");
+    }
+
+    // Копим в unsigned и проверяем предел до умножения: длина вида
+    // $99999999999999999999 не должна обернуться в допустимую.
+    const unsigned long long limit =
+        static_cast<unsigned long long>(std::numeric_limits<long long>::max()) + (neg ? 1 : 0);
+    unsigned long long v = 0;
+    for (; i < s.size(); ++i) {
+        char c = s[i];
+        if (c < '0' || c > '9') throw std::runtime_error("RESP: bad integer");
+        const unsigned digit = static_cast<unsigned>(c - '0');
+        if (v > (limit - digit) / 10) throw std::runtime_error("RESP: integer out of range");
+        v = v * 10 + digit;
+    }
+    if (!neg) return static_cast<long long>(v);
+    return v == limit ? std::numeric_limits<long long>::min() : -static_cast<long long>(v);
+}
+
+void append_bulk(std::string& out, std::string_view s) {
+    out += '$';
+    out += std::to_string(s.size());
+    out += "\r\n";
+    out.append(s.data(), s.size());
+    out += "\r\n";
+}
+
+} // namespace
+
+void resp_append_command(std::string& out, const std::vector<std::string>& parts) {
+    out += '*';
+    out += std::to_string(parts.size());
+    out += "\r\n";
+    for (const auto& s : parts) {
+        append_bulk(out, s);
+    }
+}
+
+std::string resp_command(const std::vector<std::string>& parts) {
+    std::string out;
+    size_t size = 16;
+    for (const auto& s : parts) size += s.size() + 16;
+    out.reserve(size);
+    resp_append_command(out, parts);
+    return out;
+}
+
+size_t RespReader::find_crlf(size_t pos) const {
+    while (pos < end_) {
+        const void* p = std::memchr(buf_.data() + pos, '\r', end_ - pos);
+        if (!p) return kIncomplete;
+
+        size_t cr = static_cast<const char*>(p) - buf_.data();
+        if (cr + 1 >= end_) return kIncomplete;
+        if (buf_[cr + 1] == '\n') return cr;
+        pos = cr + 1;
+    }
+    return kIncomplete;
+}
+
+// Разобрать значение, начинающееся с pos. Возвращает позицию сразу за ним
+// или kIncomplete, если значение ещё не дочитано.
+size_t RespReader::parse_value(size_t pos, RespValue& out, int depth) {
+    if (depth > kMaxDepth) throw std::runtime_error("RESP: nesting too deep");
+    if (pos >= end_) {
+        need_ = pos + 1;
+        return kIncomplete;
+    }
+
+    size_t cr = find_crlf(pos + 1);
+    if (cr == kIncomplete) {
+        need_ = end_ + 1;
+        return kIncomplete;
+    }
+
+    const char t = buf_[pos];
+    const std::string_view line(buf_.data() + pos + 1, cr - pos - 1);
+    const size_t after = cr + 2;
+
+    out.elements.clear();
+    out.str = {};
+    out.integer = 0;
+    out.number = 0;
+
+    switch (t) {
+        case '+':
+            out.type = RespValue::Type::SimpleString;
+            out.str = line;
+            return after;
+
+        case '-':
+            out.type = RespValue::Type::Error;
+            out.str = line;
+            return after;
+
+        case ':':
+            out.type = RespValue::Type::Integer;
+            out.integer = parse_int(line);
+            return after;
+
+        case '_':
+            out.type = RespValue::Type::Null;
+            return after;
+
+        case '#':
+            if (line != "t" && line != "f") throw std::runtime_error("RESP: bad boolean");
+            out.type = RespValue::Type::Boolean;
+            out.integer = line == "t" ? 1 : 0;
+            return after;
+
+        case ',': {
+            out.type = RespValue::Type::Double;
+            std::string tmp(line);
+            char* endp = nullptr;
+            out.number = std::strtod(tmp.c_str(), &endp);
+            if (endp != tmp.c_str() + tmp.size()) throw std::runtime_error("RESP: bad double");
+            return after;
+        }
+
+        case '(':
+            out.type = RespValue::Type::BigNumber;
+            out.str = line;
+            return after;
+
+        case '$':
+        case '!':
+        case '=': {
+            long long len = parse_int(line);
+            if (len == -1 && t == '$') {
+                out.type = RespValue::Type::Null;
+                return after;
+            }
+            if (len < 0 || len > kMaxBulkLen) throw std::runtime_error("RESP: bad bulk length");
+
+            size_t data_end = after + static_cast<size_t>(len);
+            if (data_end + 2 > end_) {
+                need_ = data_end + 2;
+                return kIncomplete;
+            }
+            if (buf_[data_end] != '\r' || buf_[data_end + 1] != '\n') {
+                throw std::runtime_error("RESP: bulk string not terminated");
+            }
+
+            std::string_view data(buf_.data() + after, static_cast<size_t>(len));
+            if (t == '=') {
+                // verbatim string: "txt:..." / "mkd:..."
+                if (data.size() < 4 || data[3] != ':') throw std::runtime_error("RESP: bad verbatim string");
+                data.remove_prefix(4);
+            }
+            out.type = t == '!' ? RespValue::Type::Error : RespValue::Type::BulkString;
+            out.str = data;
+            return data_end + 2;
+        }
+
+        case '*':
+        case '%':
+        case '~':
+        case '>':
+        case '|': {
+            long long n = parse_int(line);
+            if (n == -1 && t == '*') {
+                out.type = RespValue::Type::Null;
+                return after;
+            }
+            if (n < 0 || n > kMaxElements) throw std::runtime_error("RESP: bad aggregate length");
+
+            size_t count = static_cast<size_t>(n);
+            if (t == '%' || t == '|') count *= 2;
+
+            // Не резервируем больше, чем в принципе может поместиться в прочитанном.
+            out.elements.reserve(std::min(count, (end_ - after) / 3 + 1));
+
+            size_t p = after;
+            for (size_t i = 0; i < count; ++i) {
+                out.elements.emplace_back();
+                p = parse_value(p, out.elements.back(), depth + 1);
+                if (p == kIncomplete) return kIncomplete;
+            }
+
+            if (t == '|') {
+                // Атрибуты — метаданные к следующему значению, нам не нужны.
+                return parse_value(p, out, depth);
+            }
+
+            switch (t) {
+                case '%': out.type = RespValue::Type::Map; break;
+                case '~': out.type = RespValue::Type::Set; break;
+                case '>': out.type = RespValue::Type::Push; break;
+                default:  out.type = RespValue::Type::Array; break;
+            }
+            return p;
+        }
+    }
+
+    throw std::runtime_error(std::string("unknown RESP reply type: ") + t);
+}
+
+bool RespReader::next(RespValue& out) {
+    if (start_ >= end_ || end_ < need_) return false;
+
+    size_t p = parse_value(start_, out, 0);
+    if (p == kIncomplete) return false;
+
+    start_ = p;
+    need_ = 0;
+    if (start_ == end_) {
+        start_ = end_ = 0;
+    }
+    return true;
+}
+
+void RespReader::reserve_tail(size_t n) {
+    if (start_ == end_) {
+        start_ = end_ = 0;
+    }
+    if (buf_.size() - end_ >= n) return;
+
+    // Сначала сдвигаем недоразобранный хвост в начало, потом растём.
+    if (start_ > 0) {
+        std::memmove(&buf_[0], buf_.data() + start_, end_ - start_);
+        end_ -= start_;
+        need_ = need_ > start_ ? need_ - start_ : 0;
+        start_ = 0;
+    }
+    if (buf_.size() - end_ < n) {
+        buf_.resize(std::max(end_ + n, std::max(need_, buf_.size() * 2)));
+    }
+}
+
+char* RespReader::prepare(size_t n) {
+    reserve_tail(std::max(n, need_ > end_ ? need_ - end_ : size_t{0}));
+    return &buf_[end_];
+}
+
+void RespReader::commit(size_t n) {
+    end_ += n;
+}
+
+void RespReader::feed(const char* data, size_t n) {
+    std::memcpy(prepare(n), data, n);
+    commit(n);
+}
+
+ssize_t RespReader::fill(int fd) {
+    char* p = prepare(kReadChunk);
+    const size_t room = buf_.size() - end_;
+
+    ssize_t r;
+    do {
+        r = ::recv(fd, p, room, 0);
+    } while (r < 0 && errno == EINTR);
+
+    if (r > 0) commit(static_cast<size_t>(r));
+    return r;
+}
+
+RespValue RespReader::read(int fd) {
+    RespValue out;
+    while (!next(out)) {
+        if (fill(fd) <= 0) throw std::runtime_error("recv failed");
+    }
+    return out;
+}
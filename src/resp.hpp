@@ -0,0 +1,82 @@
+#pragma once
+#include <sys/types.h>
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Разобранный ответ Redis (RESP2 и RESP3).
+//
+// str указывает прямо в буфер RespReader, без копирования, и остаётся
+// валидным только до следующего fill()/feed()/prepare() этого reader-а.
+struct RespValue {
+    enum class Type {
+        SimpleString, // +OK
+        Error,        // -ERR ... и !<len> (blob error)
+        Integer,      // :123
+        BulkString,   // $<len> и =<len> (verbatim, без префикса формата)
+        Null,         // $-1, *-1, _
+        Array,        // *<n>
+        Map,          // %<n>, elements = k1, v1, k2, v2, ...
+        Set,          // ~<n>
+        Push,         // ><n> — внеполосные сообщения RESP3 (invalidate, pubsub)
+        Double,       // ,3.14
+        Boolean,      // #t / #f, значение в integer
+        BigNumber,    // (<digits>, текст в str
+    };
+
+    Type type = Type::Null;
+    std::string_view str;
+    long long integer = 0;
+    double number = 0;
+    std::vector<RespValue> elements;
+
+    bool is_error() const { return type == Type::Error; }
+    bool is_null() const { return type == Type::Null; }
+};
+
+// Build RESP array: ["CMD", arg1, arg2, ...]
+std::string resp_command(const std::vector<std::string>& parts);
+void resp_append_command(std::string& out, const std::vector<std::string>& parts);
+
+// Буферизованный инкрементальный парсер RESP.
+//
+// Байты поступают либо через fill(fd) (один recv на блок, работает и с
+// блокирующими, и с неблокирующими сокетами), либо через feed()/prepare()+commit(),
+// если чтением управляет кто-то другой (например, asio). next() разбирает
+// следующий полный ответ, если он уже целиком в буфере.
+class RespReader {
+public:
+    RespReader() = default;
+
+    // Разобрать следующий ответ. false — данных пока не хватает (в буфере
+    // ничего не потреблено). Некорректный протокол — std::runtime_error.
+    bool next(RespValue& out);
+
+    // Один recv() в свободный хвост буфера. Возвращает результат recv как есть:
+    // >0 — прочитано, 0 — EOF, -1 — ошибка (errno; EAGAIN для неблокирующих).
+    ssize_t fill(int fd);
+
+    void feed(const char* data, size_t n);
+
+    // Свободное место под запись минимум n байт; после записи — commit(n).
+    char* prepare(size_t n);
+    void commit(size_t n);
+
+    // Блокирующее чтение одного ответа целиком.
+    RespValue read(int fd);
+
+    // Есть ли уже прочитанные, но ещё не разобранные байты.
+    bool has_pending() const { return start_ < end_; }
+
+private:
+    size_t parse_value(size_t pos, RespValue& out, int depth);
+    size_t find_crlf(size_t pos) const;
+    void reserve_tail(size_t n);
+
+    std::string buf_;
+    size_t start_ = 0; // начало неразобранных данных
+    size_t end_ = 0;   // конец прочитанных данных
+    size_t need_ = 0;  // меньше этого end_ — разбирать бессмысленно
+};
@@ -0,0 +1,144 @@
+#include "session.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <cstdint>
+#include <limits>
+
+namespace {
+
+constexpr char kBinaryMarker = '\0';
+constexpr uint8_t kVersion = 2;
+
+size_t varint_size(uint64_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+void put_varint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+void put_field(std::string& out, const std::string& field) {
+    put_varint(out, field.size());
+    out.append(field);
+}
+
+bool get_varint(std::string_view& in, uint64_t& value, int max_shift) {
+    value = 0;
+    for (int shift = 0;; shift += 7) {
+        if (in.empty() || shift > max_shift) return false;
+        auto byte = static_cast<uint8_t>(in.front());
+        in.remove_prefix(1);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+}
+
+bool get_field(std::string_view& in, std::string& field) {
+    uint64_t len = 0;
+    if (!get_varint(in, len, 28) || len > in.size()) return false;
+    field.assign(in.data(), len);
+    in.remove_prefix(len);
+    return true;
+}
+
+std::optional<SessionData> parse_binary(std::string_view in) {
+    // in[0] — маркер, in[1] — версия; любая версия >= 1 начинается с полей v1.
+    if (in.size() < 2 || static_cast<uint8_t>(in[1]) < 1) return std::nullopt;
+    const auto version = static_cast<uint8_t>(in[1]);
+    in.remove_prefix(2);
+
+    SessionData data;
+    if (!get_field(in, data.status) ||
+        !get_field(in, data.login_token) ||
+        !get_field(in, data.access_token) ||
+        !get_field(in, data.refresh_token) ||
+        data.status.empty()) {
+        return std::nullopt;
+    }
+
+    if (version >= 2) {
+        uint64_t exp = 0;
+        if (!get_varint(in, exp, 63)) return std::nullopt;
+        data.access_exp = static_cast<int64_t>(exp);
+    }
+    return data;
+}
+
+// Поля старой записи: нет или null — значение по умолчанию; другой тип —
+// запись битая (json.value() тут бросил бы type_error).
+bool json_string(const nlohmann::json& json, const char* key, std::string& out) {
+    auto it = json.find(key);
+    if (it == json.end() || it->is_null()) return true;
+    if (!it->is_string()) return false;
+    out = it->get<std::string>();
+    return true;
+}
+
+bool json_int64(const nlohmann::json& json, const char* key, int64_t& out) {
+    auto it = json.find(key);
+    if (it == json.end() || it->is_null()) return true;
+    if (it->is_number_unsigned()) {
+        if (it->get<uint64_t>() > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) return false;
+        out = static_cast<int64_t>(it->get<uint64_t>());
+        return true;
+    }
+    if (!it->is_number_integer()) return false;
+    out = it->get<int64_t>();
+    return true;
+}
+
+// Сессии, записанные до бинарного формата.
+std::optional<SessionData> parse_json(std::string_view value) {
+    nlohmann::json json = nlohmann::json::parse(value.begin(), value.end(), nullptr, false);
+    if (json.is_discarded() || !json.is_object()) return std::nullopt;
+
+    SessionData data;
+    if (!json_string(json, "status", data.status) ||
+        !json_string(json, "login_token", data.login_token) ||
+        !json_string(json, "access_token", data.access_token) ||
+        !json_string(json, "refresh_token", data.refresh_token) ||
+        !json_int64(json, "access_exp", data.access_exp) ||
+        data.status.empty()) {
+        return std::nullopt;
+    }
+    return data;
+}
+
+} // namespace
+
+std::optional<SessionData> parse_session(std::string_view value) {
+    if (value.empty()) return std::nullopt;
+    if (value.front() == kBinaryMarker) return parse_binary(value);
+    return parse_json(value);
+}
+
+std::string serialize_session(const SessionData& data) {
+    const auto exp = static_cast<uint64_t>(data.access_exp > 0 ? data.access_exp : 0);
+
+    std::string out;
+    out.reserve(2 +
+                varint_size(data.status.size()) + data.status.size() +
+                varint_size(data.login_token.size()) + data.login_token.size() +
+                varint_size(data.access_token.size()) + data.access_token.size() +
+                varint_size(data.refresh_token.size()) + data.refresh_token.size() +
+                varint_size(exp));
+
+    out.push_back(kBinaryMarker);
+    out.push_back(static_cast<char>(kVersion));
+    put_field(out, data.status);
+    put_field(out, data.login_token);
+    put_field(out, data.access_token);
+    put_field(out, data.refresh_token);
+    put_varint(out, exp);
+    return out;
+}
@@ -1,36 +1,27 @@
 #pragma once
 
-#include <nlohmann/json.hpp>
+#include <cstdint>
 #include <optional>
 #include <string>
+#include <string_view>
 
 struct SessionData {
     std::string status;
     std::string login_token;
     std::string access_token;
     std::string refresh_token;
+    // exp из JWT access token (unix-время, секунды); 0 — неизвестно.
+    int64_t access_exp = 0;
 };
 
-inline std::optional<SessionData> parse_session(const std::string& value) {
-    nlohmann::json json = nlohmann::json::parse(value, nullptr, false);
-    if (json.is_discarded() || !json.contains("status")) {
-        return std::nullopt;
-    }
-
-    SessionData data;
-    data.status = json.value("status", "");
-    data.login_token = json.value("login_token", "");
-    data.access_token = json.value("access_token", "");
-    data.refresh_token = json.value("refresh_token", "");
-    return data;
-}
-
-inline std::string serialize_session(const SessionData& data) {
-    nlohmann::json json = {
-        {"status", data.status},
-        {"login_token", data.login_token},
-        {"access_token", data.access_token},
-        {"refresh_token", data.refresh_token},
-    };
-    return json.dump();
-}
+// Значение сессии в Redis — компактная бинарная запись:
+//
+//   0x00 <версия> <len><status> <len><login_token> <len><access_token> <len><refresh_token>
+//   [v2+] <access_exp>
+//
+// len и access_exp — varint (LEB128). Нулевой первый байт отличает её от старого JSON
+// ({"status": ...}), который по-прежнему читается: такие сессии переходят
+// в новый формат при следующей записи. Новые версии только дописывают поля
+// в конец, поэтому старый код читает записи новых версий, пропуская хвост.
+std::optional<SessionData> parse_session(std::string_view value);
+std::string serialize_session(const SessionData& data);
@@ -0,0 +1,344 @@
+#include "session_refresh.hpp"
+#include "api/upstreams.hpp"
+#include "jwt.hpp"
+#include "metrics.hpp"
+#include "trace.hpp"
+#include "utils.hpp"
+
+#include <crow.h>
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+constexpr auto kLockTtl = std::chrono::milliseconds(10000);
+constexpr auto kPollInterval = std::chrono::milliseconds(100);
+// Сколько ждать чужой refresh, прежде чем сдаться (с запасом больше kLockTtl,
+// чтобы успеть перехватить блокировку упавшего инстанса).
+constexpr auto kWaitLimit = std::chrono::milliseconds(12000);
+// Весь полёт: ожидание чужого refresh плюс запрос в Auth и запись в Redis.
+constexpr auto kFlightLimit = std::chrono::milliseconds(20000);
+
+// Запас на расхождение часов с Auth и время самого запроса в Main.
+constexpr auto kExpirySkew = std::chrono::seconds(5);
+
+// Снимаем только свою блокировку: чужую (наша истекла) трогать нельзя.
+constexpr const char* kReleaseScript =
+    "if redis.call('get', KEYS[1]) == ARGV[1] then return redis.call('del', KEYS[1]) end return 0";
+
+std::string lock_key(const std::string& session_key) {
+    return "refresh-lock:" + session_key;
+}
+
+std::vector<std::string> release_command(const std::string& session_key, const std::string& token) {
+    return {"EVAL", kReleaseScript, "1", lock_key(session_key), token};
+}
+
+// Итоги обновлений (по одному на «полёт», не на каждого ждущего).
+const metrics::CounterFamily& refresh_outcomes() {
+    static const metrics::CounterFamily family(
+        "web_client_token_refresh_total", "Token refresh flights finished, by outcome", "outcome");
+    return family;
+}
+
+std::string error_text(std::exception_ptr err) {
+    try {
+        std::rethrow_exception(err);
+    } catch (const std::exception& e) {
+        return e.what();
+    } catch (...) {
+        return "unknown error";
+    }
+}
+
+int64_t unix_now() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+class SessionRefresher::Core : public std::enable_shared_from_this<Core> {
+public:
+    Core(SessionStore& sessions, AsyncRedisClient& redis_async, asio::io_context& io)
+        : sessions_(sessions), redis_async_(redis_async), io_(io) {}
+
+    void refresh(const std::string& session_key, const SessionData& stale, Callback on_done) {
+        static const auto joined = metrics::counter(
+            "web_client_token_refresh_joined_total", "Refresh requests that joined a flight already in progress");
+        uint64_t id = 0;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            auto [it, leader] = flights_.try_emplace(session_key);
+            it->second.waiters.push_back(std::move(on_done));
+            if (!leader) {
+                joined.inc();
+                return;
+            }
+            id = it->second.id = ++next_flight_;
+            it->second.started = std::chrono::steady_clock::now();
+            it->second.span = trace::Span("refresh", "");
+            it->second.limit = std::make_shared<asio::steady_timer>(io_, kFlightLimit);
+            watch_limit(session_key, id, it->second.limit);
+        }
+        attempt(session_key, id, stale, std::chrono::steady_clock::now() + kWaitLimit);
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // Полёт завершается не позже kFlightLimit, что бы ни случилось по дороге
+    // (Auth без ответа, потерянный колбэк): ждущие получают nullopt.
+    void watch_limit(const std::string& session_key, uint64_t id, const std::shared_ptr<asio::steady_timer>& timer) {
+        std::weak_ptr<Core> weak = shared_from_this();
+        timer->async_wait([weak, session_key, id](const asio::error_code& ec) {
+            auto core = weak.lock();
+            if (!core || ec) return;
+            CROW_LOG_WARNING << "refresh " << session_key << ": no result in "
+                             << std::chrono::duration_cast<std::chrono::seconds>(kFlightLimit).count() << " s";
+            core->finish(session_key, id, std::nullopt, "timeout");
+        });
+    }
+
+    // Все обращения к Redis — неблокирующие: колбэки идут в потоке цикла
+    // HTTP или asio, и ожидание Redis там задержало бы все запросы процесса.
+    void attempt(const std::string& session_key, uint64_t id, const SessionData& stale, Clock::time_point deadline) {
+        std::weak_ptr<Core> weak = shared_from_this();
+        // Читаем мимо кэша: нужен самый свежий токен.
+        redis_async_.async_get(session_key, [weak, session_key, id, stale, deadline](
+                                                std::exception_ptr err, std::optional<std::string> value) {
+            auto core = weak.lock();
+            if (!core) return;
+            if (err) {
+                core->redis_failed(session_key, id, error_text(err));
+                return;
+            }
+
+            std::optional<SessionData> current;
+            if (value) current = parse_session(*value);
+            if (!current || current->status != "authorized") {
+                core->finish(session_key, id, std::nullopt, "no_session");
+                return;
+            }
+            if (current->access_token != stale.access_token) {
+                // Кто-то уже обновил.
+                core->finish(session_key, id, current, "already_refreshed");
+                return;
+            }
+            core->lock(session_key, id, std::move(*current), stale, deadline);
+        });
+    }
+
+    void lock(const std::string& session_key,
+              uint64_t id,
+              SessionData current,
+              const SessionData& stale,
+              Clock::time_point deadline) {
+        std::weak_ptr<Core> weak = shared_from_this();
+        std::string token = gen_uuid();
+        redis_async_.async_command(
+            {"SET", lock_key(session_key), token, "NX", "PX", std::to_string(kLockTtl.count())},
+            [weak, session_key, id, current = std::move(current), stale, deadline, token](
+                std::exception_ptr err, RedisReply rep) mutable {
+                auto core = weak.lock();
+                if (!core) return;
+                if (err || rep.is_error()) {
+                    core->redis_failed(session_key, id, err ? error_text(err) : rep.str);
+                    return;
+                }
+                if (rep.is_ok()) {
+                    core->fetch(session_key, id, std::move(current), std::move(token));
+                    return;
+                }
+                if (Clock::now() >= deadline) {
+                    CROW_LOG_WARNING << "refresh " << session_key << ": timed out waiting for another instance";
+                    core->finish(session_key, id, std::nullopt, "timeout");
+                    return;
+                }
+                core->wait(session_key, id, stale, deadline);
+            });
+    }
+
+    // Refresh держит другой инстанс: перечитываем сессию, пока токен не
+    // сменится или блокировка не освободится.
+    void wait(const std::string& session_key, uint64_t id, const SessionData& stale, Clock::time_point deadline) {
+        auto timer = std::make_shared<asio::steady_timer>(io_, kPollInterval);
+        std::weak_ptr<Core> weak = shared_from_this();
+        timer->async_wait([weak, timer, session_key, id, stale, deadline](const asio::error_code& ec) {
+            auto core = weak.lock();
+            if (!core || ec) return;
+            core->attempt(session_key, id, stale, deadline);
+        });
+    }
+
+    void fetch(const std::string& session_key, uint64_t id, SessionData base, std::string token) {
+        std::weak_ptr<Core> weak = shared_from_this();
+        auto refresh_token = base.refresh_token;
+        upstreams()->auth.RefreshAsync(refresh_token, [weak, session_key, id, base = std::move(base),
+                                                       token = std::move(token)](
+                                                          std::optional<AuthRefresh> refreshed) mutable {
+            auto core = weak.lock();
+            if (!core) return;
+            core->on_fetched(session_key, id, std::move(base), token, std::move(refreshed));
+        });
+    }
+
+    void on_fetched(const std::string& session_key,
+                    uint64_t id,
+                    SessionData session,
+                    const std::string& token,
+                    std::optional<AuthRefresh> refreshed) {
+        if (!refreshed) {
+            sessions_.drop(session_key);
+            release(session_key, token);
+            finish(session_key, id, std::nullopt, "rejected");
+            return;
+        }
+
+        session.access_token = refreshed->access_token;
+        session.refresh_token = refreshed->refresh_token;
+        session.access_exp = jwt_exp(session.access_token).value_or(0);
+        // Новые токены и снятие блокировки — одной транзакцией: один round
+        // trip, и блокировка не переживает запись. При обрыве она истечёт сама.
+        std::weak_ptr<Core> weak = shared_from_this();
+        sessions_.save_async(session_key, session, [weak, session_key, id, session](std::exception_ptr err) {
+            auto core = weak.lock();
+            if (!core) return;
+            if (err) {
+                CROW_LOG_ERROR << "refresh " << session_key << ": save: " << error_text(err);
+                core->finish(session_key, id, std::nullopt, "redis_error");
+                return;
+            }
+            core->finish(session_key, id, session, "refreshed");
+        }, {release_command(session_key, token)});
+    }
+
+    void redis_failed(const std::string& session_key, uint64_t id, const std::string& error) {
+        CROW_LOG_ERROR << "refresh " << session_key << ": " << error;
+        finish(session_key, id, std::nullopt, "redis_error");
+    }
+
+    void release(const std::string& session_key, const std::string& token) {
+        redis_async_.async_command(release_command(session_key, token),
+                                   [session_key](std::exception_ptr err, RedisReply rep) {
+            if (!err && !rep.is_error()) return;
+            // Не страшно: блокировка истечёт сама через kLockTtl.
+            CROW_LOG_WARNING << "refresh " << session_key << ": release lock: "
+                             << (err ? "connection error" : rep.str);
+        });
+    }
+
+    // id — чтобы запоздавший итог полёта, уже снятого по kFlightLimit, не
+    // завершил следующий полёт той же сессии.
+    void finish(const std::string& session_key,
+                uint64_t id,
+                const std::optional<SessionData>& result,
+                const char* outcome) {
+        static const auto duration = metrics::histogram(
+            "web_client_token_refresh_duration_seconds", "Token refresh flight time, including waits for other instances");
+
+        Flight flight;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            auto it = flights_.find(session_key);
+            if (it == flights_.end() || it->second.id != id) return;
+            flight = std::move(it->second);
+            flights_.erase(it);
+        }
+        if (flight.limit) {
+            // Таймер живёт в потоке io_context; finish бывает и в потоке HTTP-цикла.
+            asio::post(io_, [limit = std::move(flight.limit)] { limit->cancel(); });
+        }
+        flight.span.end();
+        duration.observe_since(flight.started);
+        refresh_outcomes().with(outcome).inc();
+        for (auto& on_done : flight.waiters) {
+            on_done(result);
+        }
+    }
+
+    SessionStore& sessions_;
+    AsyncRedisClient& redis_async_;
+    asio::io_context& io_;
+
+    struct Flight {
+        uint64_t id = 0;
+        Clock::time_point started;
+        trace::Span span; // в trace запроса, начавшего обновление
+        std::shared_ptr<asio::steady_timer> limit;
+        std::vector<Callback> waiters;
+    };
+
+    std::mutex mu_;
+    std::unordered_map<std::string, Flight> flights_;
+    uint64_t next_flight_ = 0;
+};
+
+SessionRefresher::SessionRefresher(SessionStore& sessions,
+                                   AsyncRedisClient& redis_async,
+                                   asio::io_context& io,
+                                   std::chrono::seconds refresh_ahead,
+                                   std::chrono::milliseconds sync_wait)
+    : core_(std::make_shared<Core>(sessions, redis_async, io)),
+      refresh_ahead_(refresh_ahead),
+      sync_wait_(sync_wait) {}
+
+SessionRefresher::~SessionRefresher() = default;
+
+void SessionRefresher::refresh(const std::string& session_key, const SessionData& stale, Callback on_done) {
+    core_->refresh(session_key, stale, std::move(on_done));
+}
+
+std::optional<SessionData> SessionRefresher::refresh(const std::string& session_key,
+                                                     const SessionData& stale,
+                                                     bool* pending) {
+    if (pending) *pending = false;
+    auto promise = std::make_shared<std::promise<std::optional<SessionData>>>();
+    auto future = promise->get_future();
+    refresh(session_key, stale, [promise](std::optional<SessionData> result) {
+        promise->set_value(std::move(result));
+    });
+    // Полёт сам завершается по kFlightLimit (до ~20 с при медленном Auth или
+    // чужой блокировке) — столько worker-поток не держим. Запас сверх
+    // kFlightLimit — на случай, если и это не сработало (остановлен io_context).
+    const auto flight_wait = kFlightLimit + std::chrono::seconds(1);
+    const auto wait = sync_wait_.count() > 0 ? std::min<std::chrono::milliseconds>(sync_wait_, flight_wait) : flight_wait;
+    if (future.wait_for(wait) != std::future_status::ready) {
+        CROW_LOG_WARNING << "refresh " << session_key << ": still in flight after " << wait.count() << " ms";
+        if (pending) *pending = true;
+        return std::nullopt;
+    }
+    return future.get();
+}
+
+bool SessionRefresher::expired(const SessionData& session) const {
+    if (session.access_exp <= 0) return false;
+    return unix_now() >= session.access_exp - kExpirySkew.count();
+}
+
+void SessionRefresher::refresh_if_expiring(const std::string& session_key, const SessionData& session) {
+    if (session.access_exp <= 0) return;
+    if (unix_now() < session.access_exp - refresh_ahead_.count()) return;
+
+    // Результат не ждём: параллельные запросы присоединятся к этому же
+    // обновлению, следующие увидят новый токен через кэш сессий.
+    refresh(session_key, session, [](std::optional<SessionData>) {});
+}
+
+bool SessionRefresher::ensure_fresh(const std::string& session_key, SessionData& session, bool* pending) {
+    if (pending) *pending = false;
+    if (!expired(session)) {
+        refresh_if_expiring(session_key, session);
+        return true;
+    }
+
+    auto refreshed = refresh(session_key, session, pending);
+    if (!refreshed) return false;
+    session = std::move(*refreshed);
+    return true;
+}
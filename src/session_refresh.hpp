@@ -0,0 +1,66 @@
+#pragma once
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "async_redis.hpp"
+#include "session.hpp"
+#include "session_store.hpp"
+
+// Обновление токенов сессии «в один полёт».
+//
+// Параллельные запросы одной сессии (несколько вкладок, пачка XHR), получив
+// 401, не бьют в Auth каждый сам: первый становится ведущим, остальные ждут
+// его результат. Между инстансами то же обеспечивает короткая блокировка в
+// Redis (SET NX PX): не получивший её ждёт, пока в сессии появится новый
+// access token. Refresh token ротируется, поэтому второй refresh тем же
+// токеном сломал бы сессию — отсюда и вся конструкция.
+//
+// Кроме того, по exp из JWT токен обновляется заранее: за refresh_ahead до
+// истечения — в фоне, не задерживая запрос; уже истёкший — до запроса в Main,
+// а не после его 401.
+class SessionRefresher {
+public:
+    // nullopt — обновить не удалось (сессия при отказе Auth удаляется).
+    using Callback = std::function<void(std::optional<SessionData>)>;
+
+    SessionRefresher(SessionStore& sessions,
+                     AsyncRedisClient& redis_async,
+                     asio::io_context& io,
+                     std::chrono::seconds refresh_ahead = std::chrono::seconds(60),
+                     std::chrono::milliseconds sync_wait = std::chrono::milliseconds(5000));
+    ~SessionRefresher();
+
+    SessionRefresher(const SessionRefresher&) = delete;
+    SessionRefresher& operator=(const SessionRefresher&) = delete;
+
+    // stale — данные, с которыми получили 401. Если токен в Redis уже другой,
+    // возвращается он без обращения к Auth. Колбэк вызывается из потока
+    // HTTP-цикла или asio, иногда сразу в вызывающем.
+    void refresh(const std::string& session_key, const SessionData& stale, Callback on_done);
+
+    // Блокирующий вариант для синхронных обработчиков: ждёт не дольше
+    // sync_wait (0 — до конца полёта). Не дождался — nullopt и *pending = true;
+    // полёт не отменяется, новый токен получат следующие запросы сессии.
+    std::optional<SessionData> refresh(const std::string& session_key,
+                                       const SessionData& stale,
+                                       bool* pending = nullptr);
+
+    // Access token истёк (с запасом на расхождение часов): Main ответит 401.
+    bool expired(const SessionData& session) const;
+
+    // Истекает в пределах refresh_ahead — запускает обновление в фоне.
+    void refresh_if_expiring(const std::string& session_key, const SessionData& session);
+
+    // Для синхронных обработчиков: истёкший токен обновляет сразу (false —
+    // не удалось или, с *pending = true, не дождались), истекающий — в фоне.
+    bool ensure_fresh(const std::string& session_key, SessionData& session, bool* pending = nullptr);
+
+private:
+    class Core;
+    std::shared_ptr<Core> core_;
+    std::chrono::seconds refresh_ahead_;
+    std::chrono::milliseconds sync_wait_;
+};
@@ -0,0 +1,417 @@
+#include "session_store.hpp"
+
+#include <crow.h>
+
+#include <functional>
+#include <stdexcept>
+
+namespace {
+
+constexpr const char* kSessionPrefix = "session:";
+
+// Compare-and-set: пишем, только если в Redis всё ещё прочитанное значение.
+// ARGV[3] — TTL в секундах, 0 — без срока.
+constexpr const char* kReplaceScript =
+    "if redis.call('get', KEYS[1]) ~= ARGV[1] then return 0 end "
+    "if tonumber(ARGV[3]) > 0 then redis.call('set', KEYS[1], ARGV[2], 'EX', ARGV[3]) "
+    "else redis.call('set', KEYS[1], ARGV[2]) end return 1";
+
+constexpr int kUpdateAttempts = 3;
+
+std::optional<std::string> get_value(RedisReply& rep) {
+    if (rep.is_error()) throw std::runtime_error("Redis error: " + rep.str);
+    if (rep.is_null()) return std::nullopt;
+    if (rep.type != RedisReply::Type::String) throw std::runtime_error("Unexpected reply type for GET");
+    return std::move(rep.str);
+}
+
+// PTTL: -1 (без срока) и -2 (ключа уже нет) — как истёкший, продлить сразу.
+std::chrono::milliseconds ttl_left(const RedisReply& rep) {
+    if (rep.type != RedisReply::Type::Integer || rep.integer < 0) return std::chrono::milliseconds(0);
+    return std::chrono::milliseconds(rep.integer);
+}
+
+} // namespace
+
+// --- SessionCache ---
+
+SessionCache::SessionCache(size_t capacity, size_t shards) {
+    if (shards == 0) shards = 1;
+    shard_capacity_ = capacity / shards ? capacity / shards : 1;
+    shards_.reserve(shards);
+    for (size_t i = 0; i < shards; ++i) {
+        shards_.push_back(std::make_unique<Shard>());
+    }
+}
+
+SessionCache::Shard& SessionCache::shard_for(const std::string& key) {
+    return *shards_[std::hash<std::string>{}(key) % shards_.size()];
+}
+
+void SessionCache::set_enabled(bool enabled) {
+    // Пока подписки не было, инвалидации могли потеряться — начинаем с нуля
+    // в обе стороны.
+    if (!enabled) enabled_.store(false, std::memory_order_release);
+    clear();
+    if (enabled) enabled_.store(true, std::memory_order_release);
+}
+
+std::optional<SessionCache::Entry> SessionCache::get(const std::string& key) {
+    auto& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mu);
+
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) return std::nullopt;
+
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    return it->second->second;
+}
+
+uint64_t SessionCache::version(const std::string& key) {
+    auto& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mu);
+    return shard.version;
+}
+
+void SessionCache::put_if_unchanged(const std::string& key,
+                                    const SessionData& data,
+                                    uint64_t version,
+                                    Clock::time_point renewed_at) {
+    if (!enabled()) return;
+
+    auto& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mu);
+    if (shard.version != version) return;
+
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        it->second->second = Entry{data, renewed_at};
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        return;
+    }
+
+    shard.lru.emplace_front(key, Entry{data, renewed_at});
+    shard.index.emplace(key, shard.lru.begin());
+
+    if (shard.lru.size() > shard_capacity_) {
+        shard.index.erase(shard.lru.back().first);
+        shard.lru.pop_back();
+    }
+}
+
+void SessionCache::mark_renewed(const std::string& key) {
+    auto& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mu);
+
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) it->second->second.renewed_at = Clock::now();
+}
+
+void SessionCache::invalidate(const std::string& key) {
+    auto& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mu);
+    ++shard.version;
+
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) return;
+    shard.lru.erase(it->second);
+    shard.index.erase(it);
+}
+
+void SessionCache::clear() {
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mu);
+        ++shard->version;
+        shard->lru.clear();
+        shard->index.clear();
+    }
+}
+
+// --- SessionStore ---
+
+SessionStore::SessionStore(RedisClient& redis,
+                           AsyncRedisClient& redis_async,
+                           SessionTtl ttl,
+                           size_t cache_capacity,
+                           size_t cache_shards)
+    : redis_(redis),
+      redis_async_(redis_async),
+      ttl_(ttl),
+      cache_(std::make_shared<SessionCache>(cache_capacity, cache_shards)) {
+    std::weak_ptr<SessionCache> weak = cache_;
+
+    redis_async_.listen(
+        {
+            {"HELLO", "3"},
+            {"CLIENT", "TRACKING", "ON", "BCAST", "PREFIX", kSessionPrefix},
+        },
+        // >2 "invalidate" [key, ...] | null (FLUSHDB/FLUSHALL)
+        [weak](const RedisReply& push) {
+            auto cache = weak.lock();
+            if (!cache) return;
+            if (push.elements.size() < 2 || push.elements[0].str != "invalidate") return;
+
+            const auto& keys = push.elements[1];
+            if (keys.type != RedisReply::Type::Array) {
+                cache->clear();
+                return;
+            }
+            for (const auto& key : keys.elements) {
+                cache->invalidate(key.str);
+            }
+        },
+        [weak](bool ready) {
+            auto cache = weak.lock();
+            if (!cache || cache->enabled() == ready) return;
+            cache->set_enabled(ready);
+            CROW_LOG_INFO << "session cache " << (ready ? "enabled" : "disabled: invalidation channel down");
+        });
+}
+
+std::chrono::seconds SessionStore::ttl_for(const SessionData& data) const {
+    return data.status == "authorized" ? ttl_.authorized : ttl_.anonymous;
+}
+
+std::optional<SessionData> SessionStore::from_cache(const std::string& session_key, bool& renewed) {
+    auto hit = cache_->get(session_key);
+    if (!hit) return std::nullopt;
+
+    const auto ttl = ttl_for(hit->data);
+    if (ttl.count() > 0 && (SessionCache::Clock::now() - hit->renewed_at) * 10 > ttl) {
+        cache_->mark_renewed(session_key);
+        renew_async(session_key, ttl);
+        renewed = true;
+    }
+    return std::move(hit->data);
+}
+
+// Продление TTL — тоже изменение ключа, Redis пришлёт на него invalidate.
+// Поэтому при включённом кэше только читаем (иначе каждый промах
+// выбивал бы запись снова), а продлеваем не чаще раза в ttl/10 из кэша.
+// Отсчёт идёт от последнего продления в Redis, восстановленного по PTTL
+// (ttl_left): иначе каждое заполнение после инвалидации сбрасывало бы его,
+// и ключ с остатком меньше ttl/10 так и истёк бы.
+// Без кэша продлеваем асинхронным EXPIRE, когда статус уже известен:
+// потерянный EXPIRE не продлит ключ, но и чужого срока не даст.
+std::optional<SessionData> SessionStore::from_redis(const std::string& session_key,
+                                                    const std::optional<std::string>& value,
+                                                    std::chrono::milliseconds ttl_left,
+                                                    bool use_cache,
+                                                    uint64_t version,
+                                                    bool& renewed) {
+    if (!value) return std::nullopt;
+
+    auto data = parse_session(*value);
+    if (!data) {
+        drop(session_key);
+        return std::nullopt;
+    }
+
+    if (use_cache) {
+        const std::chrono::milliseconds ttl = ttl_for(*data);
+        auto renewed_at = SessionCache::Clock::now();
+        if (ttl > ttl_left) renewed_at -= ttl - ttl_left;
+        cache_->put_if_unchanged(session_key, *data, version, renewed_at);
+        return data;
+    }
+
+    renew_async(session_key, ttl_for(*data));
+    renewed = true;
+    return data;
+}
+
+std::optional<SessionData> SessionStore::load(const std::string& session_key, bool* renewed) {
+    bool renewed_now = false;
+    if (renewed) *renewed = false;
+
+    if (!cache_->enabled()) {
+        auto data = from_redis(session_key, redis_.get(session_key), {}, false, 0, renewed_now);
+        if (renewed) *renewed = renewed_now;
+        return data;
+    }
+
+    if (auto hit = from_cache(session_key, renewed_now)) {
+        if (renewed) *renewed = renewed_now;
+        return hit;
+    }
+    const uint64_t version = cache_->version(session_key);
+    auto replies = redis_.transaction().get(session_key).command({"PTTL", session_key}).exec();
+    auto data = from_redis(session_key, get_value(replies[0]), ttl_left(replies[1]), true, version, renewed_now);
+    if (renewed) *renewed = renewed_now;
+    return data;
+}
+
+void SessionStore::load_async(const std::string& session_key, Loaded done) {
+    if (!cache_->enabled()) {
+        redis_async_.async_get(session_key, [this, session_key, done = std::move(done)](
+                                                std::exception_ptr err, std::optional<std::string> value) {
+            if (err) {
+                done(err, std::nullopt, false);
+                return;
+            }
+            bool renewed = false;
+            auto data = from_redis(session_key, value, {}, false, 0, renewed);
+            done(nullptr, std::move(data), renewed);
+        });
+        return;
+    }
+
+    bool renewed = false;
+    if (auto hit = from_cache(session_key, renewed)) {
+        done(nullptr, std::move(hit), renewed);
+        return;
+    }
+    const uint64_t version = cache_->version(session_key);
+    redis_async_.async_transaction(
+        {{"GET", session_key}, {"PTTL", session_key}},
+        [this, session_key, version, done = std::move(done)](std::exception_ptr err,
+                                                             std::vector<RedisReply> replies) {
+            std::optional<SessionData> data;
+            bool renewed = false;
+            if (!err) {
+                try {
+                    data = from_redis(session_key, get_value(replies[0]), ttl_left(replies[1]), true, version, renewed);
+                } catch (...) {
+                    err = std::current_exception();
+                }
+            }
+            done(err, std::move(data), renewed);
+        });
+}
+
+void SessionStore::save(const std::string& session_key, const SessionData& data) {
+    redis_.set(session_key, serialize_session(data), ttl_for(data));
+    // Не кладём новое значение сразу: invalidate на эту же запись всё равно
+    // придёт следующим, а следующий load() сам заполнит кэш.
+    cache_->invalidate(session_key);
+}
+
+std::optional<SessionData> SessionStore::load_and_save(const std::string& previous_key,
+                                                      const std::string& session_key,
+                                                      const SessionData& data) {
+    auto replies = redis_.pipeline()
+                       .get(previous_key)
+                       .set(session_key, serialize_session(data), ttl_for(data))
+                       .exec();
+    cache_->invalidate(session_key);
+
+    const auto& saved = replies[1];
+    if (saved.is_error()) throw std::runtime_error("Redis error: " + saved.str);
+    if (!saved.is_ok()) throw std::runtime_error("Unexpected reply for SET");
+
+    const auto& previous = replies[0];
+    if (previous.is_error()) throw std::runtime_error("Redis error: " + previous.str);
+    if (previous.type != RedisReply::Type::String) return std::nullopt;
+
+    auto parsed = parse_session(previous.str);
+    if (!parsed) drop(previous_key);
+    return parsed;
+}
+
+void SessionStore::save_async(const std::string& session_key,
+                              const SessionData& data,
+                              std::function<void(std::exception_ptr)> done,
+                              std::vector<std::vector<std::string>> with) {
+    const auto ttl = ttl_for(data);
+    std::vector<std::string> command = {"SET", session_key, serialize_session(data)};
+    if (ttl.count() > 0) {
+        command.push_back("EX");
+        command.push_back(std::to_string(ttl.count()));
+    }
+    auto cache = cache_;
+    if (with.empty()) {
+        redis_async_.async_command(command, [cache, session_key, done = std::move(done)](std::exception_ptr err,
+                                                                                        RedisReply rep) {
+            if (!err && rep.is_error()) err = std::make_exception_ptr(std::runtime_error("Redis error: " + rep.str));
+            cache->invalidate(session_key);
+            done(err);
+        });
+        return;
+    }
+
+    with.insert(with.begin(), std::move(command));
+    redis_async_.async_transaction(with, [cache, session_key, done = std::move(done)](
+                                             std::exception_ptr err, std::vector<RedisReply> replies) {
+        for (size_t i = 0; !err && i < replies.size(); ++i) {
+            if (replies[i].is_error()) err = std::make_exception_ptr(std::runtime_error("Redis error: " + replies[i].str));
+        }
+        cache->invalidate(session_key);
+        done(err);
+    });
+}
+
+void SessionStore::remove(const std::string& session_key) {
+    redis_.del(session_key);
+    cache_->invalidate(session_key);
+}
+
+void SessionStore::drop(const std::string& session_key) {
+    cache_->invalidate(session_key);
+    redis_async_.async_del(session_key, [session_key](std::exception_ptr err) {
+        if (!err) return;
+        try {
+            std::rethrow_exception(err);
+        } catch (const std::exception& e) {
+            CROW_LOG_WARNING << "drop session " << session_key << ": " << e.what();
+        }
+    });
+}
+
+void SessionStore::renew_async(const std::string& session_key, std::chrono::seconds ttl) {
+    std::vector<std::string> command = ttl.count() > 0
+        ? std::vector<std::string>{"EXPIRE", session_key, std::to_string(ttl.count())}
+        : std::vector<std::string>{"PERSIST", session_key};
+
+    redis_async_.async_command(command, [session_key](std::exception_ptr err, RedisReply rep) {
+        if (!err && !rep.is_error()) return;
+        CROW_LOG_WARNING << "renew session " << session_key << ": "
+                         << (err ? "connection error" : rep.str);
+    });
+}
+
+void SessionStore::update_async(const std::string& session_key, Mutate mutate, std::function<void(bool)> done) {
+    update_attempt(session_key, std::make_shared<Mutate>(std::move(mutate)), std::move(done), kUpdateAttempts);
+}
+
+void SessionStore::update_attempt(const std::string& session_key,
+                                  std::shared_ptr<Mutate> mutate,
+                                  std::function<void(bool)> done,
+                                  int attempts_left) {
+    redis_async_.async_get(session_key, [this, session_key, mutate, done = std::move(done), attempts_left](
+                                            std::exception_ptr err, std::optional<std::string> value) mutable {
+        if (err || !value) {
+            done(false);
+            return;
+        }
+        auto current = parse_session(*value);
+        auto updated = current ? (*mutate)(*current) : std::nullopt;
+        if (!updated) {
+            done(false);
+            return;
+        }
+
+        const auto ttl = ttl_for(*updated);
+        redis_async_.async_command(
+            {"EVAL", kReplaceScript, "1", session_key, *value, serialize_session(*updated), std::to_string(ttl.count())},
+            [this, session_key, mutate, done = std::move(done), attempts_left](std::exception_ptr err,
+                                                                               RedisReply rep) mutable {
+                if (err || rep.is_error()) {
+                    CROW_LOG_WARNING << "update session " << session_key << ": "
+                                     << (err ? "connection error" : rep.str);
+                    done(false);
+                    return;
+                }
+                if (rep.integer == 1) {
+                    cache_->invalidate(session_key);
+                    done(true);
+                    return;
+                }
+                // Сессию успели изменить — перечитываем.
+                if (attempts_left <= 1) {
+                    done(false);
+                    return;
+                }
+                update_attempt(session_key, std::move(mutate), std::move(done), attempts_left - 1);
+            });
+    });
+}
@@ -0,0 +1,149 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "async_redis.hpp"
+#include "redis.hpp"
+#include "session.hpp"
+
+// Ограниченный LRU-кэш разобранных сессий. Разбит на шарды по хэшу ключа,
+// чтобы worker-потоки не толкались на одном мьютексе.
+//
+// Пока кэш выключен (нет подписки на инвалидации), он пуст и ничего не
+// принимает. Каждая инвалидация увеличивает версию шарда: значение,
+// прочитанное из Redis до инвалидации, в кэш уже не попадёт.
+class SessionCache {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        SessionData data;
+        Clock::time_point renewed_at; // когда последний раз продлевали TTL в Redis
+    };
+
+    SessionCache(size_t capacity, size_t shards);
+
+    bool enabled() const { return enabled_.load(std::memory_order_acquire); }
+    void set_enabled(bool enabled);
+
+    std::optional<Entry> get(const std::string& key);
+    uint64_t version(const std::string& key);
+    // renewed_at — когда ключ в Redis продлевали последний раз.
+    void put_if_unchanged(const std::string& key,
+                          const SessionData& data,
+                          uint64_t version,
+                          Clock::time_point renewed_at);
+    void mark_renewed(const std::string& key);
+
+    void invalidate(const std::string& key);
+    void clear();
+
+private:
+    struct Shard {
+        std::mutex mu;
+        std::list<std::pair<std::string, Entry>> lru; // front — самый свежий
+        std::unordered_map<std::string, std::list<std::pair<std::string, Entry>>::iterator> index;
+        uint64_t version = 0;
+    };
+
+    Shard& shard_for(const std::string& key);
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    size_t shard_capacity_;
+    std::atomic<bool> enabled_ {false};
+};
+
+// Сроки жизни сессий в Redis (и Max-Age cookie). Продлеваются при обращении.
+// Нулевое значение — без срока.
+struct SessionTtl {
+    std::chrono::seconds anonymous {15 * 60};
+    std::chrono::seconds authorized {24 * 60 * 60};
+};
+
+// Хранилище сессий: Redis + локальный кэш разобранных SessionData.
+//
+// Когерентность кэша обеспечивает Redis (client-side caching): отдельное
+// соединение RESP3 с CLIENT TRACKING BCAST PREFIX session: получает
+// invalidate на любое изменение сессий с любого инстанса. Пока это
+// соединение не поднято, кэш выключен и все чтения идут в Redis.
+//
+// TTL скользящий и зависит от статуса: без кэша каждое чтение продлевает
+// ключ асинхронным EXPIRE, с кэшем — попадание раз в ttl/10.
+class SessionStore {
+public:
+    SessionStore(RedisClient& redis,
+                 AsyncRedisClient& redis_async,
+                 SessionTtl ttl = {},
+                 size_t cache_capacity = 65536,
+                 size_t cache_shards = 16);
+
+    // nullopt — сессии нет или она битая (битая при этом удаляется).
+    // renewed — TTL ключа в этот раз продлён (пора обновить Max-Age cookie).
+    std::optional<SessionData> load(const std::string& session_key, bool* renewed = nullptr);
+    // Неблокирующий load для обработчиков запросов: при попадании в кэш
+    // done вызывается сразу в вызывающем потоке, иначе — в потоке asio
+    // (err — обрыв или ошибка Redis).
+    using Loaded = std::function<void(std::exception_ptr err, std::optional<SessionData> data, bool renewed)>;
+    void load_async(const std::string& session_key, Loaded done);
+    void save(const std::string& session_key, const SessionData& data);
+    // Прочитать previous_key и записать data под session_key одной пачкой
+    // команд (один round trip; вход). Возвращает прежнюю сессию — nullopt,
+    // если её нет или она битая (битая при этом удаляется).
+    std::optional<SessionData> load_and_save(const std::string& previous_key,
+                                             const std::string& session_key,
+                                             const SessionData& data);
+    // Неблокирующая запись для колбэков в потоках asio и HTTP-цикла:
+    // done(nullptr) — записано, иначе — ошибка соединения или Redis.
+    // with — команды, которые выполнятся в той же транзакции MULTI/EXEC
+    // (тем же round trip); их ошибка тоже приходит в done.
+    void save_async(const std::string& session_key,
+                    const SessionData& data,
+                    std::function<void(std::exception_ptr)> done,
+                    std::vector<std::vector<std::string>> with = {});
+    void remove(const std::string& session_key);
+
+    // Удаление, которого не нужно ждать (протухшая/битая сессия): ответ
+    // пользователю от него не зависит.
+    void drop(const std::string& session_key);
+
+    // Неблокирующее чтение-изменение-запись мимо кэша. mutate получает
+    // текущую сессию и возвращает новую (nullopt — ничего не менять);
+    // запись проходит, только если значение в Redis за это время не
+    // изменилось, иначе всё повторяется (до трёх раз). done(true) — записано.
+    // Колбэки вызываются в потоке asio.
+    using Mutate = std::function<std::optional<SessionData>(const SessionData&)>;
+    void update_async(const std::string& session_key, Mutate mutate, std::function<void(bool)> done);
+
+    std::chrono::seconds ttl_for(const SessionData& data) const;
+
+private:
+    std::optional<SessionData> from_cache(const std::string& session_key, bool& renewed);
+    std::optional<SessionData> from_redis(const std::string& session_key,
+                                          const std::optional<std::string>& value,
+                                          std::chrono::milliseconds ttl_left,
+                                          bool use_cache,
+                                          uint64_t version,
+                                          bool& renewed);
+    void renew_async(const std::string& session_key, std::chrono::seconds ttl);
+    void update_attempt(const std::string& session_key,
+                        std::shared_ptr<Mutate> mutate,
+                        std::function<void(bool)> done,
+                        int attempts_left);
+
+    RedisClient& redis_;
+    AsyncRedisClient& redis_async_;
+    SessionTtl ttl_;
+    // shared_ptr: колбэки слушателя инвалидаций живут в потоке asio.
+    std::shared_ptr<SessionCache> cache_;
+};
@@ -0,0 +1,102 @@
+#include "static_page.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <zlib.h>
+
+namespace {
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+std::string_view opaque_tag(std::string_view etag) {
+    if (etag.compare(0, 2, "W/") == 0) etag.remove_prefix(2);
+    return etag;
+}
+
+// FNV-1a: стабилен между запусками, в отличие от std::hash.
+uint64_t content_hash(std::string_view s) {
+    uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+const char* etag_suffix(ContentEncoding encoding) {
+    switch (encoding) {
+        case ContentEncoding::Gzip: return "-gz";
+        case ContentEncoding::Deflate: return "-df";
+        default: return "";
+    }
+}
+
+} // namespace
+
+bool etag_matches(std::string_view if_none_match, std::string_view etag) {
+    const auto tag = opaque_tag(etag);
+    while (!if_none_match.empty()) {
+        const auto comma = if_none_match.find(',');
+        const auto item = trim(if_none_match.substr(0, comma));
+        if_none_match = comma == std::string_view::npos ? std::string_view() : if_none_match.substr(comma + 1);
+
+        if (item == "*" || opaque_tag(item) == tag) return true;
+    }
+    return false;
+}
+
+StaticPage::StaticPage(std::string content_type, std::string body, std::string cache_control, Headers headers)
+    : content_type_(std::move(content_type)),
+      cache_control_(std::move(cache_control)),
+      headers_(std::move(headers)) {
+    char hash[17];
+    std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(content_hash(body)));
+
+    for (auto encoding : {ContentEncoding::Gzip, ContentEncoding::Deflate}) {
+        auto compressed = compress_body(body, encoding, Z_BEST_COMPRESSION);
+        // Не меньше исходного — такой вариант не нужен, отдадим identity.
+        if (compressed.size() >= body.size()) continue;
+        variants_.push_back({encoding, std::move(compressed), std::string("\"") + hash + etag_suffix(encoding) + "\""});
+    }
+    variants_.insert(variants_.begin(), Variant{ContentEncoding::Identity, std::move(body), std::string("\"") + hash + "\""});
+}
+
+const StaticPage::Variant& StaticPage::pick(std::string_view accept_encoding) const {
+    const auto encoding = negotiate_encoding(accept_encoding);
+    for (const auto& variant : variants_) {
+        if (variant.encoding == encoding) return variant;
+    }
+    return variants_.front();
+}
+
+void StaticPage::add_headers(crow::response& res, const StaticPage::Variant& variant) const {
+    res.set_header("ETag", variant.etag);
+    res.set_header("Cache-Control", cache_control_);
+    res.set_header("Vary", "Accept-Encoding");
+    for (const auto& [name, value] : headers_) {
+        res.set_header(name, value);
+    }
+}
+
+crow::response StaticPage::respond(const crow::request& req) const {
+    const auto& variant = pick(req.get_header_value("Accept-Encoding"));
+
+    const auto if_none_match = req.get_header_value("If-None-Match");
+    if (!if_none_match.empty() && etag_matches(if_none_match, variant.etag)) {
+        crow::response res(304);
+        add_headers(res, variant);
+        return res;
+    }
+
+    crow::response res(variant.body);
+    res.set_header("Content-Type", content_type_);
+    if (variant.encoding != ContentEncoding::Identity) {
+        res.set_header("Content-Encoding", encoding_name(variant.encoding));
+    }
+    add_headers(res, variant);
+    return res;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <crow.h>
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "compression.hpp"
+
+// Страница, которая не зависит от запроса: собирается один раз (при старте),
+// тут же сжимается gzip и deflate с максимальным уровнем. На запрос —
+// только выбор готового варианта по Accept-Encoding и копия байтов.
+//
+// У каждого варианта свой сильный ETag (хэш содержимого + кодировка), так
+// что совпадающий If-None-Match даёт 304 без тела. Хэш не зависит от
+// процесса — у всех экземпляров сервиса ETag одинаковые.
+class StaticPage {
+public:
+    using Headers = std::vector<std::pair<std::string, std::string>>;
+
+    StaticPage(std::string content_type, std::string body, std::string cache_control, Headers headers = {});
+
+    crow::response respond(const crow::request& req) const;
+
+private:
+    struct Variant {
+        ContentEncoding encoding;
+        std::string body;
+        std::string etag;
+    };
+
+    const Variant& pick(std::string_view accept_encoding) const;
+    void add_headers(crow::response& res, const Variant& variant) const;
+
+    std::string content_type_;
+    std::string cache_control_;
+    Headers headers_;
+    std::vector<Variant> variants_; // [0] — identity
+};
+
+// If-None-Match совпадает с etag (слабое сравнение, как требует RFC 9110).
+bool etag_matches(std::string_view if_none_match, std::string_view etag);
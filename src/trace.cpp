@@ -0,0 +1,291 @@
+#include "trace.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <random>
+
+namespace trace {
+namespace {
+
+uint64_t random_id() {
+    thread_local std::mt19937_64 rng(std::random_device{}() ^
+                                     static_cast<uint64_t>(Clock::now().time_since_epoch().count()));
+    uint64_t id = 0;
+    while (id == 0) id = rng();
+    return id;
+}
+
+bool sample(double rate) {
+    if (rate <= 0) return false;
+    if (rate >= 1) return true;
+    return static_cast<double>(random_id() >> 11) * 0x1.0p-53 < rate;
+}
+
+std::string hex64(uint64_t v) {
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(v));
+    return buf;
+}
+
+bool is_lower_hex(std::string_view s) {
+    for (char c : s) {
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) return false;
+    }
+    return true;
+}
+
+bool all_zero(std::string_view s) {
+    return s.find_first_not_of('0') == std::string_view::npos;
+}
+
+double to_ms(Clock::duration d) {
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+long long to_us(Clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+// Server-Timing: desc — quoted-string.
+void append_quoted(std::string& out, std::string_view s) {
+    out += '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (static_cast<unsigned char>(c) < 0x20) continue;
+        out += c;
+    }
+    out += '"';
+}
+
+thread_local std::shared_ptr<Trace> current_trace;
+
+} // namespace
+
+// --- Trace ---
+
+Trace::Trace(std::string_view traceparent, double sample_rate, bool trust_parent, std::string name)
+    : root_id_(random_id()),
+      sampled_(false),
+      name_(std::move(name)),
+      wall_start_(std::chrono::system_clock::now()),
+      start_(Clock::now()) {
+    // 00-<32 hex trace-id>-<16 hex parent-id>-<2 hex flags>; будущие версии
+    // могут дописывать поля после flags.
+    const bool valid = traceparent.size() >= 55
+        && (traceparent.size() == 55 || traceparent[55] == '-')
+        && traceparent[2] == '-' && traceparent[35] == '-' && traceparent[52] == '-'
+        && is_lower_hex(traceparent.substr(0, 2)) && traceparent.substr(0, 2) != "ff"
+        && is_lower_hex(traceparent.substr(3, 32)) && !all_zero(traceparent.substr(3, 32))
+        && is_lower_hex(traceparent.substr(36, 16)) && !all_zero(traceparent.substr(36, 16))
+        && is_lower_hex(traceparent.substr(53, 2))
+        && (traceparent.substr(0, 2) != "00" || traceparent.size() == 55);
+
+    if (valid) {
+        trace_id_ = std::string(traceparent.substr(3, 32));
+        parent_id_ = std::stoull(std::string(traceparent.substr(36, 16)), nullptr, 16);
+        sampled_ = trust_parent ? (std::stoul(std::string(traceparent.substr(53, 2)), nullptr, 16) & 1) != 0
+                                : sample(sample_rate);
+    } else {
+        trace_id_ = hex64(random_id()) + hex64(random_id());
+        sampled_ = sample(sample_rate);
+    }
+}
+
+std::string Trace::traceparent(uint64_t span_id) const {
+    return "00-" + trace_id_ + "-" + hex64(span_id) + (sampled_ ? "-01" : "-00");
+}
+
+void Trace::record(SpanRecord span) {
+    std::lock_guard<std::mutex> lock(mu_);
+    spans_.push_back(std::move(span));
+}
+
+void Trace::finish() {
+    std::lock_guard<std::mutex> lock(mu_);
+    duration_ = Clock::now() - start_;
+}
+
+std::string Trace::server_timing(size_t max_entries) const {
+    std::lock_guard<std::mutex> lock(mu_);
+    std::vector<const SpanRecord*> ordered;
+    ordered.reserve(spans_.size());
+    for (const auto& span : spans_) ordered.push_back(&span);
+    std::sort(ordered.begin(), ordered.end(), [](const SpanRecord* a, const SpanRecord* b) {
+        return a->start < b->start;
+    });
+
+    std::string out;
+    char dur[32];
+    for (size_t i = 0; i < ordered.size() && i < max_entries; ++i) {
+        out += ordered[i]->name;
+        if (!ordered[i]->desc.empty()) {
+            out += ";desc=";
+            append_quoted(out, ordered[i]->desc);
+        }
+        std::snprintf(dur, sizeof(dur), ";dur=%.3f, ", to_ms(ordered[i]->duration));
+        out += dur;
+    }
+    std::snprintf(dur, sizeof(dur), "total;dur=%.3f", to_ms(duration_));
+    out += dur;
+    return out;
+}
+
+std::string Trace::to_json() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    nlohmann::json spans = nlohmann::json::array();
+    for (const auto& span : spans_) {
+        spans.push_back({
+            {"span_id", hex64(span.id)},
+            {"parent_span_id", hex64(root_id_)},
+            {"name", span.name},
+            {"desc", span.desc},
+            {"start_offset_us", to_us(span.start - start_)},
+            {"duration_us", to_us(span.duration)},
+        });
+    }
+
+    nlohmann::json j = {
+        {"trace_id", trace_id_},
+        {"span_id", hex64(root_id_)},
+        {"name", name_},
+        {"start_unix_us", std::chrono::duration_cast<std::chrono::microseconds>(
+                              wall_start_.time_since_epoch()).count()},
+        {"duration_us", to_us(duration_)},
+        {"spans", std::move(spans)},
+    };
+    if (parent_id_ != 0) j["parent_span_id"] = hex64(parent_id_);
+    return j.dump();
+}
+
+// --- current / Scope ---
+
+const std::shared_ptr<Trace>& current() {
+    return current_trace;
+}
+
+Scope::Scope(std::shared_ptr<Trace> trace) : previous_(std::move(current_trace)) {
+    current_trace = std::move(trace);
+}
+
+Scope::~Scope() {
+    current_trace = std::move(previous_);
+}
+
+// --- Span ---
+
+Span::Span(std::string_view name, std::string_view desc) : trace_(current_trace) {
+    if (!trace_) return;
+    record_.id = random_id();
+    record_.name = std::string(name);
+    record_.desc = std::string(desc);
+    record_.start = Clock::now();
+}
+
+Span::~Span() {
+    end();
+}
+
+Span::Span(Span&& other) noexcept : trace_(std::move(other.trace_)), record_(std::move(other.record_)) {
+    other.trace_.reset();
+}
+
+Span& Span::operator=(Span&& other) noexcept {
+    if (this != &other) {
+        end();
+        trace_ = std::move(other.trace_);
+        record_ = std::move(other.record_);
+        other.trace_.reset();
+    }
+    return *this;
+}
+
+void Span::end() {
+    if (!trace_) return;
+    record_.duration = Clock::now() - record_.start;
+    trace_->record(std::move(record_));
+    trace_.reset();
+}
+
+std::string Span::traceparent() const {
+    return trace_ ? trace_->traceparent(record_.id) : std::string();
+}
+
+std::string_view url_path(std::string_view url) {
+    const auto scheme = url.find("://");
+    if (scheme != std::string_view::npos) {
+        const auto slash = url.find('/', scheme + 3);
+        url = slash == std::string_view::npos ? std::string_view("/") : url.substr(slash);
+    }
+    return url.substr(0, url.find_first_of("?#"));
+}
+
+// --- Exporter ---
+
+Exporter::Exporter(std::string path, size_t max_queue)
+    : path_(std::move(path)), max_queue_(max_queue), thread_([this] { run(); }) {}
+
+Exporter::~Exporter() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        stopping_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+}
+
+void Exporter::submit(const Trace& trace) {
+    auto line = trace.to_json();
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (queue_.size() >= max_queue_) return;
+        queue_.push_back(std::move(line));
+    }
+    cv_.notify_one();
+}
+
+void Exporter::run() {
+    std::ofstream out(path_, std::ios::app);
+    if (!out) {
+        CROW_LOG_ERROR << "trace export: cannot open " << path_;
+    }
+
+    std::unique_lock<std::mutex> lock(mu_);
+    for (;;) {
+        cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+        std::deque<std::string> batch;
+        batch.swap(queue_);
+        const bool stopping = stopping_;
+
+        lock.unlock();
+        for (const auto& line : batch) {
+            if (out) out << line << '\n';
+        }
+        if (out) out.flush();
+        lock.lock();
+
+        if (stopping && queue_.empty()) return;
+    }
+}
+
+} // namespace trace
+
+// --- Tracing middleware ---
+
+void Tracing::before_handle(crow::request& req, crow::response&, context& ctx) {
+    std::string name = crow::method_name(req.method);
+    name += ' ';
+    name += trace::url_path(req.url);
+    ctx.trace = std::make_shared<trace::Trace>(req.get_header_value("traceparent"), options.sample_rate,
+                                               options.trust_parent, std::move(name));
+}
+
+void Tracing::after_handle(crow::request&, crow::response& res, context& ctx) {
+    if (!ctx.trace) return;
+    ctx.trace->finish();
+    if (options.server_timing) res.set_header("Server-Timing", ctx.trace->server_timing());
+    if (options.exporter && ctx.trace->sampled()) options.exporter->submit(*ctx.trace);
+    ctx.trace.reset();
+}
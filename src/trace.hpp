@@ -0,0 +1,164 @@
+#pragma once
+#include <crow.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Трассировка запросов: из чего сложилось время ответа.
+//
+// На каждый входящий запрос — Trace (W3C trace context: trace-id берётся из
+// traceparent клиента или создаётся новый). Участки работы — Span: команды
+// Redis, запросы в Auth и Main, обновление токенов. Исходящие HTTP-запросы
+// несут traceparent со своим span-id, так что Auth и Main продолжают тот же
+// trace. По завершении запроса участки уходят в заголовок Server-Timing, а
+// выбранные сэмплированием trace — целиком в экспорт (файл JSON Lines).
+//
+// Текущий trace — thread_local: его ставит trace::Scope в обработчике.
+// http_request_async и AsyncRedisClient запоминают текущий trace при вызове
+// и ставят его на время своих колбэков, так что цепочки продолжений
+// остаются в том же trace. Без текущего trace Span ничего не пишет.
+namespace trace {
+
+using Clock = std::chrono::steady_clock;
+
+struct SpanRecord {
+    uint64_t id = 0;
+    std::string name; // категория: redis, auth, main, refresh, http
+    std::string desc; // что именно (команда, метод и путь) — без ключей и query
+    Clock::time_point start;
+    Clock::duration duration {};
+};
+
+class Trace {
+public:
+    // traceparent — заголовок входящего запроса; пустой или некорректный —
+    // новый trace. Корректный продолжает trace вызывающего (trace-id), но
+    // сэмплирование решаем сами с вероятностью sample_rate: иначе любой
+    // клиент флагом sampled включал бы экспорт своих запросов. trust_parent —
+    // вызывающий свой (mesh, шлюз), его флаг sampled решает.
+    Trace(std::string_view traceparent, double sample_rate, bool trust_parent, std::string name);
+
+    const std::string& trace_id() const { return trace_id_; }
+    uint64_t root_id() const { return root_id_; }
+    bool sampled() const { return sampled_; }
+
+    // Заголовок для исходящего запроса от имени участка span_id.
+    std::string traceparent(uint64_t span_id) const;
+
+    void record(SpanRecord span);
+    void finish();
+
+    // Значение Server-Timing: участки по порядку начала (не больше
+    // max_entries) и total — время запроса до finish().
+    std::string server_timing(size_t max_entries = 24) const;
+    // Одна строка JSON для экспорта.
+    std::string to_json() const;
+
+private:
+    std::string trace_id_;
+    uint64_t parent_id_ = 0; // span клиента, 0 — нет
+    uint64_t root_id_;
+    bool sampled_;
+    std::string name_;
+    std::chrono::system_clock::time_point wall_start_;
+    Clock::time_point start_;
+    Clock::duration duration_ {};
+
+    mutable std::mutex mu_;
+    std::vector<SpanRecord> spans_;
+};
+
+const std::shared_ptr<Trace>& current();
+
+// Ставит trace текущим для потока до конца области видимости.
+class Scope {
+public:
+    explicit Scope(std::shared_ptr<Trace> trace);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    std::shared_ptr<Trace> previous_;
+};
+
+// Участок под текущим trace потока (в момент создания). Записывается
+// end() или деструктором; можно переносить в другой поток (move).
+class Span {
+public:
+    Span() = default;
+    Span(std::string_view name, std::string_view desc);
+    ~Span();
+
+    Span(Span&& other) noexcept;
+    Span& operator=(Span&& other) noexcept;
+
+    void end();
+
+    // traceparent для исходящего запроса этого участка; "" — trace нет.
+    std::string traceparent() const;
+
+private:
+    std::shared_ptr<Trace> trace_;
+    SpanRecord record_;
+};
+
+// Путь URL без схемы, хоста и query — для desc участков.
+std::string_view url_path(std::string_view url);
+
+// Запись сэмплированных trace в файл JSON Lines отдельным потоком: запрос
+// только кладёт строку в очередь. Очередь переполнена — trace теряется.
+class Exporter {
+public:
+    explicit Exporter(std::string path, size_t max_queue = 4096);
+    ~Exporter();
+
+    Exporter(const Exporter&) = delete;
+    Exporter& operator=(const Exporter&) = delete;
+
+    void submit(const Trace& trace);
+
+private:
+    void run();
+
+    std::string path_;
+    size_t max_queue_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::deque<std::string> queue_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+} // namespace trace
+
+struct TracingOptions {
+    double sample_rate = 0.0;    // доля trace для экспорта
+    bool trust_parent = false;   // флаг sampled из traceparent решает сам
+    bool server_timing = false;  // заголовок Server-Timing в ответах
+    std::shared_ptr<trace::Exporter> exporter; // nullptr — не экспортировать
+};
+
+// Middleware Crow: Trace на каждый запрос (в context), по завершении —
+// Server-Timing и экспорт. Текущим для потока trace делает обработчик:
+// trace::Scope scope(app.get_context<Tracing>(req).trace).
+struct Tracing {
+    struct context {
+        std::shared_ptr<trace::Trace> trace;
+    };
+
+    TracingOptions options;
+
+    void before_handle(crow::request& req, crow::response& res, context& ctx);
+    void after_handle(crow::request& req, crow::response& res, context& ctx);
+};
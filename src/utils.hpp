@@ -23,3 +23,11 @@ inline std::string get_env(const char* key, const std::string& fallback) {
     if (!value) return fallback;
     return std::string(value);
 }
+
+// max_age == 0 — сессионная cookie без Max-Age.
+inline std::string session_cookie(const std::string& session, long long max_age) {
+    std::string cookie = "SESSION=" + session + "; Path=/";
+    if (max_age > 0) cookie += "; Max-Age=" + std::to_string(max_age);
+    cookie += "; HttpOnly; SameSite=Lax";
+    return cookie;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Минимальный раннер без внешних зависимостей: TEST регистрирует функцию,
+// CHECK/CHECK_EQ отмечают провал и печатают место, но тест продолжается;
+// CHECK_THROWS ждёт любое исключение.
+namespace check {
+
+struct Case {
+    const char* name;
+    std::function<void()> run;
+};
+
+inline std::vector<Case>& cases() {
+    static std::vector<Case> all;
+    return all;
+}
+
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+struct Register {
+    Register(const char* name, std::function<void()> run) { cases().push_back({name, std::move(run)}); }
+};
+
+inline void fail(const char* file, int line, const std::string& what) {
+    ++failures();
+    std::fprintf(stderr, "%s:%d: %s\n", file, line, what.c_str());
+}
+
+} // namespace check
+
+#define CHECK_CONCAT_(a, b) a##b
+#define CHECK_CONCAT(a, b) CHECK_CONCAT_(a, b)
+
+#define TEST(name)                                                              \
+    static void name();                                                         \
+    static const check::Register CHECK_CONCAT(register_, name)(#name, name);    \
+    static void name()
+
+#define CHECK(cond)                                                             \
+    do {                                                                        \
+        if (!(cond)) check::fail(__FILE__, __LINE__, "CHECK(" #cond ")");       \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                          \
+    do {                                                                        \
+        if (!((a) == (b))) check::fail(__FILE__, __LINE__, "CHECK_EQ(" #a ", " #b ")"); \
+    } while (0)
+
+#define CHECK_THROWS(expr)                                                      \
+    do {                                                                        \
+        bool thrown_ = false;                                                   \
+        try {                                                                   \
+            (void)(expr);                                                       \
+        } catch (...) {                                                         \
+            thrown_ = true;                                                     \
+        }                                                                       \
+        if (!thrown_) check::fail(__FILE__, __LINE__, "CHECK_THROWS(" #expr ")"); \
+    } while (0)
@@ -0,0 +1,116 @@
+#include "check.hpp"
+#include "html.hpp"
+
+#include <string>
+
+namespace {
+
+// Эталон — побайтная замена без векторного поиска.
+std::string reference_escape(std::string_view s) {
+    std::string out;
+    for (char c : s) {
+        switch (c) {
+            case '&': out += "&amp;"; break;
+            case '<': out += "&lt;"; break;
+            case '>': out += "&gt;"; break;
+            case '"': out += "&quot;"; break;
+            case '\'': out += "&#39;"; break;
+            default: out += c;
+        }
+    }
+    return out;
+}
+
+bool escapes_like_reference(std::string_view s) {
+    const auto expected = reference_escape(s);
+    return html_escape(s) == expected && html_escaped_size(s) == expected.size();
+}
+
+} // namespace
+
+TEST(html_escape_isa_is_known) {
+    const std::string isa = html_escape_isa();
+    CHECK(isa == "avx2" || isa == "sse2" || isa == "scalar");
+}
+
+// Векторный поиск идёт кусками по 32 и 16 байт, хвост — побайтно: спецсимвол
+// в каждой позиции строк длиной до 3 кусков AVX2 проходит все три ветки,
+// включая границы кусков. Смещение начала — невыровненные загрузки.
+TEST(html_escape_matches_reference_at_every_position) {
+    const std::string specials = "&<>\"'";
+    const std::string buffer(128, 'x');
+    for (size_t offset = 0; offset < 4; ++offset) {
+        for (size_t len = 0; len <= 100; ++len) {
+            std::string s = buffer.substr(offset, len);
+            if (!escapes_like_reference(s)) {
+                check::fail(__FILE__, __LINE__, "clean, len " + std::to_string(len));
+            }
+            for (size_t pos = 0; pos < len; ++pos) {
+                for (char c : specials) {
+                    std::string t = s;
+                    t[pos] = c;
+                    if (!escapes_like_reference(t)) {
+                        check::fail(__FILE__, __LINE__,
+                                    std::string("'") + c + "' at " + std::to_string(pos) + ", len " + std::to_string(len));
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(html_escape_specials_at_chunk_ends) {
+    // Первый и последний байт каждого куска сразу, плюс соседи.
+    for (size_t len : {15u, 16u, 17u, 31u, 32u, 33u, 47u, 48u, 63u, 64u, 65u, 96u}) {
+        std::string s(len, 'a');
+        for (size_t pos = 0; pos < len; ++pos) {
+            if (pos % 16 == 0 || pos % 16 == 15) s[pos] = pos % 32 < 16 ? '<' : '\'';
+        }
+        CHECK(escapes_like_reference(s));
+    }
+}
+
+TEST(html_escape_dense_and_high_bytes) {
+    // Подряд больше окна побайтного прохода (kDenseWindow = 16), затем чистый хвост.
+    std::string dense;
+    for (int i = 0; i < 40; ++i) dense += "&<>\"'"[i % 5];
+    CHECK(escapes_like_reference(dense));
+    CHECK(escapes_like_reference(dense + std::string(50, 'z') + dense));
+
+    // Байты >= 0x80 (UTF-8) со знаковым char не должны совпасть со спецсимволами.
+    std::string high;
+    for (int b = 0x80; b <= 0xff; ++b) high += static_cast<char>(b);
+    CHECK(escapes_like_reference(high));
+    CHECK(escapes_like_reference(high + "<" + high));
+    CHECK_EQ(html_escape(std::string("a\0<b", 4)), std::string("a\0&lt;b", 7));
+}
+
+TEST(html_escape_append_and_to) {
+    std::string out = "prefix:";
+    html_escape_append(out, "<a href='x'>");
+    CHECK_EQ(out, "prefix:&lt;a href=&#39;x&#39;&gt;");
+
+    char buf[64] = {};
+    const std::string_view s = "\"&\"";
+    char* end = html_escape_to(buf, s);
+    CHECK_EQ(static_cast<size_t>(end - buf), html_escaped_size(s));
+    CHECK_EQ(std::string(buf, end), "&quot;&amp;&quot;");
+}
+
+TEST(html_template_renders_exact_size) {
+    const HtmlTemplate t("<p title='{{title}}'>{{{body}}}</p>{{missing}}");
+    const auto html = t.render({{"title", "a'b"}, {"body", "<b>x</b>"}, {"extra", "ignored"}});
+    CHECK_EQ(html, "<p title='a&#39;b'><b>x</b></p>");
+    CHECK_EQ(t.size({{"title", "a'b"}, {"body", "<b>x</b>"}}), html.size());
+
+    std::string out(t.size({{"title", "<"}}), '\0');
+    char* end = t.render_to(&out[0], {{"title", "<"}});
+    CHECK_EQ(static_cast<size_t>(end - out.data()), out.size());
+    CHECK_EQ(out, "<p title='&lt;'></p>");
+}
+
+TEST(html_template_rejects_bad_markup) {
+    CHECK_THROWS(HtmlTemplate("{{title"));
+    CHECK_THROWS(HtmlTemplate("{{}}"));
+    CHECK_THROWS(HtmlTemplate("{{{raw}}"));
+}
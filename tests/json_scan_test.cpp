@@ -0,0 +1,106 @@
+#include "check.hpp"
+#include "json_scan.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::vector<std::string> kKeys = {"id", "name"};
+
+// Сканер обязан принимать ровно то, что принимает nlohmann: на чём он
+// ошибся, вызывающий откатывается на полный разбор.
+void check_agrees_with_nlohmann(const char* file, int line, const std::string& json) {
+    const bool accepted = json_scan_object(json, kKeys).has_value() || json_scan_list(json, kKeys).has_value();
+    if (accepted != nlohmann::json::accept(json)) {
+        check::fail(file, line, "disagrees with nlohmann on: " + json);
+    }
+}
+
+#define CHECK_AGREES(json) check_agrees_with_nlohmann(__FILE__, __LINE__, json)
+
+} // namespace
+
+TEST(json_scan_object_fields) {
+    const auto fields = json_scan_object(
+        R"({"skip":{"id":0,"a":[1,{"b":null}]},"id":-17,"name":"x\"\\\/\n\u00e9\ud83d\ude00","other":true})",
+        {"id", "name", "missing", "other"});
+    CHECK(fields.has_value());
+    if (!fields) return;
+    CHECK(fields->at(0).type == JsonField::Type::Integer);
+    CHECK_EQ(fields->at(0).text, "-17");
+    CHECK(fields->at(1).type == JsonField::Type::String);
+    CHECK_EQ(fields->at(1).text, "x\"\\/\n\xc3\xa9\xf0\x9f\x98\x80");
+    CHECK(fields->at(2).type == JsonField::Type::Missing);
+    CHECK(fields->at(3).type == JsonField::Type::Other);
+}
+
+TEST(json_scan_numbers_and_duplicates) {
+    const auto fields = json_scan_object(R"({"id":1,"id":2.5e3,"name":"a","name":"b"})", kKeys);
+    CHECK(fields.has_value());
+    if (!fields) return;
+    // Как nlohmann: берётся последний; дробное — не целое.
+    CHECK(fields->at(0).type == JsonField::Type::Other);
+    CHECK_EQ(fields->at(1).text, "b");
+}
+
+TEST(json_scan_object_needs_object_root) {
+    CHECK(!json_scan_object("[]", kKeys));
+    CHECK(!json_scan_object("\"id\"", kKeys));
+    CHECK(json_scan_object(" \t\r\n{}\n", kKeys).has_value());
+}
+
+TEST(json_scan_list_shapes) {
+    const auto root = json_scan_list(R"([{"id":1,"name":"a"},2,"x",{"name":"b"},null])", kKeys);
+    CHECK(root.has_value());
+    if (root) {
+        CHECK_EQ(root->size, 5u);
+        CHECK_EQ(root->objects.size(), 2u);
+        CHECK_EQ(root->objects[0][0].text, "1");
+        CHECK(root->objects[1][0].type == JsonField::Type::Missing);
+        CHECK_EQ(root->objects[1][1].text, "b");
+    }
+
+    // items раньше results и data, сколько бы их ни было и в каком порядке.
+    const auto nested = json_scan_list(R"({"data":[{"id":3}],"results":[],"items":[{"id":1},{"id":2}]})", kKeys);
+    CHECK(nested && nested->size == 2 && nested->objects[1][0].text == "2");
+
+    const auto not_array = json_scan_list(R"({"items":{"id":1},"results":[{"id":7}]})", kKeys);
+    CHECK(not_array && not_array->size == 1 && not_array->objects[0][0].text == "7");
+
+    const auto none = json_scan_list(R"({"id":1})", kKeys);
+    CHECK(none && none->size == 0);
+    const auto empty = json_scan_list("[]", kKeys);
+    CHECK(empty && empty->size == 0);
+}
+
+TEST(json_scan_rejects_malformed) {
+    for (const char* json : {
+             "", " ", "{", "}", "[", "[1,]", "[,1]", "{\"id\":1,}", "{\"id\" 1}", "{id:1}", "{\"id\":}",
+             "[1 2]", "{\"id\":1}}", "{\"id\":1} x", "[\"a]", "[\"\\x\"]", "[\"\\u12\"]", "[\"\\u12g4\"]",
+             "[\"a\nb\"]", "[01]", "[-]", "[1.]", "[.5]", "[1e]", "[1e+]", "[+1]", "[0x10]", "[nul]",
+             "[truee]", "[NaN]", "[Infinity]", "['a']", "{\"a\":[}]", "[{]}", "\"\\ud800\"", "[\"\\udc00\"]",
+         }) {
+        CHECK(!json_scan_object(json, kKeys));
+        CHECK(!json_scan_list(json, kKeys));
+        CHECK_AGREES(json);
+    }
+}
+
+TEST(json_scan_agrees_on_valid_edge_cases) {
+    for (const char* json : {
+             "{}", "[]", "[0]", "[-0]", "[1e5]", "[1E-5]", "[-1.5e+10]", "[\"\"]", "[\"\\u0000\"]",
+             "[\"\\ud83d\\ude00\"]", "[true,false,null]", "[[[]]]", "{\"\":{\"\":[]}}",
+             "[9223372036854775807]", "[18446744073709551616]", "[-9223372036854775809]",
+         }) {
+        CHECK_AGREES(json);
+    }
+}
+
+TEST(json_scan_rejects_deep_nesting) {
+    const std::string deep = std::string(10000, '[') + std::string(10000, ']');
+    CHECK(!json_scan_list(deep, kKeys));
+    CHECK(!json_scan_object("{\"a\":" + deep + "}", kKeys));
+}
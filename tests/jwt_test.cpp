@@ -0,0 +1,90 @@
+#include "check.hpp"
+#include "jwt.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <string>
+
+namespace {
+
+std::string base64url(const std::string& in) {
+    static const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    std::string out;
+    uint32_t acc = 0;
+    int bits = 0;
+    for (unsigned char c : in) {
+        acc = (acc << 8) | c;
+        bits += 8;
+        while (bits >= 6) {
+            bits -= 6;
+            out += alphabet[(acc >> bits) & 0x3f];
+        }
+    }
+    if (bits > 0) out += alphabet[(acc << (6 - bits)) & 0x3f];
+    return out;
+}
+
+std::string token(const std::string& payload) {
+    return base64url(R"({"alg":"RS256","typ":"JWT"})") + "." + base64url(payload) + ".c2ln";
+}
+
+} // namespace
+
+TEST(jwt_exp_integer_and_fraction) {
+    CHECK(jwt_exp(token(R"({"exp":1700000000})")) == std::optional<int64_t>(1700000000));
+    CHECK(jwt_exp(token(R"({"exp":1700000000.9})")) == std::optional<int64_t>(1700000000));
+    CHECK(jwt_exp(token(R"({"exp":-5})")) == std::optional<int64_t>(-5));
+    CHECK(jwt_exp(token(R"({"exp":9223372036854775807})")) ==
+          std::optional<int64_t>(std::numeric_limits<int64_t>::max()));
+}
+
+TEST(jwt_exp_rejects_out_of_range_and_wrong_types) {
+    CHECK(!jwt_exp(token(R"({"exp":9223372036854775808})")));
+    CHECK(!jwt_exp(token(R"({"exp":18446744073709551615})")));
+    CHECK(!jwt_exp(token(R"({"exp":1e300})")));
+    CHECK(!jwt_exp(token(R"({"exp":-1e300})")));
+    CHECK(!jwt_exp(token(R"({"exp":9223372036854775808.0})")));
+    CHECK(!jwt_exp(token(R"({"exp":"1700000000"})")));
+    CHECK(!jwt_exp(token(R"({"exp":null})")));
+    CHECK(!jwt_exp(token(R"({"sub":"u"})")));
+}
+
+TEST(jwt_sub_string_and_number) {
+    CHECK(jwt_sub(token(R"({"sub":"user-1"})")) == std::optional<std::string>("user-1"));
+    CHECK(jwt_sub(token(R"({"sub":42})")) == std::optional<std::string>("42"));
+    CHECK(jwt_sub(token(R"({"sub":-42})")) == std::optional<std::string>("-42"));
+    CHECK(jwt_sub(token(R"({"sub":18446744073709551615})")) == std::optional<std::string>("18446744073709551615"));
+    CHECK(!jwt_sub(token(R"({"sub":1.5})")));
+    CHECK(!jwt_sub(token(R"({"sub":["u"]})")));
+    CHECK(!jwt_sub(token(R"({"exp":1})")));
+}
+
+TEST(jwt_accepts_padding_and_standard_alphabet) {
+    // Payload с '?' и '>' даёт в base64 символы '/' и '+', в base64url — '_' и '-'.
+    const std::string payload = R"({"sub":"?>?>>"})";
+    auto url = token(payload);
+    CHECK(url.find_first_of("-_", url.find('.')) < url.rfind('.'));
+    CHECK(jwt_sub(url) == std::optional<std::string>("?>?>>"));
+
+    std::string standard = url;
+    for (auto& c : standard) {
+        if (c == '-') c = '+';
+        if (c == '_') c = '/';
+    }
+    CHECK(jwt_sub(standard) == std::optional<std::string>("?>?>>"));
+
+    const auto dot = url.find('.', url.find('.') + 1);
+    std::string padded = url;
+    padded.insert(dot, "==");
+    CHECK(jwt_sub(padded) == std::optional<std::string>("?>?>>"));
+}
+
+TEST(jwt_rejects_non_tokens) {
+    CHECK(!jwt_exp(""));
+    CHECK(!jwt_exp("opaque-token"));
+    CHECK(!jwt_exp("a.b"));
+    CHECK(!jwt_exp("a.!!!.c"));
+    CHECK(!jwt_exp("a." + base64url("not json") + ".c"));
+    CHECK(!jwt_exp("a." + base64url("[1]") + ".c"));
+    CHECK(!jwt_sub("a." + base64url(R"("sub")") + ".c"));
+}
@@ -0,0 +1,23 @@
+#include "check.hpp"
+
+#include <cstring>
+#include <exception>
+
+// web-client-tests [подстрока] — только тесты, в имени которых она есть.
+int main(int argc, char** argv) {
+    const char* filter = argc > 1 ? argv[1] : "";
+    int run = 0;
+    for (const auto& test : check::cases()) {
+        if (std::strstr(test.name, filter) == nullptr) continue;
+        ++run;
+        const int before = check::failures();
+        try {
+            test.run();
+        } catch (const std::exception& e) {
+            check::fail(test.name, 0, std::string("unexpected exception: ") + e.what());
+        }
+        std::printf("%s %s\n", check::failures() == before ? "ok  " : "FAIL", test.name);
+    }
+    std::printf("%d tests, %d failed checks\n", run, check::failures());
+    return check::failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+#include "check.hpp"
+#include "metrics.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <thread>
+
+namespace {
+
+using std::chrono::microseconds;
+using std::chrono::nanoseconds;
+
+// Верхняя граница корзины в микросекундах, посчитанная независимо:
+// 8 мкс, затем 1.5·2^k и 2·2^k для k = 3..25.
+uint64_t expected_bound_us(size_t bucket) {
+    if (bucket == 0) return 8;
+    const uint64_t base = uint64_t(1) << (3 + (bucket - 1) / 2);
+    return (bucket - 1) % 2 == 0 ? base + base / 2 : base * 2;
+}
+
+} // namespace
+
+TEST(metrics_bucket_bounds) {
+    for (size_t b = 0; b + 1 < metrics::kBuckets; ++b) {
+        const double expected = static_cast<double>(expected_bound_us(b)) * 1e-6;
+        if (std::fabs(metrics::bucket_bound(b) - expected) > expected * 1e-12) {
+            check::fail(__FILE__, __LINE__, "bound of bucket " + std::to_string(b));
+        }
+        if (b > 0 && !(metrics::bucket_bound(b) > metrics::bucket_bound(b - 1))) {
+            check::fail(__FILE__, __LINE__, "bounds not increasing at " + std::to_string(b));
+        }
+    }
+    CHECK(std::isinf(metrics::bucket_bound(metrics::kBuckets - 1)));
+    // Последняя конечная граница — 2^26 мкс, около 67 с.
+    CHECK_EQ(expected_bound_us(metrics::kBuckets - 2), uint64_t(1) << 26);
+}
+
+TEST(metrics_bucket_for_is_inclusive_at_bounds) {
+    for (size_t b = 0; b + 1 < metrics::kBuckets; ++b) {
+        const auto bound = microseconds(expected_bound_us(b));
+        if (metrics::bucket_for(bound) != b) {
+            check::fail(__FILE__, __LINE__, "le bound of bucket " + std::to_string(b));
+        }
+        if (metrics::bucket_for(bound + nanoseconds(1)) != b + 1) {
+            check::fail(__FILE__, __LINE__, "just above bucket " + std::to_string(b));
+        }
+        if (b > 0 && metrics::bucket_for(microseconds(expected_bound_us(b - 1)) + nanoseconds(1)) != b) {
+            check::fail(__FILE__, __LINE__, "just above lower bound of " + std::to_string(b));
+        }
+    }
+}
+
+TEST(metrics_bucket_for_extremes) {
+    CHECK_EQ(metrics::bucket_for(nanoseconds(0)), 0u);
+    CHECK_EQ(metrics::bucket_for(nanoseconds(-5)), 0u);
+    CHECK_EQ(metrics::bucket_for(std::chrono::hours(1)), metrics::kBuckets - 1);
+    CHECK_EQ(metrics::bucket_for(metrics::Clock::duration::max()), metrics::kBuckets - 1);
+}
+
+TEST(metrics_histogram_renders_cumulative_buckets) {
+    const auto h = metrics::histogram("test_latency_seconds", "Test histogram", {{"case", "a\"b"}});
+    h.observe(microseconds(5));
+    h.observe(microseconds(12));
+    std::thread([&] { h.observe(std::chrono::seconds(100)); }).join();
+
+    const auto text = metrics::render();
+    const std::string labels = "case=\"a\\\"b\"";
+    CHECK(text.find("# TYPE test_latency_seconds histogram\n") != std::string::npos);
+    CHECK(text.find("test_latency_seconds_bucket{" + labels + ",le=\"8e-06\"} 1\n") != std::string::npos);
+    CHECK(text.find("test_latency_seconds_bucket{" + labels + ",le=\"1.2e-05\"} 2\n") != std::string::npos);
+    CHECK(text.find("test_latency_seconds_bucket{" + labels + ",le=\"67.108864\"} 2\n") != std::string::npos);
+    CHECK(text.find("test_latency_seconds_bucket{" + labels + ",le=\"+Inf\"} 3\n") != std::string::npos);
+    CHECK(text.find("test_latency_seconds_count{" + labels + "} 3\n") != std::string::npos);
+    CHECK(text.find("test_latency_seconds_sum{" + labels + "} 100.000017\n") != std::string::npos);
+}
+
+TEST(metrics_counters_sum_across_threads) {
+    const auto c = metrics::counter("test_events_total", "Test counter");
+    const auto g = metrics::gauge("test_in_flight", "Test gauge");
+    c.inc(2);
+    g.inc();
+    std::thread([&] {
+        c.inc();
+        g.dec();
+        g.dec();
+    }).join();
+
+    const auto text = metrics::render();
+    CHECK(text.find("test_events_total 3\n") != std::string::npos);
+    CHECK(text.find("test_in_flight -1\n") != std::string::npos);
+    CHECK_THROWS(metrics::gauge("test_events_total", "Wrong type"));
+}
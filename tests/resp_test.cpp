@@ -0,0 +1,148 @@
+#include "check.hpp"
+#include "resp.hpp"
+
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// Скормить байты и разобрать одно значение; false — данных не хватило.
+bool parse(RespReader& reader, const std::string& bytes, RespValue& out) {
+    reader.feed(bytes.data(), bytes.size());
+    return reader.next(out);
+}
+
+// Строки RespValue указывают в буфер reader-а — держим его вместе со значением.
+struct Parsed {
+    RespReader reader;
+    RespValue value;
+};
+
+RespValue parse_one(const std::string& bytes) {
+    static std::unique_ptr<Parsed> last;
+    last = std::make_unique<Parsed>();
+    last->reader.feed(bytes.data(), bytes.size());
+    if (!last->reader.next(last->value)) throw std::runtime_error("incomplete");
+    return last->value;
+}
+
+} // namespace
+
+TEST(resp_command_encodes_bulk_array) {
+    CHECK_EQ(resp_command({"SET", "k", ""}), "*3\r\n$3\r\nSET\r\n$1\r\nk\r\n$0\r\n\r\n");
+}
+
+TEST(resp_scalars) {
+    CHECK(parse_one("+OK\r\n").type == RespValue::Type::SimpleString);
+    CHECK_EQ(parse_one("+OK\r\n").str, "OK");
+    CHECK(parse_one("-ERR bad\r\n").is_error());
+    CHECK_EQ(parse_one(":-42\r\n").integer, -42);
+    CHECK_EQ(parse_one(":9223372036854775807\r\n").integer, std::numeric_limits<long long>::max());
+    CHECK_EQ(parse_one(":-9223372036854775808\r\n").integer, std::numeric_limits<long long>::min());
+    CHECK(parse_one("$-1\r\n").is_null());
+    CHECK(parse_one("*-1\r\n").is_null());
+    CHECK(parse_one("_\r\n").is_null());
+    CHECK_EQ(parse_one("$5\r\nhe\r\no\r\n").str, "he\r\no");
+    CHECK_EQ(parse_one("#t\r\n").integer, 1);
+    CHECK_EQ(parse_one(",1.5\r\n").number, 1.5);
+    CHECK_EQ(parse_one("(12345678901234567890\r\n").str, "12345678901234567890");
+    CHECK_EQ(parse_one("=7\r\ntxt:abc\r\n").str, "abc");
+    CHECK(parse_one("!3\r\nERR\r\n").is_error());
+}
+
+TEST(resp_nested_aggregates) {
+    const auto v = parse_one("*3\r\n:1\r\n*2\r\n$1\r\na\r\n%1\r\n+k\r\n~1\r\n_\r\n$1\r\nz\r\n");
+    CHECK(v.type == RespValue::Type::Array);
+    CHECK_EQ(v.elements.size(), 3u);
+    CHECK_EQ(v.elements[0].integer, 1);
+    const auto& inner = v.elements[1];
+    CHECK_EQ(inner.elements.size(), 2u);
+    CHECK_EQ(inner.elements[0].str, "a");
+    CHECK(inner.elements[1].type == RespValue::Type::Map);
+    CHECK_EQ(inner.elements[1].elements.size(), 2u);
+    CHECK(inner.elements[1].elements[1].type == RespValue::Type::Set);
+    CHECK_EQ(v.elements[2].str, "z");
+}
+
+TEST(resp_push_and_attribute) {
+    const auto push = parse_one(">2\r\n$10\r\ninvalidate\r\n*1\r\n$9\r\nsession:1\r\n");
+    CHECK(push.type == RespValue::Type::Push);
+    CHECK_EQ(push.elements[1].elements[0].str, "session:1");
+
+    // Атрибут пропускается, значение — следующее за ним.
+    const auto v = parse_one("|1\r\n+ttl\r\n:3\r\n:7\r\n");
+    CHECK(v.type == RespValue::Type::Integer);
+    CHECK_EQ(v.integer, 7);
+}
+
+TEST(resp_partial_feed_byte_by_byte) {
+    const std::string bytes = "*2\r\n$3\r\nfoo\r\n%1\r\n+a\r\n:10\r\n+NEXT\r\n";
+    RespReader reader;
+    RespValue out;
+    size_t i = 0;
+    for (; i < bytes.size(); ++i) {
+        reader.feed(&bytes[i], 1);
+        if (reader.next(out)) break;
+    }
+    CHECK_EQ(i, bytes.size() - 8); // целиком ровно на последнем байте первого ответа
+    CHECK_EQ(out.elements.size(), 2u);
+    CHECK_EQ(out.elements[0].str, "foo");
+    CHECK_EQ(out.elements[1].elements[1].integer, 10);
+
+    for (++i; i < bytes.size(); ++i) reader.feed(&bytes[i], 1);
+    CHECK(reader.next(out));
+    CHECK_EQ(out.str, "NEXT");
+    CHECK(!reader.has_pending());
+}
+
+TEST(resp_incomplete_consumes_nothing) {
+    RespReader reader;
+    RespValue out;
+    CHECK(!parse(reader, "$5\r\nhel", out));
+    CHECK(reader.has_pending());
+    CHECK(parse(reader, "lo\r\n", out));
+    CHECK_EQ(out.str, "hello");
+}
+
+TEST(resp_several_replies_in_one_feed) {
+    RespReader reader;
+    RespValue out;
+    CHECK(parse(reader, "+A\r\n:2\r\n$-1\r\n", out));
+    CHECK_EQ(out.str, "A");
+    CHECK(reader.next(out));
+    CHECK_EQ(out.integer, 2);
+    CHECK(reader.next(out));
+    CHECK(out.is_null());
+    CHECK(!reader.next(out));
+}
+
+TEST(resp_rejects_malformed) {
+    CHECK_THROWS(parse_one("?x\r\n"));
+    CHECK_THROWS(parse_one(":12a\r\n"));
+    CHECK_THROWS(parse_one(":-\r\n"));
+    CHECK_THROWS(parse_one(":\r\n"));
+    CHECK_THROWS(parse_one("#x\r\n"));
+    CHECK_THROWS(parse_one(",1.5x\r\n"));
+    CHECK_THROWS(parse_one("$3\r\nabcd\r\n"));
+    CHECK_THROWS(parse_one("=2\r\nab\r\n"));
+    CHECK_THROWS(parse_one("$-2\r\n"));
+}
+
+TEST(resp_rejects_out_of_range_lengths) {
+    CHECK_THROWS(parse_one(":9223372036854775808\r\n"));
+    CHECK_THROWS(parse_one(":-9223372036854775809\r\n"));
+    // Раньше такая длина оборачивалась при накоплении и проходила пределы.
+    CHECK_THROWS(parse_one("$99999999999999999999\r\n"));
+    CHECK_THROWS(parse_one("*99999999999999999999\r\n"));
+    CHECK_THROWS(parse_one("$536870913\r\n"));
+    CHECK_THROWS(parse_one("*4294967297\r\n"));
+}
+
+TEST(resp_rejects_deep_nesting) {
+    std::string bytes;
+    for (int i = 0; i < 100; ++i) bytes += "*1\r\n";
+    bytes += ":1\r\n";
+    CHECK_THROWS(parse_one(bytes));
+}
@@ -0,0 +1,100 @@
+#include "check.hpp"
+#include "session.hpp"
+
+#include <string>
+
+namespace {
+
+SessionData sample() {
+    SessionData data;
+    data.status = "authorized";
+    data.login_token = "login";
+    data.access_token = std::string(200, 'a'); // длина — двухбайтный varint
+    data.refresh_token = "refresh";
+    data.access_exp = 1700000000;
+    return data;
+}
+
+bool same(const SessionData& a, const SessionData& b) {
+    return a.status == b.status && a.login_token == b.login_token && a.access_token == b.access_token &&
+           a.refresh_token == b.refresh_token && a.access_exp == b.access_exp;
+}
+
+} // namespace
+
+TEST(session_binary_round_trip) {
+    const auto data = sample();
+    const auto bytes = serialize_session(data);
+    CHECK_EQ(bytes[0], '\0');
+    CHECK_EQ(bytes[1], '\2');
+
+    const auto parsed = parse_session(bytes);
+    CHECK(parsed.has_value());
+    CHECK(parsed && same(*parsed, data));
+
+    SessionData empty_tokens;
+    empty_tokens.status = "anonymous";
+    const auto anonymous = parse_session(serialize_session(empty_tokens));
+    CHECK(anonymous && same(*anonymous, empty_tokens));
+}
+
+TEST(session_binary_rejects_every_truncation) {
+    const auto bytes = serialize_session(sample());
+    for (size_t n = 0; n < bytes.size(); ++n) {
+        if (parse_session(bytes.substr(0, n))) {
+            check::fail(__FILE__, __LINE__, "truncated to " + std::to_string(n) + " bytes parsed");
+        }
+    }
+}
+
+TEST(session_binary_rejects_bad_varints) {
+    // Длина status не закончена: байт продолжения в самом конце.
+    CHECK(!parse_session(std::string("\0\2\x85", 3)));
+    // Длина status в 5 байтах продолжения — больше 28 бит.
+    CHECK(!parse_session(std::string("\0\2\x80\x80\x80\x80\x80\x01", 8)));
+    // Длина больше оставшихся данных.
+    CHECK(!parse_session(std::string("\0\2\x05" "ab", 5)));
+    // exp v2: 11 байт — дальше 63 бит.
+    std::string bytes = std::string("\0\2\1s\0\0\0", 7) + std::string(10, '\x80') + '\x01';
+    CHECK(!parse_session(bytes));
+}
+
+TEST(session_binary_versions) {
+    // Версия 0 не бывает, v1 — без exp.
+    CHECK(!parse_session(std::string("\0\0\1s\0\0\0", 7)));
+    const auto v1 = parse_session(std::string("\0\1\1s\0\0\0", 7));
+    CHECK(v1 && v1->status == "s" && v1->access_exp == 0);
+    // Пустой status — запись битая.
+    CHECK(!parse_session(std::string("\0\2\0\0\0\0\0", 7)));
+    // Будущая версия с новым полем в хвосте читается без него.
+    auto future = serialize_session(sample());
+    future[1] = '\7';
+    future += "tail";
+    const auto parsed = parse_session(future);
+    CHECK(parsed && same(*parsed, sample()));
+}
+
+TEST(session_json_fallback) {
+    const auto parsed = parse_session(
+        R"({"status":"authorized","login_token":"l","access_token":"a","refresh_token":"r","access_exp":42})");
+    CHECK(parsed.has_value());
+    CHECK(parsed && parsed->status == "authorized" && parsed->access_token == "a" && parsed->access_exp == 42);
+
+    const auto minimal = parse_session(R"({"status":"anonymous","login_token":null})");
+    CHECK(minimal && minimal->status == "anonymous" && minimal->login_token.empty() && minimal->access_exp == 0);
+}
+
+TEST(session_json_rejects_wrong_types) {
+    CHECK(!parse_session("{"));
+    CHECK(!parse_session("[]"));
+    CHECK(!parse_session(R"("authorized")"));
+    CHECK(!parse_session(R"({})"));
+    CHECK(!parse_session(R"({"status":""})"));
+    CHECK(!parse_session(R"({"status":1})"));
+    CHECK(!parse_session(R"({"status":["authorized"]})"));
+    CHECK(!parse_session(R"({"status":"authorized","access_token":{}})"));
+    CHECK(!parse_session(R"({"status":"authorized","refresh_token":false})"));
+    CHECK(!parse_session(R"({"status":"authorized","access_exp":"42"})"));
+    CHECK(!parse_session(R"({"status":"authorized","access_exp":1.5})"));
+    CHECK(!parse_session(R"({"status":"authorized","access_exp":18446744073709551615})"));
+}